@@ -0,0 +1,118 @@
+#include "GhostBalls.h"
+
+void GhostBalls::Load(IBML *bml, const std::string &owner) {
+    m_BML = bml;
+    m_Owner = owner;
+    m_Types.clear();
+    m_Sets.clear();
+
+    CKDataArray *physBall = m_BML->GetArrayByName("Physicalize_GameBall");
+    for (int i = 0; i < physBall->GetRowCount(); i++) {
+        BallType type;
+        type.name.resize(physBall->GetElementStringValue(i, 0, nullptr), '\0');
+        physBall->GetElementStringValue(i, 0, &type.name[0]);
+        type.name.pop_back();
+
+        CK3dObject *ball = m_BML->Get3dObjectByName(type.name.c_str());
+        if (ball)
+            type.shared = GetShared(ball);
+        m_Types.push_back(type);
+    }
+    Reserve(1);
+}
+
+int GhostBalls::GetBallType(const std::string &name) const {
+    for (size_t i = 0; i < m_Types.size(); i++) {
+        if (m_Types[i].name == name)
+            return (int) i;
+    }
+    return 0;
+}
+
+void GhostBalls::Reserve(size_t ghosts) {
+    // Only the entity is copied, its meshes stay those of the shared ball
+    CKDependencies dep;
+    dep.Resize(40);
+    dep.Fill(0);
+    dep.m_Flags = CK_DEPENDENCIES_CUSTOM;
+    dep[CKCID_OBJECT] = CK_DEPENDENCIES_COPY_OBJECT_NAME | CK_DEPENDENCIES_COPY_OBJECT_UNIQUENAME;
+
+    while (m_Sets.size() < ghosts) {
+        BallSet set;
+        std::string suffix = "_" + m_Owner + std::to_string(m_Sets.size());
+        for (auto &type : m_Types) {
+            CK3dObject *ball = nullptr;
+            if (type.shared) {
+                ball = (CK3dObject *) m_BML->GetCKContext()->CopyObject(type.shared, &dep, (CKSTRING) suffix.c_str());
+                ball->Show(CKHIDE);
+            }
+            set.balls.push_back(ball);
+        }
+        m_Sets.push_back(std::move(set));
+    }
+}
+
+void GhostBalls::Show(size_t ghost, int type, bool visible, const VxVector &pos, const VxQuaternion &rot) {
+    if (ghost >= m_Sets.size())
+        return;
+
+    auto &set = m_Sets[ghost];
+    if (type != set.shown)
+        Hide(ghost);
+    if (type < 0 || type >= (int) set.balls.size() || !set.balls[type])
+        return;
+
+    CK3dObject *ball = set.balls[type];
+    set.shown = type;
+    ball->Show(visible ? CKSHOW : CKHIDE);
+    ball->SetPosition(&pos);
+    ball->SetQuaternion(&rot);
+}
+
+void GhostBalls::Hide(size_t ghost) {
+    if (ghost >= m_Sets.size())
+        return;
+
+    auto &set = m_Sets[ghost];
+    if (set.shown >= 0 && set.shown < (int) set.balls.size() && set.balls[set.shown])
+        set.balls[set.shown]->Show(CKHIDE);
+    set.shown = -1;
+}
+
+void GhostBalls::HideAll() {
+    for (size_t i = 0; i < m_Sets.size(); i++)
+        Hide(i);
+}
+
+CK3dObject *GhostBalls::GetShared(CK3dObject *ball) {
+    // Another mod may have made it already
+    std::string name = std::string(ball->GetName()) + "_Ghost";
+    CK3dObject *shared = m_BML->Get3dObjectByName(name.c_str());
+    if (shared)
+        return shared;
+
+    CKDependencies dep;
+    dep.Resize(40);
+    dep.Fill(0);
+    dep.m_Flags = CK_DEPENDENCIES_CUSTOM;
+    dep[CKCID_OBJECT] = CK_DEPENDENCIES_COPY_OBJECT_NAME;
+    dep[CKCID_MESH] = CK_DEPENDENCIES_COPY_MESH_MATERIAL;
+    dep[CKCID_3DENTITY] = CK_DEPENDENCIES_COPY_3DENTITY_MESH;
+
+    shared = (CK3dObject *) m_BML->GetCKContext()->CopyObject(ball, &dep, (CKSTRING) "_Ghost");
+    for (int j = 0; j < shared->GetMeshCount(); j++) {
+        CKMesh *mesh = shared->GetMesh(j);
+        for (int k = 0; k < mesh->GetMaterialCount(); k++) {
+            CKMaterial *mat = mesh->GetMaterial(k);
+            mat->EnableAlphaBlend();
+            mat->SetSourceBlend(VXBLEND_SRCALPHA);
+            mat->SetDestBlend(VXBLEND_INVSRCALPHA);
+            VxColor color = mat->GetDiffuse();
+            color.a = 0.5f;
+            mat->SetDiffuse(color);
+            m_BML->SetIC(mat);
+        }
+    }
+    shared->Show(CKHIDE);
+    return shared;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <BML/BMLAll.h>
+
+// Translucent balls to show ghosts with, one set of every ball type per ghost.
+//
+// The translucent meshes and materials are made once per game and shared by every mod using the
+// pool: the first one to see Balls.nmo loaded copies the game balls under fixed names, the others
+// find those copies. The balls of a set are entities of their own that reference the shared meshes,
+// so a ghost only costs a few entities whichever mod plays it.
+class GhostBalls {
+public:
+    // To be called once Balls.nmo is loaded, owner names the balls of the sets of this mod
+    void Load(IBML *bml, const std::string &owner);
+
+    [[nodiscard]] bool IsLoaded() const { return !m_Types.empty(); }
+
+    // Index of the ball type of the game ball of that name, 0 when unknown
+    [[nodiscard]] int GetBallType(const std::string &name) const;
+
+    // Makes sure there are sets for that many ghosts
+    void Reserve(size_t ghosts);
+
+    // Shows the ghost as the ball type at the state, or hides it when the type is out of range
+    void Show(size_t ghost, int type, bool visible, const VxVector &pos, const VxQuaternion &rot);
+    void Hide(size_t ghost);
+    void HideAll();
+
+private:
+    struct BallType {
+        std::string name;
+        CK3dObject *shared = nullptr;
+    };
+
+    struct BallSet {
+        std::vector<CK3dObject *> balls;
+        int shown = -1;
+    };
+
+    CK3dObject *GetShared(CK3dObject *ball);
+
+    IBML *m_BML = nullptr;
+    std::string m_Owner;
+    std::vector<BallType> m_Types;
+    std::vector<BallSet> m_Sets;
+};
@@ -0,0 +1,294 @@
+#include "GhostCodec.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+    constexpr float SQRT1_2 = 0.70710678f;
+    constexpr int QUAT_BITS = 10;
+    constexpr uint32_t QUAT_MAX = (1u << QUAT_BITS) - 1;
+
+    // Time, three velocity and three position fields per keyframe
+    constexpr size_t STATE_FIELDS = 7;
+
+    int32_t ToFixed(float v, float scale) {
+        return (int32_t) std::lround(v * scale);
+    }
+
+    // Divisor turning the sum of two velocities times a time delta into the distance travelled at their mean
+    int64_t DistanceDivisor(float positionScale, float velocityScale) {
+        return std::llround(2000.0f * velocityScale * GhostCodec::TIME_SCALE / positionScale);
+    }
+
+    int32_t PredictDistance(int32_t v0, int32_t v1, int32_t dt, int64_t divisor) {
+        int64_t n = (int64_t) (v0 + v1) * dt;
+        return (int32_t) (n >= 0 ? (n + divisor / 2) / divisor : -((divisor / 2 - n) / divisor));
+    }
+
+    // Gives states sampled every LEGACY_INTERVAL ms their times and finite difference velocities
+    void FillTiming(GhostRecord &record) {
+        auto &states = record.states;
+        for (size_t i = 0; i < states.size(); i++) {
+            states[i].time = (float) i * GhostCodec::LEGACY_INTERVAL;
+            size_t prev = i > 0 ? i - 1 : i, next = i + 1 < states.size() ? i + 1 : i;
+            if (prev != next)
+                states[i].vel = (states[next].pos - states[prev].pos) *
+                                (1000.0f / ((float) (next - prev) * GhostCodec::LEGACY_INTERVAL));
+        }
+    }
+}
+
+void GhostCodec::PutVarint(std::vector<char> &out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back((char) (v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((char) v);
+}
+
+bool GhostCodec::Reader::Varint(uint32_t &v) {
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (m_Cur == m_End)
+            return false;
+        auto byte = (uint8_t) *m_Cur++;
+        v |= (uint32_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+const char *GhostCodec::Reader::Skip(size_t size) {
+    if ((size_t) (m_End - m_Cur) < size)
+        return nullptr;
+    const char *data = m_Cur;
+    m_Cur += size;
+    return data;
+}
+
+void GhostCodec::EncodeHeader(const GhostRecord &record, uint32_t payloadSize, char *header) {
+    uint32_t magic = MAGIC, version = VERSION;
+    memcpy(header, &magic, 4);
+    memcpy(header + 4, &version, 4);
+    memcpy(header + 8, &record.hsscore, 4);
+    memcpy(header + 12, &record.srscore, 4);
+    memcpy(header + 16, &payloadSize, 4);
+}
+
+bool GhostCodec::DecodeHeader(const char *data, size_t size, GhostRecord &record, uint32_t &payloadSize) {
+    uint32_t magic, version;
+    if (size < HEADER_SIZE)
+        return false;
+    memcpy(&magic, data, 4);
+    memcpy(&version, data + 4, 4);
+    if (magic != MAGIC || version != VERSION)
+        return false;
+
+    memcpy(&record.hsscore, data + 8, 4);
+    memcpy(&record.srscore, data + 12, 4);
+    memcpy(&payloadSize, data + 16, 4);
+    return true;
+}
+
+void GhostCodec::EncodePayload(const GhostRecord &record, std::vector<char> &payload) {
+    const size_t count = record.states.size();
+    payload.clear();
+    payload.reserve(8 + count * 16 + record.trafo.size() * 4);
+
+    PutVarint(payload, (uint32_t) count);
+    PutVarint(payload, (uint32_t) record.trafo.size());
+
+    // Positions are predicted from the velocities at both ends, only the residual is stored. Each field
+    // is stored for all keyframes before the next one, so the packer sees runs of alike values.
+    const int64_t divisor = DistanceDivisor(POSITION_SCALE, VELOCITY_SCALE);
+    std::vector<int32_t> fields(count * STATE_FIELDS);
+    int32_t lastTime = 0, lastPos[3] = {0, 0, 0}, lastVel[3] = {0, 0, 0};
+    for (size_t k = 0; k < count; k++) {
+        const auto &state = record.states[k];
+        int32_t time = ToFixed(state.time, TIME_SCALE);
+        int32_t vel[3] = {ToFixed(state.vel.x, VELOCITY_SCALE), ToFixed(state.vel.y, VELOCITY_SCALE),
+                          ToFixed(state.vel.z, VELOCITY_SCALE)};
+        int32_t pos[3] = {ToFixed(state.pos.x, POSITION_SCALE), ToFixed(state.pos.y, POSITION_SCALE),
+                          ToFixed(state.pos.z, POSITION_SCALE)};
+
+        fields[k] = time - lastTime;
+        for (int i = 0; i < 3; i++) {
+            int32_t predicted = lastPos[i] + PredictDistance(lastVel[i], vel[i], time - lastTime, divisor);
+            fields[(1 + i) * count + k] = vel[i] - lastVel[i];
+            fields[(4 + i) * count + k] = pos[i] - predicted;
+            lastPos[i] = pos[i];
+            lastVel[i] = vel[i];
+        }
+        lastTime = time;
+    }
+    for (int32_t field : fields)
+        PutVarint(payload, ZigZag(field));
+
+    // Rotations are stored as byte planes, most significant first, which the packer compresses far better
+    size_t base = payload.size();
+    payload.resize(base + count * 4);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t rot = PackQuaternion(record.states[i].rot);
+        for (int b = 0; b < 4; b++)
+            payload[base + b * count + i] = (char) (rot >> (24 - 8 * b));
+    }
+
+    int lastFrame = 0;
+    for (const auto &trafo : record.trafo) {
+        PutVarint(payload, ZigZag(trafo.first - lastFrame));
+        PutVarint(payload, ZigZag(trafo.second));
+        lastFrame = trafo.first;
+    }
+}
+
+bool GhostCodec::DecodePayload(const char *data, size_t size, GhostRecord &record) {
+    Reader reader(data, size);
+
+    // Every state takes at least 7 bytes and every trafo entry 2, larger counts are corrupt
+    uint32_t stateCount, trafoCount;
+    if (!reader.Varint(stateCount) || !reader.Varint(trafoCount) ||
+        stateCount > reader.Remaining() / 7 || trafoCount > reader.Remaining() / 2)
+        return false;
+
+    std::vector<int32_t> fields(stateCount * STATE_FIELDS);
+    for (auto &field : fields) {
+        uint32_t v;
+        if (!reader.Varint(v))
+            return false;
+        field = UnZigZag(v);
+    }
+
+    record.states.resize(stateCount);
+    const int64_t divisor = DistanceDivisor(POSITION_SCALE, VELOCITY_SCALE);
+    int32_t lastTime = 0, lastPos[3] = {0, 0, 0}, lastVel[3] = {0, 0, 0};
+    for (uint32_t k = 0; k < stateCount; k++) {
+        int32_t dt = fields[k];
+        for (int i = 0; i < 3; i++) {
+            int32_t v = lastVel[i] + fields[(1 + i) * stateCount + k];
+            lastPos[i] += PredictDistance(lastVel[i], v, dt, divisor) + fields[(4 + i) * stateCount + k];
+            lastVel[i] = v;
+        }
+        lastTime += dt;
+
+        GhostRecord::State &state = record.states[k];
+        state.time = (float) lastTime / TIME_SCALE;
+        state.vel = VxVector((float) lastVel[0], (float) lastVel[1], (float) lastVel[2]) / VELOCITY_SCALE;
+        state.pos = VxVector((float) lastPos[0], (float) lastPos[1], (float) lastPos[2]) / POSITION_SCALE;
+    }
+
+    auto planes = (const uint8_t *) reader.Skip(stateCount * 4);
+    if (!planes)
+        return false;
+
+    const VxQuaternion *prev = nullptr;
+    for (uint32_t i = 0; i < stateCount; i++) {
+        uint32_t rot = 0;
+        for (int b = 0; b < 4; b++)
+            rot = (rot << 8) | planes[b * stateCount + i];
+
+        VxQuaternion &q = record.states[i].rot;
+        q = UnpackQuaternion(rot);
+
+        // Keep consecutive rotations in the same hemisphere so they interpolate along the short arc
+        if (prev && prev->x * q.x + prev->y * q.y + prev->z * q.z + prev->w * q.w < 0) {
+            q.x = -q.x;
+            q.y = -q.y;
+            q.z = -q.z;
+            q.w = -q.w;
+        }
+        prev = &q;
+    }
+
+    record.trafo.resize(trafoCount);
+    int lastFrame = 0;
+    for (auto &trafo : record.trafo) {
+        uint32_t frame, ball;
+        if (!reader.Varint(frame) || !reader.Varint(ball))
+            return false;
+        lastFrame += UnZigZag(frame);
+        trafo = {lastFrame, UnZigZag(ball)};
+    }
+    return true;
+}
+
+bool GhostCodec::DecodeLegacy(const char *data, size_t size, GhostRecord &record, bool scoresOnly) {
+    if (size < 16)
+        return false;
+
+    int ssize, tsize;
+    memcpy(&record.hsscore, data, 4);
+    memcpy(&record.srscore, data + 4, 4);
+    memcpy(&ssize, data + 8, 4);
+    memcpy(&tsize, data + 12, 4);
+    if (scoresOnly)
+        return true;
+
+    const size_t stateSize = sizeof(VxVector) + sizeof(VxQuaternion);
+    const size_t trafoSize = 2 * sizeof(int);
+    if (ssize < 0 || tsize < 0 || (size - 16) / stateSize < (size_t) ssize ||
+        (size - 16 - ssize * stateSize) / trafoSize < (size_t) tsize)
+        return false;
+
+    const char *p = data + 16;
+    record.states.resize(ssize);
+    for (auto &state : record.states) {
+        memcpy(&state.pos, p, sizeof(VxVector));
+        memcpy(&state.rot, p + sizeof(VxVector), sizeof(VxQuaternion));
+        p += stateSize;
+    }
+
+    record.trafo.resize(tsize);
+    for (auto &trafo : record.trafo) {
+        memcpy(&trafo.first, p, sizeof(int));
+        memcpy(&trafo.second, p + sizeof(int), sizeof(int));
+        p += trafoSize;
+    }
+
+    FillTiming(record);
+    return true;
+}
+
+uint32_t GhostCodec::PackQuaternion(const VxQuaternion &q) {
+    const float c[4] = {q.x, q.y, q.z, q.w};
+
+    int largest = 0;
+    for (int i = 1; i < 4; i++) {
+        if (std::fabs(c[i]) > std::fabs(c[largest]))
+            largest = i;
+    }
+
+    // q and -q are the same rotation, the largest component is made positive and left out
+    float sign = c[largest] < 0 ? -1.0f : 1.0f;
+    uint32_t packed = (uint32_t) largest << 30;
+    int shift = 20;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest)
+            continue;
+        float v = c[i] * sign / SQRT1_2 * 0.5f + 0.5f;
+        long bits = std::lround(v * QUAT_MAX);
+        bits = bits < 0 ? 0 : (bits > (long) QUAT_MAX ? (long) QUAT_MAX : bits);
+        packed |= (uint32_t) bits << shift;
+        shift -= QUAT_BITS;
+    }
+    return packed;
+}
+
+VxQuaternion GhostCodec::UnpackQuaternion(uint32_t packed) {
+    int largest = (int) (packed >> 30);
+
+    float c[4];
+    float sum = 0.0f;
+    int shift = 20;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest)
+            continue;
+        float v = (float) ((packed >> shift) & QUAT_MAX) / QUAT_MAX;
+        c[i] = (v * 2.0f - 1.0f) * SQRT1_2;
+        sum += c[i] * c[i];
+        shift -= QUAT_BITS;
+    }
+    c[largest] = std::sqrt(sum < 1.0f ? 1.0f - sum : 0.0f);
+
+    return VxQuaternion(c[0], c[1], c[2], c[3]);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "VxVector.h"
+#include "VxQuaternion.h"
+
+struct GhostRecord {
+    int hsscore = 0;
+    float srscore = 0;
+
+    struct State {
+        VxVector pos;
+        VxQuaternion rot;
+        VxVector vel;     // Units per second
+        float time = 0.0f; // Milliseconds since the start of the recording
+    };
+
+    std::vector<State> states;
+    std::vector<std::pair<int, int>> trafo;
+};
+
+// Ghost files (.rec)
+//
+// Version 2: [magic][version][hsscore][srscore][payload size] followed by chunks of at most CHUNK_KEYS
+// keyframes, each [payload size][packed size][packed payload] so a file can be played while it is read.
+// The scores stay outside of the packed payloads so they can be read without unpacking anything, the
+// payload size of the header is the sum of the chunk payload sizes. A chunk payload holds the state and
+// trafo counts as varints, then the keyframes one field after the other: time deltas in 1/4 ms,
+// velocities in 1/16 units per second as deltas from the previous ones and positions in 1/256 units as
+// residuals of a trapezoidal prediction from both velocities, each axis on its own and all zigzag
+// varints. Rotations follow as smallest-three quaternions in 32 bits laid out in byte planes, then
+// trafo entries as varint keyframe deltas, relative to the first keyframe of the chunk, and balls.
+//
+// Version 1 (legacy): [payload size][packed payload], the payload being hsscore, srscore, the counts
+// and a raw copy of the states sampled every LEGACY_INTERVAL ms and trafo entries. These states are
+// given their sampling times and finite difference velocities.
+namespace GhostCodec {
+    constexpr uint32_t MAGIC = 0x54534847; // "GHST"
+    constexpr uint32_t VERSION = 2;
+    constexpr size_t HEADER_SIZE = 20;
+    constexpr size_t CHUNK_HEADER_SIZE = 8;
+    constexpr size_t CHUNK_KEYS = 512;
+    constexpr float POSITION_SCALE = 256.0f;
+    constexpr float VELOCITY_SCALE = 16.0f;
+    constexpr float TIME_SCALE = 4.0f;
+    constexpr float LEGACY_INTERVAL = 125.0f;
+
+    void EncodeHeader(const GhostRecord &record, uint32_t payloadSize, char *header);
+    bool DecodeHeader(const char *data, size_t size, GhostRecord &record, uint32_t &payloadSize);
+
+    // Payloads of chunks
+    void EncodePayload(const GhostRecord &record, std::vector<char> &payload);
+    bool DecodePayload(const char *data, size_t size, GhostRecord &record);
+
+    bool DecodeLegacy(const char *data, size_t size, GhostRecord &record, bool scoresOnly);
+
+    uint32_t PackQuaternion(const VxQuaternion &q);
+    VxQuaternion UnpackQuaternion(uint32_t packed);
+
+    // Varints and zigzag coding of the payloads, shared with the files that embed them
+    inline uint32_t ZigZag(int32_t v) { return ((uint32_t) v << 1) ^ (uint32_t) (v >> 31); }
+    inline int32_t UnZigZag(uint32_t v) { return (int32_t) (v >> 1) ^ -(int32_t) (v & 1); }
+    void PutVarint(std::vector<char> &out, uint32_t v);
+
+    // Reads a buffer front to back, every read fails once past its end
+    class Reader {
+    public:
+        Reader(const char *data, size_t size) : m_Cur(data), m_End(data + size) {}
+
+        bool Varint(uint32_t &v);
+
+        template<typename T>
+        bool Get(T &v) {
+            const char *data = Skip(sizeof(T));
+            if (!data)
+                return false;
+            memcpy(&v, data, sizeof(T));
+            return true;
+        }
+
+        const char *Skip(size_t size);
+
+        [[nodiscard]] size_t Remaining() const { return m_End - m_Cur; }
+
+    private:
+        const char *m_Cur;
+        const char *m_End;
+    };
+}
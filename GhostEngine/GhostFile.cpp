@@ -0,0 +1,227 @@
+#include "GhostFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+
+#include <BML/BMLAll.h>
+
+namespace {
+    // Chunks hold CHUNK_KEYS keyframes of a few bytes each, anything much larger is corrupt
+    constexpr uint32_t MAX_CHUNK_SIZE = 1 << 20;
+}
+
+bool LoadGhostFile(const char *filename, GhostRecord &record, bool scoresOnly) {
+    GhostReader reader;
+    if (!reader.Open(filename, record))
+        return false;
+    if (scoresOnly)
+        return true;
+
+    record.states.clear();
+    record.trafo.clear();
+    GhostRecord chunk;
+    while (reader.ReadChunk(chunk)) {
+        int offset = (int) record.states.size();
+        record.states.insert(record.states.end(), chunk.states.begin(), chunk.states.end());
+        for (const auto &trafo : chunk.trafo)
+            record.trafo.emplace_back(trafo.first + offset, trafo.second);
+    }
+    return !reader.HasFailed();
+}
+
+bool SaveGhostFile(const GhostRecord &record, const char *filename) {
+    if (!filename)
+        return false;
+
+    std::vector<char> data;
+    if (!EncodeGhostFile(record, data))
+        return false;
+    return WriteFileAtomic(filename, data);
+}
+
+bool WriteFileAtomic(const char *filename, const std::vector<char> &data) {
+    if (!filename)
+        return false;
+
+    std::string temp = std::string(filename) + ".tmp";
+    FILE *fp = fopen(temp.c_str(), "wb");
+    if (!fp) return false;
+    bool res = data.empty() || fwrite(data.data(), data.size(), 1, fp) == 1;
+    res = fflush(fp) == 0 && res;
+    res = fclose(fp) == 0 && res;
+
+    if (!res || !ReplaceFileAtomic(temp.c_str(), filename)) {
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ReplaceFileAtomic(const char *source, const char *filename) {
+    if (!source || !filename)
+        return false;
+    return MoveFileExA(source, filename, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+}
+
+bool EncodeGhostFile(const GhostRecord &record, std::vector<char> &data) {
+    data.assign(GhostCodec::HEADER_SIZE, 0);
+
+    std::vector<char> payload;
+    uint32_t payloadSize = 0;
+    GhostRecord slice;
+    for (size_t begin = 0; begin < record.states.size(); begin += GhostCodec::CHUNK_KEYS) {
+        SliceGhostRecord(record, begin, GhostCodec::CHUNK_KEYS, slice);
+        GhostCodec::EncodePayload(slice, payload);
+
+        int nsize;
+        char *res = CKPackData(payload.data(), (int) payload.size(), nsize, 9);
+        if (!res) return false;
+
+        uint32_t sizes[2] = {(uint32_t) payload.size(), (uint32_t) nsize};
+        data.insert(data.end(), (char *) sizes, (char *) sizes + sizeof(sizes));
+        data.insert(data.end(), res, res + nsize);
+        payloadSize += sizes[0];
+        CKDeletePointer(res);
+    }
+
+    GhostCodec::EncodeHeader(record, payloadSize, data.data());
+    return true;
+}
+
+void SliceGhostRecord(const GhostRecord &record, size_t begin, size_t count, GhostRecord &slice) {
+    size_t end = (std::min)(begin + count, record.states.size());
+    slice.hsscore = record.hsscore;
+    slice.srscore = record.srscore;
+    slice.states.assign(record.states.begin() + (std::min)(begin, end), record.states.begin() + end);
+
+    // Entries outside of the keyframes go to the first or the last slice
+    slice.trafo.clear();
+    for (const auto &trafo : record.trafo) {
+        bool after = trafo.first >= 0 && (size_t) trafo.first >= begin;
+        bool before = trafo.first >= 0 && (size_t) trafo.first < end;
+        if ((after || begin == 0) && (before || end == record.states.size()))
+            slice.trafo.emplace_back(trafo.first - (int) begin, trafo.second);
+    }
+}
+
+bool GhostReader::Open(const char *filename, GhostRecord &record) {
+    GhostSource source;
+    source.path = filename;
+    return Open(source, record);
+}
+
+bool GhostReader::Open(const GhostSource &source, GhostRecord &record) {
+    Close();
+    m_Failed = false;
+    m_Loaded = false;
+    m_Next = 0;
+    m_Record.states.clear();
+    m_Record.trafo.clear();
+
+    m_File = fopen(source.path.c_str(), "rb");
+    if (!m_File)
+        return false;
+    if (source.offset > 0 && _fseeki64(m_File, source.offset, SEEK_SET) != 0) {
+        Close();
+        return false;
+    }
+    m_Remaining = source.size;
+
+    char header[GhostCodec::HEADER_SIZE];
+    uint32_t payloadSize;
+    size_t size = Read(header, sizeof(header));
+    if (GhostCodec::DecodeHeader(header, size, record, payloadSize))
+        return true;
+
+    // Legacy record, the scores are part of the packed payload
+    _fseeki64(m_File, source.offset, SEEK_SET);
+    m_Remaining = source.size;
+    std::vector<char> data = ReadRest();
+    Close();
+
+    bool res = false;
+    if (data.size() > 4) {
+        int payloadSize;
+        memcpy(&payloadSize, data.data(), 4);
+        char *payload = payloadSize > 0 ? CKUnPackData(payloadSize, data.data() + 4, (int) data.size() - 4) : nullptr;
+        res = payload && GhostCodec::DecodeLegacy(payload, payloadSize, m_Record, false);
+        if (payload) CKDeletePointer(payload);
+    }
+
+    if (!res)
+        return false;
+
+    record.hsscore = m_Record.hsscore;
+    record.srscore = m_Record.srscore;
+    m_Loaded = true;
+    return true;
+}
+
+bool GhostReader::ReadChunk(GhostRecord &chunk) {
+    if (m_Failed)
+        return false;
+
+    if (m_Loaded) {
+        if (m_Next >= m_Record.states.size())
+            return false;
+        SliceGhostRecord(m_Record, m_Next, GhostCodec::CHUNK_KEYS, chunk);
+        m_Next += chunk.states.size();
+        return true;
+    }
+
+    if (!m_File)
+        return false;
+
+    uint32_t sizes[2];
+    size_t size = Read(sizes, sizeof(sizes));
+    if (size == 0) {
+        Close();
+        return false;
+    }
+
+    bool res = false;
+    if (size == sizeof(sizes) && sizes[0] <= MAX_CHUNK_SIZE && sizes[1] > 0 && sizes[1] <= MAX_CHUNK_SIZE) {
+        m_Buffer.resize(sizes[1]);
+        if (Read(m_Buffer.data(), sizes[1]) == sizes[1]) {
+            char *payload = CKUnPackData((int) sizes[0], m_Buffer.data(), (int) sizes[1]);
+            res = payload && GhostCodec::DecodePayload(payload, sizes[0], chunk);
+            if (payload) CKDeletePointer(payload);
+        }
+    }
+
+    if (!res) {
+        m_Failed = true;
+        Close();
+    }
+    return res;
+}
+
+void GhostReader::Close() {
+    if (m_File) {
+        fclose(m_File);
+        m_File = nullptr;
+    }
+}
+
+size_t GhostReader::Read(void *buffer, size_t size) {
+    if (m_Remaining >= 0 && (int64_t) size > m_Remaining)
+        size = (size_t) m_Remaining;
+    size = fread(buffer, 1, size, m_File);
+    if (m_Remaining >= 0)
+        m_Remaining -= (int64_t) size;
+    return size;
+}
+
+std::vector<char> GhostReader::ReadRest() {
+    std::vector<char> data;
+    char buffer[4096];
+    size_t size;
+    while ((size = Read(buffer, sizeof(buffer))) > 0)
+        data.insert(data.end(), buffer, buffer + size);
+    return data;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "GhostCodec.h"
+
+// A ghost file, or a ghost stored in a part of a larger file.
+struct GhostSource {
+    std::string path;
+    int64_t offset = 0;
+    int64_t size = -1; // Up to the end of the file when negative
+};
+
+// Reads a whole ghost file of any version. When only the scores are asked for, the keyframes are
+// left out if the file allows it.
+bool LoadGhostFile(const char *filename, GhostRecord &record, bool scoresOnly);
+
+// Writes a ghost file of the current version.
+bool SaveGhostFile(const GhostRecord &record, const char *filename);
+bool EncodeGhostFile(const GhostRecord &record, std::vector<char> &data);
+
+// Writes a temporary file next to the file and moves it over the file once it is complete.
+bool WriteFileAtomic(const char *filename, const std::vector<char> &data);
+
+// Moves a complete file over another one, readers see either the old file or the new one.
+bool ReplaceFileAtomic(const char *source, const char *filename);
+
+// Copies the keyframes [begin, begin + count) of a record, trafo entries are made relative to begin.
+void SliceGhostRecord(const GhostRecord &record, size_t begin, size_t count, GhostRecord &slice);
+
+// Reads a ghost file one chunk of keyframes at a time, only the current chunk is held in memory.
+// Legacy files have no chunks, they are read at once and handed out in slices.
+class GhostReader {
+public:
+    GhostReader() = default;
+    GhostReader(const GhostReader &) = delete;
+    GhostReader &operator=(const GhostReader &) = delete;
+    ~GhostReader() { Close(); }
+
+    // Reads the header, filling the scores of the record
+    bool Open(const char *filename, GhostRecord &record);
+    bool Open(const GhostSource &source, GhostRecord &record);
+
+    // Reads the next keyframes, returns false at the end of the file or on failure
+    bool ReadChunk(GhostRecord &chunk);
+
+    [[nodiscard]] bool HasFailed() const { return m_Failed; }
+
+    void Close();
+
+private:
+    size_t Read(void *buffer, size_t size);
+    std::vector<char> ReadRest();
+
+    FILE *m_File = nullptr;
+    int64_t m_Remaining = -1;
+    bool m_Failed = false;
+    std::vector<char> m_Buffer;
+
+    // Whole record of legacy files
+    GhostRecord m_Record;
+    bool m_Loaded = false;
+    size_t m_Next = 0;
+};
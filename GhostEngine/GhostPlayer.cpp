@@ -0,0 +1,223 @@
+#include "GhostPlayer.h"
+
+#include <chrono>
+#include <cmath>
+
+void GhostPlayer::Start(const std::vector<GhostSource> &sources) {
+    Stop();
+
+    for (const auto &source : sources) {
+        auto ghost = std::make_unique<Ghost>();
+        ghost->source = source;
+        m_Ghosts.push_back(std::move(ghost));
+    }
+
+    size_t slots = m_Ghosts.size() * RING_KEYS;
+    m_Time.assign(slots, 0.0f);
+    for (int i = 0; i < 3; i++) {
+        m_Pos[i].assign(slots, 0.0f);
+        m_Vel[i].assign(slots, 0.0f);
+    }
+    for (int i = 0; i < 4; i++)
+        m_Rot[i].assign(slots, i == 3 ? 1.0f : 0.0f);
+    m_Ball.assign(slots, -1);
+    Resize(m_Ghosts.size());
+
+    m_PlayTime = 0.0f;
+    m_Stop = false;
+    if (!m_Ghosts.empty())
+        m_Worker = std::thread(&GhostPlayer::Run, this);
+}
+
+void GhostPlayer::Stop() {
+    if (m_Worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Wake.notify_one();
+        m_Worker.join();
+    }
+
+    m_Ghosts.clear();
+    m_Time.clear();
+    for (int i = 0; i < 3; i++) {
+        m_Pos[i].clear();
+        m_Vel[i].clear();
+    }
+    for (auto &rot : m_Rot)
+        rot.clear();
+    m_Ball.clear();
+    Resize(0);
+}
+
+void GhostPlayer::Update(float time) {
+    const size_t count = m_Ghosts.size();
+    m_PlayTime.store(time, std::memory_order_relaxed);
+
+    // Advance the ghosts over the decoded keyframes and gather their segments
+    for (size_t g = 0; g < count; g++) {
+        Ghost &ghost = *m_Ghosts[g];
+        const size_t base = g * RING_KEYS;
+        bool finished = ghost.finished.load(std::memory_order_acquire);
+        size_t written = ghost.written.load(std::memory_order_acquire);
+
+        while (ghost.frame + 1 < written && m_Time[base + (ghost.frame + 1) % RING_KEYS] <= time)
+            ghost.frame++;
+        ghost.consumed.store(ghost.frame, std::memory_order_release);
+
+        ghost.playing = ghost.frame + 1 < written;
+        ghost.ended = !ghost.playing && finished;
+
+        if (ghost.frame >= written) {
+            // Nothing decoded yet, the slots may be being written
+            ghost.ball = -1;
+            m_U[g] = 0.0f;
+            m_Span[g] = 0.0f;
+            for (int i = 0; i < 3; i++)
+                m_P0[i][g] = m_V0[i][g] = m_P1[i][g] = m_V1[i][g] = 0.0f;
+            for (int i = 0; i < 4; i++)
+                m_Q0[i][g] = m_Q1[i][g] = i == 3 ? 1.0f : 0.0f;
+            continue;
+        }
+
+        size_t a = base + ghost.frame % RING_KEYS, b = ghost.playing ? base + (ghost.frame + 1) % RING_KEYS : a;
+        ghost.ball = m_Ball[a];
+
+        float span = m_Time[b] - m_Time[a];
+        float u = span > 0.0f ? (time - m_Time[a]) / span : 0.0f;
+        m_U[g] = u < 0.0f ? 0.0f : (u > 1.0f ? 1.0f : u);
+        m_Span[g] = span / 1000.0f;
+        for (int i = 0; i < 3; i++) {
+            m_P0[i][g] = m_Pos[i][a];
+            m_V0[i][g] = m_Vel[i][a];
+            m_P1[i][g] = m_Pos[i][b];
+            m_V1[i][g] = m_Vel[i][b];
+        }
+        for (int i = 0; i < 4; i++) {
+            m_Q0[i][g] = m_Rot[i][a];
+            m_Q1[i][g] = m_Rot[i][b];
+        }
+    }
+
+    // Cubic Hermite positions and normalized lerp rotations, the same curve the recorder checks against
+    for (size_t g = 0; g < count; g++) {
+        float u = m_U[g], u2 = u * u, u3 = u2 * u;
+        float h00 = 2 * u3 - 3 * u2 + 1, h01 = 3 * u2 - 2 * u3;
+        float h10 = (u3 - 2 * u2 + u) * m_Span[g], h11 = (u3 - u2) * m_Span[g];
+        for (int i = 0; i < 3; i++)
+            m_OutPos[i][g] = h00 * m_P0[i][g] + h10 * m_V0[i][g] + h01 * m_P1[i][g] + h11 * m_V1[i][g];
+
+        float dot = m_Q0[0][g] * m_Q1[0][g] + m_Q0[1][g] * m_Q1[1][g] + m_Q0[2][g] * m_Q1[2][g] + m_Q0[3][g] * m_Q1[3][g];
+        float w0 = 1.0f - u, w1 = dot < 0.0f ? -u : u;
+        float q[4], length = 0.0f;
+        for (int i = 0; i < 4; i++) {
+            q[i] = w0 * m_Q0[i][g] + w1 * m_Q1[i][g];
+            length += q[i] * q[i];
+        }
+        float scale = 1.0f / std::sqrt(length);
+        for (int i = 0; i < 4; i++)
+            m_OutRot[i][g] = q[i] * scale;
+    }
+}
+
+VxVector GhostPlayer::GetPosition(size_t ghost) const {
+    return {m_OutPos[0][ghost], m_OutPos[1][ghost], m_OutPos[2][ghost]};
+}
+
+VxQuaternion GhostPlayer::GetRotation(size_t ghost) const {
+    return {m_OutRot[0][ghost], m_OutRot[1][ghost], m_OutRot[2][ghost], m_OutRot[3][ghost]};
+}
+
+void GhostPlayer::Run() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (!m_Stop) {
+        lock.unlock();
+        bool progress = false;
+        for (size_t g = 0; g < m_Ghosts.size(); g++)
+            progress |= Fill(g);
+        lock.lock();
+
+        // Nothing to decode until the ghosts move on
+        if (!progress)
+            m_Wake.wait_for(lock, std::chrono::milliseconds(10), [this]() { return m_Stop; });
+    }
+}
+
+bool GhostPlayer::Fill(size_t g) {
+    Ghost &ghost = *m_Ghosts[g];
+    if (ghost.finished.load(std::memory_order_relaxed))
+        return false;
+
+    if (!ghost.opened) {
+        GhostRecord header;
+        ghost.opened = true;
+        if (!ghost.reader.Open(ghost.source, header)) {
+            ghost.finished.store(true, std::memory_order_release);
+            return true;
+        }
+    }
+
+    const size_t base = g * RING_KEYS;
+    size_t written = ghost.written.load(std::memory_order_relaxed);
+    size_t consumed = ghost.consumed.load(std::memory_order_acquire);
+    float horizon = m_PlayTime.load(std::memory_order_relaxed) + LOOKAHEAD;
+
+    // The slots of the played segment are never overwritten
+    bool progress = false;
+    while (written < consumed + RING_KEYS && (written == 0 || ghost.lastTime < horizon)) {
+        if (ghost.next >= ghost.chunk.states.size()) {
+            if (!ghost.reader.ReadChunk(ghost.chunk)) {
+                ghost.reader.Close();
+                ghost.written.store(written, std::memory_order_release);
+                ghost.finished.store(true, std::memory_order_release);
+                return true;
+            }
+            ghost.next = 0;
+            ghost.nextTrafo = 0;
+            continue;
+        }
+
+        auto &trafo = ghost.chunk.trafo;
+        while (ghost.nextTrafo < trafo.size() && trafo[ghost.nextTrafo].first <= (int) ghost.next)
+            ghost.chunkBall = trafo[ghost.nextTrafo++].second;
+
+        const auto &state = ghost.chunk.states[ghost.next++];
+        size_t slot = base + written % RING_KEYS;
+        m_Time[slot] = state.time;
+        const float pos[3] = {state.pos.x, state.pos.y, state.pos.z};
+        const float vel[3] = {state.vel.x, state.vel.y, state.vel.z};
+        const float rot[4] = {state.rot.x, state.rot.y, state.rot.z, state.rot.w};
+        for (int i = 0; i < 3; i++) {
+            m_Pos[i][slot] = pos[i];
+            m_Vel[i][slot] = vel[i];
+        }
+        for (int i = 0; i < 4; i++)
+            m_Rot[i][slot] = rot[i];
+        m_Ball[slot] = ghost.chunkBall;
+
+        ghost.lastTime = state.time;
+        written++;
+        progress = true;
+    }
+
+    ghost.written.store(written, std::memory_order_release);
+    return progress;
+}
+
+void GhostPlayer::Resize(size_t lanes) {
+    m_U.resize(lanes);
+    m_Span.resize(lanes);
+    for (int i = 0; i < 3; i++) {
+        m_P0[i].resize(lanes);
+        m_V0[i].resize(lanes);
+        m_P1[i].resize(lanes);
+        m_V1[i].resize(lanes);
+        m_OutPos[i].resize(lanes);
+    }
+    for (int i = 0; i < 4; i++) {
+        m_Q0[i].resize(lanes);
+        m_Q1[i].resize(lanes);
+        m_OutRot[i].resize(lanes);
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GhostFile.h"
+
+// Plays any number of ghosts at once, streaming them from their files. A worker thread decodes each
+// ghost chunk by chunk into a ring of RING_KEYS keyframes kept LOOKAHEAD ms ahead of the played one,
+// so memory does not depend on the length of the ghosts and playing starts without waiting for them.
+//
+// The rings of all ghosts are kept in one structure of arrays, and every frame the segments of all
+// ghosts are gathered into lanes and interpolated by a single loop without branches, so the compiler
+// can vectorize it.
+class GhostPlayer {
+public:
+    static constexpr size_t RING_KEYS = 1024;
+    static constexpr float LOOKAHEAD = 5000.0f;
+
+    GhostPlayer() = default;
+    GhostPlayer(const GhostPlayer &) = delete;
+    GhostPlayer &operator=(const GhostPlayer &) = delete;
+    ~GhostPlayer() { Stop(); }
+
+    void Start(const std::vector<GhostSource> &sources);
+    void Stop();
+
+    [[nodiscard]] size_t GetGhostCount() const { return m_Ghosts.size(); }
+
+    // Moves every ghost to the time in milliseconds since the start of their recording
+    void Update(float time);
+
+    // Whether the ghost has a state at the current time, it may still be waiting for its keyframes
+    [[nodiscard]] bool IsPlaying(size_t ghost) const { return m_Ghosts[ghost]->playing; }
+    [[nodiscard]] bool IsEnded(size_t ghost) const { return m_Ghosts[ghost]->ended; }
+    [[nodiscard]] int GetBall(size_t ghost) const { return m_Ghosts[ghost]->ball; }
+    [[nodiscard]] VxVector GetPosition(size_t ghost) const;
+    [[nodiscard]] VxQuaternion GetRotation(size_t ghost) const;
+
+private:
+    struct Ghost {
+        GhostSource source;
+
+        // Written by the worker, keyframes [0, written) have been decoded
+        std::atomic<size_t> written = 0;
+        std::atomic<bool> finished = false;
+        // Written by the game thread, the keyframe being played
+        std::atomic<size_t> consumed = 0;
+
+        // Game thread
+        size_t frame = 0;
+        int ball = -1;
+        bool playing = false;
+        bool ended = false;
+
+        // Worker
+        GhostReader reader;
+        bool opened = false;
+        GhostRecord chunk;
+        size_t next = 0;
+        size_t nextTrafo = 0;
+        int chunkBall = 0;
+        float lastTime = 0.0f;
+    };
+
+    void Run();
+    bool Fill(size_t ghost);
+    void Resize(size_t lanes);
+
+    std::vector<std::unique_ptr<Ghost>> m_Ghosts;
+
+    std::thread m_Worker;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    bool m_Stop = false;
+    std::atomic<float> m_PlayTime = 0.0f;
+
+    // Keyframe rings, ghost g owns the slots [g * RING_KEYS, (g + 1) * RING_KEYS)
+    std::vector<float> m_Time;
+    std::vector<float> m_Pos[3];
+    std::vector<float> m_Vel[3];
+    std::vector<float> m_Rot[4];
+    std::vector<int> m_Ball;
+
+    // One lane per ghost, the segment being played and the interpolated state
+    std::vector<float> m_U, m_Span;
+    std::vector<float> m_P0[3], m_V0[3], m_P1[3], m_V1[3];
+    std::vector<float> m_Q0[4], m_Q1[4];
+    std::vector<float> m_OutPos[3], m_OutRot[4];
+};
@@ -0,0 +1,134 @@
+#include "GhostTrack.h"
+
+#include <cmath>
+
+GhostRecord::State InterpolateState(const GhostRecord::State &a, const GhostRecord::State &b, float time) {
+    float span = b.time - a.time;
+    if (span <= 0.0f)
+        return a;
+
+    float u = (time - a.time) / span;
+    u = u < 0.0f ? 0.0f : (u > 1.0f ? 1.0f : u);
+    float u2 = u * u, u3 = u2 * u;
+    float seconds = span / 1000.0f;
+
+    GhostRecord::State state;
+    state.time = time;
+    state.pos = a.pos * (2 * u3 - 3 * u2 + 1) + a.vel * ((u3 - 2 * u2 + u) * seconds) +
+                b.pos * (3 * u2 - 2 * u3) + b.vel * ((u3 - u2) * seconds);
+    state.vel = a.vel + (b.vel - a.vel) * u;
+
+    // Normalized lerp along the short arc, cheap enough to run for many ghosts every frame
+    float dot = a.rot.x * b.rot.x + a.rot.y * b.rot.y + a.rot.z * b.rot.z + a.rot.w * b.rot.w;
+    float w0 = 1.0f - u, w1 = dot < 0.0f ? -u : u;
+    VxQuaternion rot(w0 * a.rot.x + w1 * b.rot.x, w0 * a.rot.y + w1 * b.rot.y,
+                     w0 * a.rot.z + w1 * b.rot.z, w0 * a.rot.w + w1 * b.rot.w);
+    float scale = 1.0f / std::sqrt(rot.x * rot.x + rot.y * rot.y + rot.z * rot.z + rot.w * rot.w);
+    state.rot = VxQuaternion(rot.x * scale, rot.y * scale, rot.z * scale, rot.w * scale);
+    return state;
+}
+
+void GhostCursor::Reset() {
+    m_Frame = 0;
+    m_Trafo = 0;
+    m_Ball = -1;
+}
+
+bool GhostCursor::Seek(const GhostRecord &record, float time, GhostRecord::State &state) {
+    const auto &states = record.states;
+    while (m_Frame + 1 < states.size() && states[m_Frame + 1].time <= time)
+        m_Frame++;
+
+    const auto &trafo = record.trafo;
+    while (m_Trafo < trafo.size() && trafo[m_Trafo].first <= (int) m_Frame)
+        m_Ball = trafo[m_Trafo++].second;
+
+    if (m_Frame + 1 >= states.size())
+        return false;
+    state = InterpolateState(states[m_Frame], states[m_Frame + 1], time);
+    return true;
+}
+
+void GhostSimplifier::SetTolerance(float position, float angle) {
+    m_PositionTolerance = position;
+    m_AngleCosine = std::cos(angle * PI / 360.0f);
+}
+
+void GhostSimplifier::Reset() {
+    m_Pending.clear();
+    m_HasPrev = false;
+    m_HasCur = false;
+}
+
+void GhostSimplifier::Add(float time, const VxVector &pos, const VxQuaternion &rot) {
+    if ((m_HasCur && time <= m_Cur.time) || (m_HasPrev && time <= m_Prev.time))
+        return;
+
+    GhostRecord::State sample;
+    sample.time = time;
+    sample.pos = pos;
+    sample.rot = rot;
+
+    if (m_HasCur) {
+        // The new sample completes the central difference of the current one
+        const GhostRecord::State &from = m_HasPrev ? m_Prev : m_Cur;
+        m_Cur.vel = (sample.pos - from.pos) * (1000.0f / (sample.time - from.time));
+        Process(m_Cur);
+        m_Prev = m_Cur;
+        m_HasPrev = true;
+    }
+
+    m_Cur = sample;
+    m_HasCur = true;
+}
+
+size_t GhostSimplifier::Split() {
+    if (m_HasCur) {
+        if (m_HasPrev)
+            m_Cur.vel = (m_Cur.pos - m_Prev.pos) * (1000.0f / (m_Cur.time - m_Prev.time));
+        Process(m_Cur);
+        m_Prev = m_Cur;
+        m_HasPrev = true;
+        m_HasCur = false;
+    }
+
+    EmitPending();
+    return m_Keys.empty() ? 0 : m_Keys.size() - 1;
+}
+
+void GhostSimplifier::Finish() {
+    Split();
+    m_HasPrev = false;
+}
+
+void GhostSimplifier::Process(const GhostRecord::State &sample) {
+    if (m_Keys.empty()) {
+        m_Keys.push_back(sample);
+        return;
+    }
+
+    if (m_Pending.size() >= MAX_PENDING || !Fits(m_Keys.back(), sample))
+        EmitPending();
+    m_Pending.push_back(sample);
+}
+
+bool GhostSimplifier::Fits(const GhostRecord::State &key, const GhostRecord::State &candidate) const {
+    const float tolerance = m_PositionTolerance * m_PositionTolerance;
+    for (const auto &sample : m_Pending) {
+        GhostRecord::State state = InterpolateState(key, candidate, sample.time);
+        if (SquareMagnitude(state.pos - sample.pos) > tolerance)
+            return false;
+        float dot = state.rot.x * sample.rot.x + state.rot.y * sample.rot.y +
+                    state.rot.z * sample.rot.z + state.rot.w * sample.rot.w;
+        if (std::fabs(dot) < m_AngleCosine)
+            return false;
+    }
+    return true;
+}
+
+void GhostSimplifier::EmitPending() {
+    if (!m_Pending.empty()) {
+        m_Keys.push_back(m_Pending.back());
+        m_Pending.clear();
+    }
+}
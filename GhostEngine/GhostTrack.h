@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include "GhostCodec.h"
+
+// Cubic Hermite interpolation of the position and normalized lerp of the rotation between two keyframes.
+// The time is clamped to the segment.
+GhostRecord::State InterpolateState(const GhostRecord::State &a, const GhostRecord::State &b, float time);
+
+// Plays a record held in memory. The keyframe being played is kept, so moving forward in time only
+// looks at the keyframes passed since the last call.
+class GhostCursor {
+public:
+    void Reset();
+
+    // Gives the state at the time in milliseconds, false once the time is past the last keyframe
+    bool Seek(const GhostRecord &record, float time, GhostRecord::State &state);
+
+    // Ball of the keyframe being played
+    [[nodiscard]] int GetBall() const { return m_Ball; }
+
+private:
+    size_t m_Frame = 0;
+    size_t m_Trafo = 0;
+    int m_Ball = -1;
+};
+
+// Turns a stream of per-tick samples into keyframes. A sample is only kept when leaving it out would
+// move some sample between the surrounding keyframes further than the tolerances from the curve
+// interpolated through them. Velocities are estimated from the neighbouring samples.
+class GhostSimplifier {
+public:
+    explicit GhostSimplifier(std::vector<GhostRecord::State> &keys) : m_Keys(keys) {}
+
+    void SetTolerance(float position, float angle);
+
+    void Reset();
+
+    // Samples must be added in increasing time order, older times are ignored
+    void Add(float time, const VxVector &pos, const VxQuaternion &rot);
+
+    // Makes the last added sample a keyframe, returns its index
+    size_t Split();
+
+    // Flushes all pending samples, to be called once the recording ends
+    void Finish();
+
+private:
+    void Process(const GhostRecord::State &sample);
+    bool Fits(const GhostRecord::State &key, const GhostRecord::State &candidate) const;
+    void EmitPending();
+
+    // Bounds the work done per sample and the length of a segment
+    static constexpr size_t MAX_PENDING = 128;
+
+    std::vector<GhostRecord::State> &m_Keys;
+    std::vector<GhostRecord::State> m_Pending;
+    GhostRecord::State m_Prev, m_Cur;
+    bool m_HasPrev = false;
+    bool m_HasCur = false;
+
+    float m_PositionTolerance = 0.05f;
+    float m_AngleCosine = 0.9996f;
+};
@@ -0,0 +1,106 @@
+#include "AttemptStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+void P2Quantile::Add(float x) {
+    float *q = m_state.heights;
+    int32_t *n = m_state.positions;
+
+    // The first samples are kept sorted until every marker has one
+    if (m_state.count < 5) {
+        q[m_state.count++] = x;
+        std::sort(q, q + m_state.count);
+        if (m_state.count == 5) {
+            for (int i = 0; i < 5; i++)
+                n[i] = i;
+        }
+        return;
+    }
+
+    int k;
+    if (x < q[0]) {
+        q[0] = x;
+        k = 0;
+    } else if (x >= q[4]) {
+        q[4] = x;
+        k = 3;
+    } else {
+        k = 0;
+        while (x >= q[k + 1])
+            k++;
+    }
+    for (int i = k + 1; i < 5; i++)
+        n[i]++;
+    m_state.count++;
+
+    // Desired positions of the markers for the samples seen so far
+    const float dn[5] = {0.0f, m_p / 2, m_p, (1 + m_p) / 2, 1.0f};
+    const float last = (float) (m_state.count - 1);
+    for (int i = 1; i < 4; i++) {
+        float d = dn[i] * last - (float) n[i];
+        if ((d >= 1.0f && n[i + 1] - n[i] > 1) || (d <= -1.0f && n[i - 1] - n[i] < -1)) {
+            int s = d > 0 ? 1 : -1;
+            float parabolic = q[i] + (float) s / (float) (n[i + 1] - n[i - 1]) *
+                                     ((float) (n[i] - n[i - 1] + s) * (q[i + 1] - q[i]) / (float) (n[i + 1] - n[i]) +
+                                      (float) (n[i + 1] - n[i] - s) * (q[i] - q[i - 1]) / (float) (n[i] - n[i - 1]));
+            if (q[i - 1] < parabolic && parabolic < q[i + 1])
+                q[i] = parabolic;
+            else
+                q[i] += (float) s * (q[i + s] - q[i]) / (float) (n[i + s] - n[i]);
+            n[i] += s;
+        }
+    }
+}
+
+float P2Quantile::Get() const {
+    if (m_state.count == 0)
+        return 0;
+    if (m_state.count < 5)
+        return m_state.heights[(size_t) std::lround(m_p * (float) (m_state.count - 1))];
+    return m_state.heights[2];
+}
+
+void AttemptStats::Add(float time) {
+    Summary &s = m_summary;
+    s.count++;
+    s.best = s.count == 1 ? time : (std::min)(s.best, time);
+    float delta = time - s.mean;
+    s.mean += delta / (float) s.count;
+    s.m2 += delta * (time - s.mean);
+    m_p50.Add(time);
+    m_p90.Add(time);
+    Push(time);
+}
+
+float AttemptStats::GetStdDev() const {
+    return m_summary.count > 1 ? std::sqrt(m_summary.m2 / (float) (m_summary.count - 1)) : 0.0f;
+}
+
+float AttemptStats::GetConsistency() const {
+    if (m_summary.count < 2 || m_summary.mean <= 0.0f)
+        return 100.0f;
+    return std::clamp(100.0f * (1.0f - GetStdDev() / m_summary.mean), 0.0f, 100.0f);
+}
+
+AttemptStats::Summary AttemptStats::GetSummary() const {
+    Summary summary = m_summary;
+    summary.p50 = m_p50.GetState();
+    summary.p90 = m_p90.GetState();
+    return summary;
+}
+
+void AttemptStats::Restore(const Summary &summary, const float *times, size_t count) {
+    Clear();
+    m_summary = summary;
+    m_p50.SetState(summary.p50);
+    m_p90.SetState(summary.p90);
+    for (size_t i = count > CAPACITY ? count - CAPACITY : 0; i < count; i++)
+        Push(times[i]);
+}
+
+void AttemptStats::Push(float time) {
+    m_ring[m_ringHead] = time;
+    m_ringHead = (m_ringHead + 1) % CAPACITY;
+    m_ringSize = (std::min)(m_ringSize + 1, CAPACITY);
+}
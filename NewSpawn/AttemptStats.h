@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Streaming estimate of a quantile with the P-square algorithm: five markers follow the minimum,
+// the quantile, the maximum and the quantiles halfway between, and are moved along a parabola as
+// samples arrive. Constant memory and time per sample whatever their number.
+class P2Quantile {
+public:
+    explicit P2Quantile(float p = 0.5f) : m_p(p) {}
+
+    void Add(float x);
+    [[nodiscard]] float Get() const;
+
+    // Markers, enough to resume the estimate
+    struct State {
+        uint32_t count = 0;
+        float heights[5] = {};
+        int32_t positions[5] = {};
+    };
+    [[nodiscard]] const State &GetState() const { return m_state; }
+    void SetState(const State &state) { m_state = state; }
+
+private:
+    float m_p;
+    State m_state;
+};
+
+// Times of the completed attempts of a spawn slot. The last CAPACITY times are kept in a ring for the
+// sparkline, while the statistics cover every attempt and are updated in constant time by each one:
+// best, mean and variance by Welford's method, and the median and 90th percentile by P-square.
+class AttemptStats {
+public:
+    static constexpr size_t CAPACITY = 128;
+
+    void Add(float time);
+    void Clear() { *this = AttemptStats(); }
+
+    [[nodiscard]] uint32_t GetCount() const { return m_summary.count; }
+    [[nodiscard]] float GetBest() const { return m_summary.best; }
+    [[nodiscard]] float GetMean() const { return m_summary.mean; }
+    [[nodiscard]] float GetStdDev() const;
+    [[nodiscard]] float GetMedian() const { return m_p50.Get(); }
+    [[nodiscard]] float GetP90() const { return m_p90.Get(); }
+
+    // 100 when every attempt takes the same time, lower as they spread relative to their mean
+    [[nodiscard]] float GetConsistency() const;
+
+    // Ring of the last times, oldest first from GetRingStart
+    [[nodiscard]] const float *GetRing() const { return m_ring; }
+    [[nodiscard]] size_t GetRingSize() const { return m_ringSize; }
+    [[nodiscard]] size_t GetRingStart() const { return m_ringSize < CAPACITY ? 0 : m_ringHead; }
+
+    // Everything but the ring, written as is by the store
+    struct Summary {
+        uint32_t count = 0;
+        float best = 0;
+        float mean = 0;
+        float m2 = 0;
+        P2Quantile::State p50;
+        P2Quantile::State p90;
+    };
+    [[nodiscard]] Summary GetSummary() const;
+    // Restores the statistics and the ring, times oldest first
+    void Restore(const Summary &summary, const float *times, size_t count);
+
+private:
+    void Push(float time);
+
+    Summary m_summary;
+    P2Quantile m_p50{0.5f};
+    P2Quantile m_p90{0.9f};
+
+    float m_ring[CAPACITY] = {};
+    size_t m_ringHead = 0;
+    size_t m_ringSize = 0;
+};
@@ -38,7 +38,27 @@ void NewSpawn::OnLoad() {
     prop_key_record->SetComment("Set your shortcut key for saving the spirit record");
     key_record = prop_key_record->GetKey();
 
+    prop_key_slot = GetConfig()->GetProperty("Main", "Next_Slot");
+    prop_key_slot->SetDefaultKey(CKKEY_B);
+    prop_key_slot->SetComment("Set your shortcut key for switching to the next spawn slot");
+    key_slot = prop_key_slot->GetKey();
+
+    prop_play_best = GetConfig()->GetProperty("Main", "Play_Best");
+    prop_play_best->SetDefaultBoolean(true);
+    prop_play_best->SetComment("Play the best attempt of the spawn slot (Yes) or the last one (No)");
+
+    prop_show_stats = GetConfig()->GetProperty("Main", "Show_Stats");
+    prop_show_stats->SetDefaultBoolean(true);
+    prop_show_stats->SetComment("Show the attempt statistics of the selected spawn slot");
+
     input_manager = m_BML->GetInputManager();
+
+    VxMakeDirectory("..\\ModLoader\\NewSpawn\\");
+    m_store.Start("..\\ModLoader\\NewSpawn\\");
+}
+
+void NewSpawn::OnUnload() {
+    m_store.Stop();
 }
 
 void NewSpawn::OnModifyConfig(const char *category, const char *key, IProperty *prop) {
@@ -51,6 +71,9 @@ void NewSpawn::OnModifyConfig(const char *category, const char *key, IProperty *
     if (prop == prop_key_record) {
         key_record = prop->GetKey();
     }
+    if (prop == prop_key_slot) {
+        key_slot = prop->GetKey();
+    }
 }
 
 void NewSpawn::OnLoadScript(const char *filename, CKBehavior *script) {
@@ -97,39 +120,7 @@ void NewSpawn::OnLoadObject(const char *filename, CKBOOL isMap, const char *mast
                             CKBOOL addtoscene, CKBOOL reuseMeshes, CKBOOL reuseMaterials, CKBOOL dynamic,
                             XObjectArray *objArray, CKObject *masterObj) {
     if (!strcmp(filename, "3D Entities\\Balls.nmo")) {
-        CKDataArray *physBall = m_BML->GetArrayByName("Physicalize_GameBall");
-        for (int i = 0; i < physBall->GetRowCount(); i++) {
-            SpiritBall ball;
-            ball.name.resize(physBall->GetElementStringValue(i, 0, nullptr), '\0');
-            physBall->GetElementStringValue(i, 0, &ball.name[0]);
-            ball.name.pop_back();
-            ball.obj = m_BML->Get3dObjectByName(ball.name.c_str());
-
-            CKDependencies dep;
-            dep.Resize(40);
-            dep.Fill(0);
-            dep.m_Flags = CK_DEPENDENCIES_CUSTOM;
-            dep[CKCID_OBJECT] = CK_DEPENDENCIES_COPY_OBJECT_NAME | CK_DEPENDENCIES_COPY_OBJECT_UNIQUENAME;
-            dep[CKCID_MESH] = CK_DEPENDENCIES_COPY_MESH_MATERIAL;
-            dep[CKCID_3DENTITY] = CK_DEPENDENCIES_COPY_3DENTITY_MESH;
-            ball.obj = static_cast<CK3dObject *>(m_BML->GetCKContext()->CopyObject(ball.obj, &dep, "_Spirit"));
-            for (int j = 0; j < ball.obj->GetMeshCount(); j++) {
-                CKMesh *mesh = ball.obj->GetMesh(j);
-                for (int k = 0; k < mesh->GetMaterialCount(); k++) {
-                    CKMaterial *mat = mesh->GetMaterial(k);
-                    mat->EnableAlphaBlend();
-                    mat->SetSourceBlend(VXBLEND_SRCALPHA);
-                    mat->SetDestBlend(VXBLEND_INVSRCALPHA);
-                    VxColor color = mat->GetDiffuse();
-                    color.a = 0.5f;
-                    mat->SetDiffuse(color);
-                    ball.materials.push_back(mat);
-                    m_BML->SetIC(mat);
-                }
-            }
-            m_dualBalls.push_back(ball);
-        }
-
+        m_balls.Load(m_BML, "NewSpawn");
         GetLogger()->Info("Created Newspawn Spirit Balls");
     }
 
@@ -137,79 +128,207 @@ void NewSpawn::OnLoadObject(const char *filename, CKBOOL isMap, const char *mast
         return;
 
     set_map_filename_curlevel(filename);
+    m_slots.clear();
+    m_selectedSlot = SIZE_MAX;
+    m_slotsLoaded = false;
+    m_store.Load(filename);
 }
 
-int NewSpawn::GetCurrentBall() {
-    //get and return the balltype number
-    CKObject *ball = m_curLevel->GetElementObject(0, 1);
-    if (ball) {
-        const std::string ballName = ball->GetName();
-        const int count = static_cast<int>(m_dualBalls.size());
-        for (int i = 0; i < count; i++) {
-            if (m_dualBalls[i].name == ballName)
-                return i;
-        }
+SpawnSlot *NewSpawn::FindSlot(const std::string &name) {
+    for (auto &slot : m_slots) {
+        if (slot.name == name)
+            return &slot;
+    }
+    return nullptr;
+}
+
+bool NewSpawn::SetSlot(const std::string &name, const VxMatrix &matrix, int sector, int ball_type) {
+    SpawnSlot *slot = FindSlot(name);
+    if (!slot) {
+        if (m_slots.size() >= MAX_SLOTS)
+            return false;
+        slot = &m_slots.emplace_back();
+        slot->name = name;
+    } else if (slot->sector != sector || memcmp(&slot->matrix, &matrix, sizeof(VxMatrix)) != 0) {
+        // Ghosts of another spawn point are no use
+        slot->best.reset();
+        slot->last.reset();
+        slot->best_time = slot->last_time = 0;
+        slot->stats.Clear();
+    }
+
+    slot->matrix = matrix;
+    slot->sector = sector;
+    slot->ball_type = ball_type;
+    m_selectedSlot = slot - m_slots.data();
+    SaveSlots();
+    return true;
+}
+
+bool NewSpawn::SelectSlot(const std::string &name) {
+    SpawnSlot *slot = FindSlot(name);
+    if (!slot)
+        return false;
+    m_selectedSlot = slot - m_slots.data();
+    return true;
+}
+
+bool NewSpawn::DeleteSlot(const std::string &name) {
+    SpawnSlot *slot = FindSlot(name);
+    if (!slot)
+        return false;
+
+    size_t index = slot - m_slots.data();
+    m_slots.erase(m_slots.begin() + index);
+    if (m_selectedSlot == index || m_selectedSlot >= m_slots.size())
+        m_selectedSlot = m_slots.empty() ? SIZE_MAX : 0;
+    else if (m_selectedSlot > index)
+        m_selectedSlot--;
+    SaveSlots();
+    return true;
+}
+
+void NewSpawn::SaveSlots() {
+    // Saving before the slots are read would drop those on disk
+    if (m_slotsLoaded)
+        m_store.Save(get_map_filename_curlevel(), m_slots);
+}
+
+void NewSpawn::DrawStats() {
+    const SpawnSlot *slot = get_selected_slot();
+    if (!slot || slot->stats.GetCount() == 0)
+        return;
+
+    //[spirit] The text only changes with the slot or an attempt
+    const AttemptStats &stats = slot->stats;
+    if (m_statsName != slot->name || m_statsCount != stats.GetCount()) {
+        m_statsName = slot->name;
+        m_statsCount = stats.GetCount();
+        char text[256];
+        snprintf(text, sizeof(text),
+                 "%s: %u attempts\nBest %.3f  Mean %.3f\nP50 %.3f  P90 %.3f\nConsistency %.0f%%",
+                 slot->name.c_str(), stats.GetCount(), stats.GetBest() / 1000, stats.GetMean() / 1000,
+                 stats.GetMedian() / 1000, stats.GetP90() / 1000, stats.GetConsistency());
+        m_statsText = text;
     }
-    return 0;
+
+    Bui::ImGuiContextScope scope;
+
+    const ImVec2 &vpSize = ImGui::GetMainViewport()->Size;
+    ImGui::SetNextWindowPos(ImVec2(vpSize.x * 0.01f, vpSize.y * 0.3f));
+    ImGui::SetNextWindowBgAlpha(0.5f);
+
+    constexpr ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+                                       ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_NoSavedSettings |
+                                       ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoBringToFrontOnFocus;
+    if (ImGui::Begin("NewSpawn_Stats", nullptr, flags)) {
+        ImGui::TextUnformatted(m_statsText.c_str());
+        //[spirit] Times of the last attempts, oldest on the left
+        if (stats.GetRingSize() > 1)
+            ImGui::PlotLines("##Attempts", stats.GetRing(), (int) stats.GetRingSize(), (int) stats.GetRingStart(),
+                             nullptr, FLT_MAX, FLT_MAX, ImVec2(vpSize.x * 0.15f, vpSize.y * 0.05f));
+    }
+    ImGui::End();
 }
 
-void NewSpawn::SetCurrentBall(int curBall) {
-    m_playBall = curBall;
-    for (auto &ball: m_dualBalls)
-        ball.obj->Show(CKHIDE);
+int NewSpawn::GetCurrentBall() {
+    //get and return the balltype number
+    CKObject *ball = m_curLevel->GetElementObject(0, 1);
+    return ball ? m_balls.GetBallType(ball->GetName()) : 0;
 }
 
 void NewSpawn::StopRecording(bool save_data) {
-    m_isRecording = false;
-    if (save_data) {
-        m_play = m_record;
-        record_exist = true;
-    } else {
-        m_record.trafo.clear();
-        m_record.trafo.shrink_to_fit();
-        m_record.states.clear();
-        m_record.states.shrink_to_fit();
+    // Only an attempt still being recorded is saved, once
+    if (save_data && m_isRecording) {
+        // The attempt is moved into a ghost the slot shares as its last and maybe best attempt
+        SpawnSlot *slot = FindSlot(m_recordSlot);
+        if (slot) {
+            m_simplifier.Finish();
+            m_record.srscore = m_srtimer;
+            auto attempt = std::make_shared<const Record>(std::move(m_record));
+            slot->last = attempt;
+            slot->last_time = m_srtimer;
+            if (!slot->best || m_srtimer < slot->best_time) {
+                slot->best = attempt;
+                slot->best_time = m_srtimer;
+            }
+            slot->stats.Add(m_srtimer);
+            SaveSlots();
+        }
     }
+
+    m_isRecording = false;
+    m_simplifier.Reset();
+    m_record.trafo.clear();
+    m_record.trafo.shrink_to_fit();
+    m_record.states.clear();
+    m_record.states.shrink_to_fit();
 }
 
 void NewSpawn::StopPlaying() {
     m_isPlaying = false;
-
-    for (auto &ball: m_dualBalls)
-        ball.obj->Show(CKHIDE);
+    m_play.reset();
+    m_balls.HideAll();
 }
 
 void NewSpawn::StartRecording() {
     m_isRecording = true;
-    m_recordTimer = 0;
     m_srtimer = 0;
     m_curBall = GetCurrentBall();
+    m_simplifier.Reset();
     m_record.trafo.emplace_back(0, m_curBall);
 }
 
 void NewSpawn::StartPlaying() {
-    if (record_exist) {
+    SpawnSlot *slot = FindSlot(m_recordSlot);
+    if (slot)
+        m_play = prop_play_best->GetBoolean() || !slot->last ? slot->best : slot->last;
+    if (m_play && !m_play->states.empty()) {
         m_isPlaying = true;
-        m_playTimer = -1000.0f / TICK_SPEED;
-        m_playFrame = 0;
-        m_playTrafo = 1;
-        SetCurrentBall(m_play.trafo[0].second);
+        m_playTimer = 0;
+        m_cursor.Reset();
+        m_balls.HideAll();
     }
 }
 
 void NewSpawn::OnProcess() {
+    //[transport] Slots saved for this map, those set while they were read win
+    std::vector<SpawnSlot> loaded;
+    if (m_store.Poll(loaded)) {
+        bool changed = !m_slots.empty();
+        for (auto &slot : loaded) {
+            if (!FindSlot(slot.name) && m_slots.size() < MAX_SLOTS)
+                m_slots.push_back(std::move(slot));
+        }
+        if (m_selectedSlot >= m_slots.size() && !m_slots.empty())
+            m_selectedSlot = 0;
+
+        m_slotsLoaded = true;
+        if (changed)
+            SaveSlots();
+    }
+
     if (!(enabled && m_BML->IsCheatEnabled() && m_BML->IsPlaying()))
         return;
+
+    if (prop_show_stats->GetBoolean())
+        DrawStats();
+
+    if (input_manager->IsKeyPressed(key_slot) && !m_slots.empty()) {
+        m_selectedSlot = m_selectedSlot + 1 < m_slots.size() ? m_selectedSlot + 1 : 0;
+        m_BML->SendIngameMessage(("Switched to nsp slot " + m_slots[m_selectedSlot].name).c_str());
+    }
+
     if (input_manager->IsKeyPressed(key_prop) && Ball_Active) {
-        //[transport] no nsp or no set level: return
-        if (!(cmdspawnp_ptr->get_is_spawned())) {
+        //[transport] no nsp point in this level: return
+        const SpawnSlot *spawn = get_selected_slot();
+        if (!spawn) {
             m_BML->SendIngameMessage("You have not set up a nsp point.");
             return;
         }
-        if (cmdspawnp_ptr->get_map_filename_setlevel() != get_map_filename_curlevel()) {
-            m_BML->SendIngameMessage("the nsp point you set is not in this level.");
-            return;
-        }
+        const VxMatrix spawn_matrix = spawn->matrix;
+        const int spawn_ball_type = spawn->ball_type;
+        m_recordSlot = spawn->name;
 
         //[spirit] Make sure you reset the ball before saving the replay
         record_save_enable = true;
@@ -219,7 +338,7 @@ void NewSpawn::OnProcess() {
         StopPlaying();
 
         //[transport] Get the sector at the time of /nsp
-        int set_sector = cmdspawnp_ptr->get_curSector();
+        int set_sector = spawn->sector;
         //[transport] Get the current sector
         CKBehavior *events = m_BML->GetScriptByName("Gameplay_Events");
         int cur_sector = ScriptHelper::GetParamValue<int>(
@@ -308,10 +427,10 @@ void NewSpawn::OnProcess() {
         m_dynamicPos->Activate();
         auto current_ball = get_curBall();
 
-        m_BML->AddTimer(2ul, [this, current_ball, mm, ballDeact]() {
+        m_BML->AddTimer(2ul, [this, current_ball, mm, ballDeact, spawn_matrix, spawn_ball_type]() {
             ExecuteBB::Unphysicalize(current_ball);
 
-            auto matrix = cmdspawnp_ptr->get_matrix();
+            auto matrix = spawn_matrix;
 
             current_ball->SetWorldMatrix(matrix);
             CK3dEntity *camMF = m_BML->Get3dEntityByName("Cam_MF");
@@ -330,7 +449,7 @@ void NewSpawn::OnProcess() {
             CK3dEntity *curBall = get_curBall();
             ExecuteBB::Unphysicalize(curBall);
             static char trafoTypes[3][6] = {"paper", "wood", "stone"};
-            SetParamString(m_curTrafo, trafoTypes[cmdspawnp_ptr->get_ball_type()]);
+            SetParamString(m_curTrafo, trafoTypes[spawn_ball_type]);
             m_setNewBall->ActivateInput(0);
             m_setNewBall->Activate();
             GetLogger()->Info("NewSpawn Reset Ball");
@@ -346,32 +465,27 @@ void NewSpawn::OnProcess() {
     if (!spirit_enabled)
         return;
 
-    constexpr float delta = 1000.0f / TICK_SPEED;
-
-    //[spirit] Recording
+    //[spirit] Recording, ball transformations always get keyframes of their own: the last sample of the
+    // old ball and the first sample of the new one, where playback switches
     if (m_isRecording) {
         m_srtimer += m_BML->GetTimeManager()->GetLastDeltaTime();
 
-        m_recordTimer += m_BML->GetTimeManager()->GetLastDeltaTime();
-        m_recordTimer = (std::min)(m_recordTimer, 1000.0f);
-
-        while (m_recordTimer > 0) {
-            m_recordTimer -= delta;
-
-            int curBall = GetCurrentBall();
-            if (curBall != m_curBall)
-                m_record.trafo.emplace_back(m_record.states.size(), curBall);
-
-            m_curBall = curBall;
-
-            auto *ball = static_cast<CK3dObject *>(m_curLevel->GetElementObject(0, 1));
-            if (ball) {
-                Record::State state;
-                ball->GetPosition(&state.pos);
-                ball->GetQuaternion(&state.rot);
-                m_record.states.push_back(state);
-            }
+        int curBall = GetCurrentBall();
+        bool transformed = curBall != m_curBall;
+        if (transformed)
+            m_simplifier.Split();
+        m_curBall = curBall;
+
+        auto *ball = static_cast<CK3dObject *>(m_curLevel->GetElementObject(0, 1));
+        if (ball) {
+            VxVector pos;
+            VxQuaternion rot;
+            ball->GetPosition(&pos);
+            ball->GetQuaternion(&rot);
+            m_simplifier.Add(m_srtimer, pos, rot);
         }
+        if (transformed)
+            m_record.trafo.emplace_back(m_simplifier.Split(), curBall);
         if (m_srtimer > 1000 * 1800) {
             GetLogger()->Info("NewSpawn Record is longer than half hour, stop recording");
             StopPlaying();
@@ -382,47 +496,20 @@ void NewSpawn::OnProcess() {
     //[spirit] Playing
     if (m_isPlaying) {
         m_playTimer += m_BML->GetTimeManager()->GetLastDeltaTime();
-        m_playTimer = (std::min)(m_playTimer, 1000.0f);
-
-        while (m_playTimer > 0) {
-            m_playTimer -= delta;
-            m_playFrame++;
-
-            auto &trafos = m_play.trafo;
-            if (m_playTrafo < trafos.size()) {
-                auto &trafo = trafos[m_playTrafo];
-                if (m_playFrame == trafo.first) {
-                    SetCurrentBall(trafo.second);
-                    m_playTrafo++;
-                }
-            }
-        }
 
-        auto &states = m_play.states;
-        if (m_playFrame < states.size() - 1) {
-            if (m_playFrame >= 1) {
-                if (m_playBall >= 0 && m_playBall < m_dualBalls.size()) {
-                    CKObject *playerBall = m_curLevel->GetElementObject(0, 1);
-                    CK3dObject *ball = m_dualBalls[m_playBall].obj;
-                    ball->Show(playerBall->IsVisible() ? CKSHOW : CKHIDE);
-
-                    const float portion = (m_playTimer / delta + 1);
-                    const Record::State &cur = states[m_playFrame];
-                    Record::State &next = states[m_playFrame + 1];
-                    const VxVector position = (next.pos - cur.pos) * portion + cur.pos;
-                    const VxQuaternion rotation = Slerp(portion, cur.rot, next.rot);
-                    ball->SetPosition(&position);
-                    ball->SetQuaternion(&rotation);
-                }
-            }
+        Record::State state;
+        if (m_cursor.Seek(*m_play, m_playTimer, state)) {
+            CKObject *playerBall = m_curLevel->GetElementObject(0, 1);
+            m_balls.Show(0, m_cursor.GetBall(), playerBall->IsVisible(), state.pos, state.rot);
         } else StopPlaying();
     }
 
     //[spirit] Recording saving
     if (input_manager->IsKeyPressed(key_record)) {
-        if (record_save_enable) {
+        if (record_save_enable && m_isRecording) {
             StopPlaying();
             StopRecording(true);
+            record_save_enable = false;
             m_BML->SendIngameMessage("record is updated.");
         } else {
             m_BML->SendIngameMessage("Please use transport shortcut key to reset the ball position first.");
@@ -431,33 +518,66 @@ void NewSpawn::OnProcess() {
 }
 
 void CommandNewSpawn::Execute(IBML *bml, const std::vector<std::string> &args) {
+    if (args.size() >= 3 && (args[1] == "select" || args[1] == "delete")) {
+        bool done = args[1] == "select" ? mod->SelectSlot(args[2]) : mod->DeleteSlot(args[2]);
+        bml->SendIngameMessage(((done ? (args[1] == "select" ? "Selected nsp slot " : "Deleted nsp slot ")
+                                      : "No nsp slot named ") + args[2]).c_str());
+    } else if (args.size() == 2 && args[1] == "list") {
+        const SpawnSlot *selected = mod->get_selected_slot();
+        for (auto &slot : mod->get_slots()) {
+            std::string line = (&slot == selected ? "* " : "  ") + slot.name + " (sector " + std::to_string(slot.sector) + ")";
+            if (slot.best)
+                line += ", best " + std::to_string(slot.best_time / 1000.0f) + "s, last " + std::to_string(slot.last_time / 1000.0f) + "s";
+            bml->SendIngameMessage(line.c_str());
+        }
+        if (mod->get_slots().empty())
+            bml->SendIngameMessage("No nsp slot in this level.");
+    } else if (args.size() <= 2) {
+        //set the named slot, the selected one when no name is given
+        const SpawnSlot *selected = mod->get_selected_slot();
+        SetSpawn(bml, args.size() == 2 ? args[1] : (selected ? selected->name : "1"));
+    } else {
+        bml->SendIngameMessage("Usage: nsp [name] | nsp list | nsp select <name> | nsp delete <name>");
+    }
+}
+
+void CommandNewSpawn::SetSpawn(IBML *bml, const std::string &name) {
     if (bml->IsIngame()) {
         //get spawn position
         CK3dEntity *camRef = bml->Get3dEntityByName("Cam_OrientRef");
-        matrix = camRef->GetWorldMatrix();
+        VxMatrix matrix = camRef->GetWorldMatrix();
         for (int i = 0; i < 4; i++) {
             std::swap(matrix[0][i], matrix[2][i]);
             matrix[0][i] = -matrix[0][i];
         }
         //get spawn sector
         CKBehavior *events = bml->GetScriptByName("Gameplay_Events");
-        set_curSector(ScriptHelper::GetParamValue<int>(
-            ScriptHelper::FindNextBB(events, events->GetInput(0))->GetOutputParameter(0)->GetDestination(0)));
+        int sector = ScriptHelper::GetParamValue<int>(
+            ScriptHelper::FindNextBB(events, events->GetInput(0))->GetOutputParameter(0)->GetDestination(0));
         //get spawn ball type
-        ball_type = ball_name_to_id[mod->get_curBall()->GetName()];
+        int ball_type = ball_name_to_id[mod->get_curBall()->GetName()];
+
+        if (!mod->SetSlot(name, matrix, sector, ball_type)) {
+            bml->SendIngameMessage(("Too many nsp slots, at most " + std::to_string(NewSpawn::MAX_SLOTS)).c_str());
+            return;
+        }
 
-        bml->SendIngameMessage(("Set NSpawn Point to (sector "
-                                + std::to_string(get_curSector()) + ", position "
+        bml->SendIngameMessage(("Set NSpawn Point " + name + " to (sector "
+                                + std::to_string(sector) + ", position "
                                 + std::to_string(matrix[3][0]) + ", "
                                 + std::to_string(matrix[3][1]) + ", "
                                 + std::to_string(matrix[3][2]) + ")").c_str());
-        //get spawn level and is spawned
-        ///
-        set_map_filename_setlevel(mod->get_map_filename_curlevel());
-        set_is_spawned(true);
     }
 }
 
 const std::vector<std::string> CommandNewSpawn::GetTabCompletion(IBML *bml, const std::vector<std::string> &args) {
-    return {};
+    if (args.size() == 2)
+        return {"list", "select", "delete"};
+
+    std::vector<std::string> names;
+    if (args.size() == 3 && (args[1] == "select" || args[1] == "delete")) {
+        for (auto &slot : mod->get_slots())
+            names.push_back(slot.name);
+    }
+    return names;
 }
@@ -1,7 +1,9 @@
 #pragma once
 #include <BML/BMLAll.h>
 
-#define TICK_SPEED 8
+#include "GhostBalls.h"
+#include "GhostTrack.h"
+#include "SpawnStore.h"
 
 MOD_EXPORT IMod *BMLEntry(IBML *bml);
 MOD_EXPORT void BMLExit(IMod *mod);
@@ -22,30 +24,10 @@ public:
 
     const std::vector<std::string> GetTabCompletion(IBML *bml, const std::vector<std::string> &args) override;
 
-    const VxMatrix &get_matrix() const { return matrix; }
-    void set_matrix(const VxMatrix &mat) { matrix = mat; }
-    int get_curSector() const { return curSector; }
-    void set_curSector(const int sec) { curSector = sec; }
-
-    int get_ball_type() const { return ball_type; }
-    void set_ball_type(const int type) { ball_type = type; }
-
-    bool get_is_spawned() const { return is_spawned; }
-    void set_is_spawned(const bool type) { is_spawned = type; }
-
-    const std::string &get_map_filename_setlevel() const { return map_filename; }
-    void set_map_filename_setlevel(const std::string &type) { map_filename = type; }
-
 private:
-    NewSpawn *mod = nullptr;
-
-    VxMatrix matrix = {};
-    int curSector = {};
-    int ball_type = {};
+    void SetSpawn(IBML *bml, const std::string &name);
 
-    bool is_spawned = false;
-
-    std::string map_filename;
+    NewSpawn *mod = nullptr;
 };
 
 class NewSpawn : public IMod {
@@ -57,13 +39,14 @@ public:
     const char *GetName() override { return "NewSpawn"; }
     const char *GetAuthor() override { return "fluoresce"; }
     const char *GetDescription() override {
-        return "\"nsp\" to set a position. shortcut key to tp to the position. "
+        return "\"nsp [name]\" to set a position. shortcut key to tp to the position. "
                 " Thanks for the help of BallanceBug and Swung ";
     }
     DECLARE_BML_VERSION;
 
     //[transport]
     void OnLoad() override;
+    void OnUnload() override;
     void OnProcess() override;
     void OnModifyConfig(const char *category, const char *key, IProperty *prop) override;
     void OnLoadScript(const char *filename, CKBehavior *script) override;
@@ -99,9 +82,22 @@ public:
     std::string get_map_filename_curlevel() { return map_filename_curlevel; }
     void set_map_filename_curlevel(const std::string &type) { map_filename_curlevel = type; }
 
+    //[transport] Spawn slots of the current map
+    static constexpr size_t MAX_SLOTS = 16;
+    const std::vector<SpawnSlot> &get_slots() const { return m_slots; }
+    const SpawnSlot *get_selected_slot() const {
+        return m_selectedSlot < m_slots.size() ? &m_slots[m_selectedSlot] : nullptr;
+    }
+    bool SetSlot(const std::string &name, const VxMatrix &matrix, int sector, int ball_type);
+    bool SelectSlot(const std::string &name);
+    bool DeleteSlot(const std::string &name);
+
 private:
+    SpawnSlot *FindSlot(const std::string &name);
+    void SaveSlots();
+    void DrawStats();
+
     int GetCurrentBall();
-    void SetCurrentBall(int curBall);
 
     void StopPlaying();
     void StopRecording(bool save_data = false);
@@ -121,9 +117,13 @@ private:
     IProperty *prop_key = nullptr;
     IProperty *reset_spirit_enabled = nullptr;
     IProperty *prop_key_record = nullptr;
+    IProperty *prop_key_slot = nullptr;
+    IProperty *prop_play_best = nullptr;
+    IProperty *prop_show_stats = nullptr;
     InputHook *input_manager = nullptr;
     CKKEYBOARD key_prop = {};
     CKKEYBOARD key_record = {};
+    CKKEYBOARD key_slot = {};
     bool enabled = false;
     bool reset_enabled = false;
     bool spirit_enabled = false;
@@ -144,40 +144,37 @@ private:
     //[transport] Map filename
     std::string map_filename_curlevel;
 
+    //[transport] Slots are read on map load and written on change by the store, both in the background
+    SpawnStore m_store;
+    std::vector<SpawnSlot> m_slots;
+    size_t m_selectedSlot = SIZE_MAX;
+    bool m_slotsLoaded = false;
+
+    //[spirit] Text of the statistics of the selected slot, and the slot and attempts it was made for
+    std::string m_statsText;
+    std::string m_statsName;
+    uint32_t m_statsCount = 0;
+
     //[spirit]
     bool m_isRecording = false;
     bool m_isPlaying = false;
 
-    bool record_exist = false;
     bool record_save_enable = false;
 
-    float m_recordTimer = {};
     float m_playTimer = {};
     float m_srtimer = {};
 
-    struct SpiritBall {
-        std::string name;
-        CK3dObject *obj;
-        std::vector<CKMaterial *> materials;
-    };
-
-    std::vector<SpiritBall> m_dualBalls;
-
-    struct Record {
-        struct State {
-            VxVector pos;
-            VxQuaternion rot;
-        };
+    //[spirit] Balls of the ghost, their meshes are shared with Spirit Trail
+    GhostBalls m_balls;
 
-        std::vector<State> states;
-        std::vector<std::pair<int, int>> trafo;
-    };
+    using Record = GhostRecord;
 
+    //[spirit] The attempt being recorded, and the ghost played, shared with its slot
     Record m_record = {};
-    Record m_play = {};
+    GhostSimplifier m_simplifier{m_record.states};
+    std::shared_ptr<const Record> m_play;
+    GhostCursor m_cursor;
+    std::string m_recordSlot;
 
-    size_t m_playBall= {};
-    size_t m_curBall= {};
-    size_t m_playFrame = {};
-    size_t m_playTrafo = {};
+    int m_curBall = {};
 };
\ No newline at end of file
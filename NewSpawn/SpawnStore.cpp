@@ -0,0 +1,257 @@
+#include "SpawnStore.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "GhostFile.h"
+
+namespace {
+    // Ghost size marking the last attempt as the best one
+    constexpr uint32_t SAME_AS_BEST = 0xFFFFFFFF;
+
+    // Records are at most half an hour, anything much larger is corrupt
+    constexpr uint32_t MAX_RECORD_SIZE = 16 << 20;
+
+    template<typename T>
+    void Put(std::vector<char> &out, const T &v) {
+        out.insert(out.end(), (const char *) &v, (const char *) &v + sizeof(T));
+    }
+
+    void PutGhost(std::vector<char> &out, const std::shared_ptr<const GhostRecord> &ghost, bool sameAsBest) {
+        std::vector<char> data;
+        if (sameAsBest) {
+            Put(out, SAME_AS_BEST);
+        } else if (!ghost || ghost->states.empty()) {
+            Put(out, (uint32_t) 0);
+        } else {
+            GhostCodec::EncodePayload(*ghost, data);
+            int packedSize;
+            char *packed = CKPackData(data.data(), (int) data.size(), packedSize, 9);
+            if (!packed) {
+                Put(out, (uint32_t) 0);
+                return;
+            }
+            Put(out, (uint32_t) data.size());
+            Put(out, (uint32_t) packedSize);
+            out.insert(out.end(), packed, packed + packedSize);
+            CKDeletePointer(packed);
+        }
+    }
+
+    void PutStats(std::vector<char> &out, const AttemptStats &stats) {
+        Put(out, stats.GetSummary());
+        size_t size = stats.GetRingSize(), start = stats.GetRingStart();
+        GhostCodec::PutVarint(out, (uint32_t) size);
+        for (size_t i = 0; i < size; i++)
+            GhostCodec::PutVarint(out, (uint32_t) std::lround(stats.GetRing()[(start + i) % AttemptStats::CAPACITY]));
+    }
+
+    bool GetStats(GhostCodec::Reader &reader, AttemptStats &stats) {
+        AttemptStats::Summary summary;
+        uint32_t size;
+        if (!reader.Get(summary) || !reader.Varint(size) || size > AttemptStats::CAPACITY)
+            return false;
+
+        float times[AttemptStats::CAPACITY];
+        for (uint32_t i = 0; i < size; i++) {
+            uint32_t time;
+            if (!reader.Varint(time))
+                return false;
+            times[i] = (float) time;
+        }
+        stats.Restore(summary, times, size);
+        return true;
+    }
+
+    bool GetGhost(GhostCodec::Reader &reader, std::shared_ptr<const GhostRecord> &ghost, const std::shared_ptr<const GhostRecord> &best) {
+        uint32_t size, packedSize;
+        if (!reader.Get(size))
+            return false;
+        if (size == SAME_AS_BEST) {
+            ghost = best;
+            return true;
+        }
+        if (size == 0)
+            return true;
+
+        if (size > MAX_RECORD_SIZE || !reader.Get(packedSize))
+            return false;
+        const char *packed = reader.Skip(packedSize);
+        if (!packed)
+            return false;
+
+        char *data = CKUnPackData((int) size, (char *) packed, (int) packedSize);
+        if (!data)
+            return false;
+        auto record = std::make_shared<GhostRecord>();
+        bool res = GhostCodec::DecodePayload(data, size, *record);
+        CKDeletePointer(data);
+        if (res)
+            ghost = std::move(record);
+        return res;
+    }
+}
+
+void SpawnStore::Start(const std::string &dir) {
+    if (m_worker.joinable())
+        return;
+
+    m_dir = dir;
+    m_stop = false;
+    m_worker = std::thread(&SpawnStore::Run, this);
+}
+
+void SpawnStore::Stop() {
+    if (!m_worker.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_worker.join();
+}
+
+void SpawnStore::Load(const std::string &map) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requested = map;
+        m_loaded = false;
+        m_slots.clear();
+
+        Job job;
+        job.map = map;
+        job.load = true;
+        m_jobs.push_back(std::move(job));
+    }
+    m_wake.notify_one();
+}
+
+bool SpawnStore::Poll(std::vector<SpawnSlot> &slots) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_loaded)
+        return false;
+
+    slots.swap(m_slots);
+    m_slots.clear();
+    m_loaded = false;
+    return true;
+}
+
+void SpawnStore::Save(const std::string &map, const std::vector<SpawnSlot> &slots) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_jobs.empty() && !m_jobs.back().load && m_jobs.back().map == map) {
+            m_jobs.back().slots = slots;
+        } else {
+            Job job;
+            job.map = map;
+            job.slots = slots;
+            m_jobs.push_back(std::move(job));
+        }
+    }
+    m_wake.notify_one();
+}
+
+void SpawnStore::Run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+        if (m_jobs.empty())
+            break;
+
+        Job job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        lock.unlock();
+
+        if (job.load) {
+            std::vector<SpawnSlot> slots;
+            Read(job.map, slots);
+            lock.lock();
+            // A newer map may have been asked for in the meantime
+            if (job.map == m_requested) {
+                m_slots = std::move(slots);
+                m_loaded = true;
+            }
+        } else {
+            Write(job.map, job.slots);
+            lock.lock();
+        }
+    }
+}
+
+std::string SpawnStore::GetPath(const std::string &map) const {
+    char name[16];
+    sprintf(name, "%08lx.nsp", CKComputeDataCRC((char *) map.c_str(), (int) map.size()));
+    return m_dir + name;
+}
+
+bool SpawnStore::Read(const std::string &map, std::vector<SpawnSlot> &slots) {
+    FILE *fp = fopen(GetPath(map).c_str(), "rb");
+    if (!fp)
+        return false;
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    m_buffer.resize(size > 0 ? size : 0);
+    bool res = size > 0 && fread(m_buffer.data(), size, 1, fp) == 1;
+    fclose(fp);
+    if (!res)
+        return false;
+
+    GhostCodec::Reader reader(m_buffer.data(), m_buffer.size());
+    uint32_t magic, version, nameSize, count;
+    if (!reader.Get(magic) || !reader.Get(version) || magic != MAGIC || version != VERSION ||
+        !reader.Get(nameSize))
+        return false;
+
+    // Files of other maps with the same CRC are left alone
+    const char *name = reader.Skip(nameSize);
+    if (!name || map.compare(0, std::string::npos, name, nameSize) != 0 || !reader.Get(count))
+        return false;
+
+    for (uint32_t i = 0; i < count; i++) {
+        SpawnSlot slot;
+        uint16_t slotNameSize;
+        const char *slotName;
+        float matrix[16];
+        if (!reader.Get(slotNameSize) || !(slotName = reader.Skip(slotNameSize)) ||
+            !reader.Get(matrix) || !reader.Get(slot.sector) || !reader.Get(slot.ball_type) ||
+            !reader.Get(slot.best_time) || !reader.Get(slot.last_time) ||
+            !GetGhost(reader, slot.best, nullptr) || !GetGhost(reader, slot.last, slot.best) ||
+            !GetStats(reader, slot.stats))
+            return false;
+
+        slot.name.assign(slotName, slotNameSize);
+        memcpy(&slot.matrix, matrix, sizeof(matrix));
+        slots.push_back(std::move(slot));
+    }
+    return true;
+}
+
+bool SpawnStore::Write(const std::string &map, const std::vector<SpawnSlot> &slots) {
+    m_buffer.clear();
+    Put(m_buffer, MAGIC);
+    Put(m_buffer, VERSION);
+    Put(m_buffer, (uint32_t) map.size());
+    m_buffer.insert(m_buffer.end(), map.begin(), map.end());
+    Put(m_buffer, (uint32_t) slots.size());
+
+    for (const auto &slot : slots) {
+        Put(m_buffer, (uint16_t) slot.name.size());
+        m_buffer.insert(m_buffer.end(), slot.name.begin(), slot.name.end());
+        m_buffer.insert(m_buffer.end(), (const char *) &slot.matrix, (const char *) &slot.matrix + 16 * sizeof(float));
+        Put(m_buffer, slot.sector);
+        Put(m_buffer, slot.ball_type);
+        Put(m_buffer, slot.best_time);
+        Put(m_buffer, slot.last_time);
+        PutGhost(m_buffer, slot.best, false);
+        PutGhost(m_buffer, slot.last, slot.last && slot.last == slot.best);
+        PutStats(m_buffer, slot.stats);
+    }
+
+    return WriteFileAtomic(GetPath(map).c_str(), m_buffer);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <BML/BMLAll.h>
+
+#include "AttemptStats.h"
+#include "GhostCodec.h"
+
+// A named spawn point of a map with the ghosts of its best and last attempts and the times of all of
+// them. Ghosts are shared, never copied: the best and last attempt are often the same one, and the
+// player plays it too.
+struct SpawnSlot {
+    std::string name;
+    VxMatrix matrix = {};
+    int sector = 0;
+    int ball_type = 0;
+
+    float best_time = 0;
+    float last_time = 0;
+    std::shared_ptr<const GhostRecord> best;
+    std::shared_ptr<const GhostRecord> last;
+
+    AttemptStats stats;
+};
+
+// Keeps the spawn slots of each map in a file of their own, named after the CRC of the map filename.
+// Files are read and written by a worker thread, so nothing waits for the disk in game. Saves are
+// snapshots of the slots, a save still queued is replaced by a newer one of the same map.
+//
+// File: [magic][version][slot count], then for each slot its name, matrix, sector, ball type, times,
+// both ghosts and its attempt statistics, a ghost being [size][packed size][packed payload] with the
+// payload of a Spirit Trail ghost chunk. The statistics are their summary followed by the times of
+// the ring in milliseconds as varints.
+class SpawnStore {
+public:
+    static constexpr uint32_t MAGIC = 0x5350534E; // "NSPS"
+    static constexpr uint32_t VERSION = 1;
+
+    SpawnStore() = default;
+    SpawnStore(const SpawnStore &) = delete;
+    SpawnStore &operator=(const SpawnStore &) = delete;
+    ~SpawnStore() { Stop(); }
+
+    void Start(const std::string &dir);
+
+    // Finishes the queued saves and stops the worker
+    void Stop();
+
+    // Reads the slots of the map, they are handed out by Poll once read
+    void Load(const std::string &map);
+    bool Poll(std::vector<SpawnSlot> &slots);
+
+    void Save(const std::string &map, const std::vector<SpawnSlot> &slots);
+
+private:
+    struct Job {
+        std::string map;
+        bool load = false;
+        std::vector<SpawnSlot> slots;
+    };
+
+    void Run();
+    std::string GetPath(const std::string &map) const;
+    bool Read(const std::string &map, std::vector<SpawnSlot> &slots);
+    bool Write(const std::string &map, const std::vector<SpawnSlot> &slots);
+
+    std::string m_dir;
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+    std::deque<Job> m_jobs;
+
+    // Result of the last load
+    std::string m_requested;
+    bool m_loaded = false;
+    std::vector<SpawnSlot> m_slots;
+
+    std::vector<char> m_buffer; // Worker only
+};
@@ -0,0 +1,259 @@
+#include "ParameterSweep.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include "Physics.h"
+#include "QuickSave.h"
+
+const char *const ParameterSweep::ParamNames[SP_COUNT] = {
+    "Mass", "Inertia Scale", "Speed Damping", "Rot Damping",
+};
+
+bool ParameterSweep::Start(IBML *bml, CKIpionManager *manager, QuickSave *save, CK3dEntity *ball,
+                           const std::string &path, std::string &error) {
+    Finish();
+    m_Error.clear();
+
+    IPhysicsObject *obj = ball ? manager->GetPhysicsObject(ball) : nullptr;
+    if (!obj) {
+        error = "The sweep needs a physicalized ball.";
+        return false;
+    }
+    if (!ParseScript(error))
+        return false;
+
+    m_BML = bml;
+    m_Manager = manager;
+    m_Save = save;
+    m_Ball = ball;
+    if (!m_Save->Save(ball)) {
+        error = "The start could not be saved.";
+        return false;
+    }
+
+    m_Total = 1;
+    for (const Range &range : ranges) {
+        if (range.enabled)
+            m_Total *= std::max(range.steps, 1);
+    }
+
+    m_Base.mass = obj->GetMass();
+    obj->GetInertia(m_Base.inertia);
+    obj->GetDamping(&m_Base.speedDamping, &m_Base.rotDamping);
+
+    // Pushes follow the camera at the start, flattened
+    m_Forward = VxVector(0.0f, 0.0f, 1.0f);
+    m_Right = VxVector(1.0f, 0.0f, 0.0f);
+    CKCamera *cam = m_BML->GetRenderContext()->GetAttachedCamera();
+    if (cam) {
+        VxVector dir, up, right;
+        cam->GetOrientation(&dir, &up, &right);
+        dir.y = 0.0f;
+        right.y = 0.0f;
+        if (dir.SquareMagnitude() > 0.0f && right.SquareMagnitude() > 0.0f) {
+            m_Forward = Normalize(dir);
+            m_Right = Normalize(right);
+        }
+    }
+
+    m_File = fopen(path.c_str(), "w");
+    if (!m_File) {
+        error = "The result file could not be opened.";
+        return false;
+    }
+    fprintf(m_File, "run,mass,inertia_x,inertia_y,inertia_z,speed_damping,rot_damping,"
+                    "distance,max_speed,final_x,final_y,final_z\n");
+
+    // Each frame lasts a step, a hair less so rounding skips a step now and then rather than doubling one
+    CKTimeManager *timeManager = m_BML->GetTimeManager();
+    const float frame = m_Manager->GetSimulationTimeStep() * 1000.0f * 0.9999f;
+    m_OldTimeFactor = m_Manager->GetTimeFactor();
+    m_OldMinDeltaTime = timeManager->GetMinimumDeltaTime();
+    m_OldMaxDeltaTime = timeManager->GetMaximumDeltaTime();
+    m_OldLimitOptions = timeManager->GetLimitOptions();
+    m_Manager->SetTimeFactor(1.0f);
+    timeManager->SetMinimumDeltaTime(frame);
+    timeManager->SetMaximumDeltaTime(frame);
+    timeManager->ChangeLimitOptions(CK_FRAMERATE_FREE);
+    m_BML->GetRenderContext()->ChangeCurrentRenderOptions(0, CK_RENDER_DEFAULTSETTINGS);
+
+    m_Run = 0;
+    if (!BeginRun()) {
+        error = m_Error;
+        Finish();
+        return false;
+    }
+    return true;
+}
+
+bool ParameterSweep::Process() {
+    if (!m_File)
+        return false;
+
+    IPhysicsObject *obj = m_Manager->GetPhysicsObject(m_Ball);
+    if (!obj) {
+        m_Error = "The ball was lost, the sweep stopped.";
+        Finish();
+        return false;
+    }
+
+    const float step = m_Manager->GetSimulationTimeStep();
+    const int tick = (int) ((m_Manager->GetSimulationTime() - m_StartTime) / step + 0.5);
+    if (tick <= m_Tick)
+        return true;
+
+    VxVector position, angles, velocity, angularVelocity;
+    obj->GetPosition(&position, &angles);
+    obj->GetVelocity(&velocity, &angularVelocity);
+
+    // A frame that ran more than one step is cut at the last tick of the run
+    if (tick > ticks) {
+        const float t = (float) (ticks - m_Tick) / (float) (tick - m_Tick);
+        position = m_LastPos + (position - m_LastPos) * t;
+        velocity = m_LastVel + (velocity - m_LastVel) * t;
+    }
+    m_Distance += Magnitude(position - m_LastPos);
+    m_MaxSpeed = std::max(m_MaxSpeed, Magnitude(velocity));
+    m_LastPos = position;
+    m_LastVel = velocity;
+    m_Tick = tick;
+
+    if (tick >= ticks) {
+        EndRun();
+        if (++m_Run >= m_Total || !BeginRun()) {
+            Finish();
+            return false;
+        }
+        return true;
+    }
+
+    Push(obj);
+    return true;
+}
+
+void ParameterSweep::Finish() {
+    if (!m_File)
+        return;
+
+    fclose(m_File);
+    m_File = nullptr;
+
+    if (m_Manager->GetPhysicsObject(m_Ball)) {
+        Apply(m_Base);
+        m_Save->Load(m_Ball);
+    }
+    CKTimeManager *timeManager = m_BML->GetTimeManager();
+    m_Manager->SetTimeFactor(m_OldTimeFactor);
+    timeManager->SetMinimumDeltaTime(m_OldMinDeltaTime);
+    timeManager->SetMaximumDeltaTime(m_OldMaxDeltaTime);
+    timeManager->ChangeLimitOptions((CK_FRAMERATE_LIMITS) (m_OldLimitOptions & CK_FRAMERATE_MASK));
+    m_BML->GetRenderContext()->ChangeCurrentRenderOptions(CK_RENDER_DEFAULTSETTINGS, 0);
+}
+
+bool ParameterSweep::ParseScript(std::string &error) {
+    m_Steps.clear();
+    const char *p = script;
+    while (*p) {
+        if (isspace((unsigned char) *p)) {
+            ++p;
+            continue;
+        }
+
+        Step step;
+        step.dir = (char) toupper((unsigned char) *p++);
+        char *end;
+        step.ticks = (int) strtol(p, &end, 10);
+        if (!strchr("FBLRN", step.dir) || end == p || step.ticks <= 0) {
+            error = "The script is made of steps such as F120, with F, B, L, R or N.";
+            return false;
+        }
+        m_Steps.push_back(step);
+        p = end;
+    }
+    return true;
+}
+
+ParameterSweep::Values ParameterSweep::GetValues(size_t run) const {
+    // The run index counts through the enabled parameters, the first one changing fastest
+    Values values = m_Base;
+    for (int i = 0; i < SP_COUNT; ++i) {
+        const Range &range = ranges[i];
+        if (!range.enabled)
+            continue;
+
+        const size_t steps = std::max(range.steps, 1);
+        const float value = range.At((int) (run % steps));
+        run /= steps;
+        switch (i) {
+            case SP_MASS: values.mass = value; break;
+            case SP_INERTIA_SCALE: values.inertia = m_Base.inertia * value; break;
+            case SP_SPEED_DAMPING: values.speedDamping = value; break;
+            case SP_ROT_DAMPING: values.rotDamping = value; break;
+            default: break;
+        }
+    }
+    return values;
+}
+
+void ParameterSweep::Apply(const Values &values) {
+    IPhysicsObject *obj = m_Manager->GetPhysicsObject(m_Ball);
+    if (!obj)
+        return;
+
+    obj->SetMass(values.mass);
+    obj->SetInertia(values.inertia);
+    obj->SetDamping(&values.speedDamping, &values.rotDamping);
+}
+
+bool ParameterSweep::BeginRun() {
+    if (!m_Save->Load(m_Ball)) {
+        m_Error = "The start could not be loaded, the sweep stopped.";
+        return false;
+    }
+    Apply(GetValues(m_Run));
+
+    IPhysicsObject *obj = m_Manager->GetPhysicsObject(m_Ball);
+    VxVector angles, angularVelocity;
+    obj->GetPosition(&m_LastPos, &angles);
+    obj->GetVelocity(&m_LastVel, &angularVelocity);
+    m_StartTime = m_Manager->GetSimulationTime();
+    m_Tick = 0;
+    m_Distance = 0.0f;
+    m_MaxSpeed = Magnitude(m_LastVel);
+
+    Push(obj);
+    return true;
+}
+
+void ParameterSweep::EndRun() {
+    const Values values = GetValues(m_Run);
+    fprintf(m_File, "%zu,%g,%g,%g,%g,%g,%g,%g,%g,%g,%g,%g\n", m_Run, values.mass,
+            values.inertia.x, values.inertia.y, values.inertia.z, values.speedDamping, values.rotDamping,
+            m_Distance, m_MaxSpeed, m_LastPos.x, m_LastPos.y, m_LastPos.z);
+}
+
+void ParameterSweep::Push(IPhysicsObject *obj) {
+    // The input of the next step, held for the whole step
+    char dir = 'N';
+    int left = m_Tick;
+    for (const Step &s : m_Steps) {
+        if (left < s.ticks) {
+            dir = s.dir;
+            break;
+        }
+        left -= s.ticks;
+    }
+
+    VxVector push;
+    switch (dir) {
+        case 'F': push = m_Forward; break;
+        case 'B': push = -m_Forward; break;
+        case 'L': push = -m_Right; break;
+        case 'R': push = m_Right; break;
+        default: return;
+    }
+    obj->ApplyForceCenter(push * (force * m_Manager->GetSimulationTimeStep()));
+}
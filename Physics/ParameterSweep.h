@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <BML/BMLAll.h>
+
+class CKIpionManager;
+class IPhysicsObject;
+class QuickSave;
+
+// Runs the ball over a grid of physics parameters, each run from the same saved start and pushed along
+// the same scripted input, and writes the outcome of every run to a CSV file.
+//
+// Script: steps of a direction and a tick count separated by spaces, as in "F120 L60 N30". Directions are
+// F, B, L and R along the camera at the start, and N for none. A tick is a step of the simulation. While
+// sweeping, every frame is given the length of one step, so the push is applied before each step and a
+// run ends right after its last one, however fast the frames actually go.
+class ParameterSweep {
+public:
+    enum Param {
+        SP_MASS,
+        SP_INERTIA_SCALE,
+        SP_SPEED_DAMPING,
+        SP_ROT_DAMPING,
+        SP_COUNT
+    };
+
+    // Values swept by a parameter, the ball's own value when disabled
+    struct Range {
+        bool enabled = false;
+        float min = 0.0f;
+        float max = 0.0f;
+        int steps = 1;
+
+        float At(int i) const { return steps > 1 ? min + (max - min) * (float) i / (float) (steps - 1) : min; }
+    };
+
+    static const char *const ParamNames[SP_COUNT];
+
+    Range ranges[SP_COUNT];
+    int ticks = 600;
+    float force = 0.5f;
+    char script[256] = "F120 L60 F120 R60 F240";
+
+    ParameterSweep() = default;
+    ParameterSweep(const ParameterSweep &) = delete;
+    ParameterSweep &operator=(const ParameterSweep &) = delete;
+    ~ParameterSweep() {
+        if (m_File)
+            fclose(m_File);
+    }
+
+    // Saves the start in the quick save and opens the CSV file
+    bool Start(IBML *bml, CKIpionManager *manager, QuickSave *save, CK3dEntity *ball, const std::string &path,
+               std::string &error);
+
+    // Steps the current run once a frame, false once the sweep is over
+    bool Process();
+
+    // Puts the ball and the world back as they were at the start and closes the file
+    void Finish();
+
+    bool IsRunning() const { return m_File != nullptr; }
+    size_t GetDone() const { return m_Run; }
+    size_t GetTotal() const { return m_Total; }
+    const std::string &GetError() const { return m_Error; }
+
+private:
+    struct Step {
+        char dir;
+        int ticks;
+    };
+
+    struct Values {
+        float mass;
+        VxVector inertia;
+        float speedDamping;
+        float rotDamping;
+    };
+
+    bool ParseScript(std::string &error);
+    Values GetValues(size_t run) const;
+    void Apply(const Values &values);
+    bool BeginRun();
+    void EndRun();
+    void Push(IPhysicsObject *obj);
+
+    IBML *m_BML = nullptr;
+    CKIpionManager *m_Manager = nullptr;
+    QuickSave *m_Save = nullptr;
+    CK3dEntity *m_Ball = nullptr;
+    FILE *m_File = nullptr;
+    std::string m_Error;
+
+    std::vector<Step> m_Steps;
+    Values m_Base = {};
+    VxVector m_Forward;
+    VxVector m_Right;
+    float m_OldTimeFactor = 1.0f;
+    float m_OldMinDeltaTime = 0.0f;
+    float m_OldMaxDeltaTime = 0.0f;
+    CKDWORD m_OldLimitOptions = 0;
+    size_t m_Total = 0;
+    size_t m_Run = 0;
+
+    // Current run
+    double m_StartTime = 0.0;
+    int m_Tick = 0;
+    VxVector m_LastPos;
+    VxVector m_LastVel;
+    float m_Distance = 0.0f;
+    float m_MaxSpeed = 0.0f;
+};
@@ -1,5 +1,10 @@
 #include "Physics.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <ctime>
+
 #include <BML/Bui.h>
 
 PhysicsMod *g_Mod = nullptr;
@@ -36,10 +41,48 @@ void PhysicsMod::OnLoad() {
     m_Enabled->SetComment("Enable Display Info");
     m_Enabled->SetDefaultBoolean(false);
 
+    m_TrackWorld = GetConfig()->GetProperty("Misc", "TrackWorld");
+    m_TrackWorld->SetComment("Track the state of every physicalized object of the level");
+    m_TrackWorld->SetDefaultBoolean(false);
+
+    GetConfig()->SetCategoryComment("Practice", "Quick save and load of the physics world, in cheat mode");
+
+    m_QuickSaveKey = GetConfig()->GetProperty("Practice", "QuickSave");
+    m_QuickSaveKey->SetComment("Save the state of the ball and every movable object");
+    m_QuickSaveKey->SetDefaultKey(CKKEY_F7);
+
+    m_QuickLoadKey = GetConfig()->GetProperty("Practice", "QuickLoad");
+    m_QuickLoadKey->SetComment("Load the saved state");
+    m_QuickLoadKey->SetDefaultKey(CKKEY_F8);
+
+    m_StopSweepKey = GetConfig()->GetProperty("Practice", "StopSweep");
+    m_StopSweepKey->SetComment("Stop the running parameter sweep, the window is not drawn during one");
+    m_StopSweepKey->SetDefaultKey(CKKEY_F9);
+
+    GetConfig()->SetCategoryComment("Telemetry", "Ball Telemetry");
+
+    m_RecordTelemetry = GetConfig()->GetProperty("Telemetry", "Record");
+    m_RecordTelemetry->SetComment("Record position, angles, velocities and damping of the ball every tick");
+    m_RecordTelemetry->SetDefaultBoolean(false);
+
+    m_SaveTelemetry = GetConfig()->GetProperty("Telemetry", "Save");
+    m_SaveTelemetry->SetComment("Save the recorded telemetry of each attempt to ModLoader\\Telemetry");
+    m_SaveTelemetry->SetDefaultBoolean(false);
+
+    VxMakeDirectory("..\\ModLoader\\Telemetry\\");
+    VxMakeDirectory("..\\ModLoader\\Sweeps\\");
+    m_TelemetryWriter.Start();
+
     m_IpionManager = (CKIpionManager *) m_BML->GetCKContext()->GetManagerByGuid(CKGUID(0x6bed328b, 0x141f5148));
     m_InputHook = m_BML->GetInputManager();
 }
 
+void PhysicsMod::OnUnload() {
+    m_Sweep.Finish();
+    CloseTelemetryFile();
+    m_TelemetryWriter.Stop();
+}
+
 void PhysicsMod::OnLoadObject(const char *filename, CKBOOL isMap, const char *masterName, CK_CLASSID filterClass,
                               CKBOOL addToScene, CKBOOL reuseMeshes, CKBOOL reuseMaterials, CKBOOL dynamic,
                               XObjectArray *objArray, CKObject *masterObj) {
@@ -51,6 +94,13 @@ void PhysicsMod::OnLoadObject(const char *filename, CKBOOL isMap, const char *ma
         m_MapName = filename;
         m_MapName = m_MapName.substr(m_MapName.find_last_of('\\') + 1);
         m_MapName = m_MapName.substr(0, m_MapName.find_last_of('.'));
+
+        m_Telemetry.Clear();
+        m_PlotSamples = 0;
+
+        m_Snapshot.Reset(m_BML->GetCKContext(), m_IpionManager);
+        m_Browser.Reset(m_BML->GetCKContext(), m_IpionManager);
+        m_QuickSave.Reset(m_BML, m_IpionManager);
     }
 }
 
@@ -67,9 +117,38 @@ void PhysicsMod::OnLoadScript(const char *filename, CKBehavior *script) {
 }
 
 void PhysicsMod::OnProcess() {
+    if (m_TrackWorld->GetBoolean() && m_BML->IsPlaying())
+        m_Snapshot.Update();
+
+    if (m_Sweep.IsRunning()) {
+        if (!m_BML->IsPlaying())
+            return;
+        if (m_InputHook->IsKeyPressed(m_StopSweepKey->GetKey()))
+            m_Sweep.Finish();
+        else if (!m_Sweep.Process()) {
+            m_SweepError = m_Sweep.GetError();
+            m_BML->SendIngameMessage(m_SweepError.empty() ? "Sweep finished." : m_SweepError.c_str());
+        }
+        return;
+    }
+
+    if (m_BML->IsPlaying() && m_BML->IsCheatEnabled()) {
+        if (m_InputHook->IsKeyPressed(m_QuickSaveKey->GetKey()))
+            OnQuickSave();
+        else if (m_InputHook->IsKeyPressed(m_QuickLoadKey->GetKey()))
+            OnQuickLoad();
+    }
+
+    const bool record = m_RecordTelemetry->GetBoolean() && m_BML->IsPlaying();
+    if (!m_Enabled->GetBoolean() && !record)
+        return;
+
+    auto *ball = GetPhysicsBall();
+    m_BallData.Acquire(ball);
+    if (record && m_BallData.valid)
+        RecordTelemetry();
+
     if (m_Enabled->GetBoolean()) {
-        auto *ball = GetPhysicsBall();
-        m_BallData.Acquire(ball);
         if (m_BallData.valid && m_BallReset) {
             m_BallDataOrig = m_BallData;
             m_BallReset = false;
@@ -93,14 +172,96 @@ void PhysicsMod::OnProcess() {
 void PhysicsMod::OnStartLevel() {
     if (m_Enabled->GetBoolean())
         m_ShowWindow = true;
+
+    m_QuickSave.Reserve();
+
+    if (m_RecordTelemetry->GetBoolean() && m_SaveTelemetry->GetBoolean())
+        OpenTelemetryFile();
 }
 
 void PhysicsMod::OnPreResetLevel() {
+    m_Sweep.Finish();
     m_ShowWindow = false;
+    CloseTelemetryFile();
 }
 
 void PhysicsMod::OnPreExitLevel() {
+    m_Sweep.Finish();
     m_ShowWindow = false;
+    CloseTelemetryFile();
+    m_Snapshot.Clear();
+    m_Browser.Clear();
+}
+
+void PhysicsMod::OnQuickSave() {
+    const auto start = std::chrono::steady_clock::now();
+    if (!m_QuickSave.Save(GetActiveBall())) {
+        m_BML->SendIngameMessage("Quick save needs a physicalized ball.");
+        return;
+    }
+    const std::chrono::duration<double, std::micro> cost = std::chrono::steady_clock::now() - start;
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Saved %zu objects in %.0f us.", m_QuickSave.GetBodyCount(), cost.count());
+    m_BML->SendIngameMessage(msg);
+}
+
+void PhysicsMod::OnQuickLoad() {
+    if (!m_QuickSave.IsValid()) {
+        m_BML->SendIngameMessage("Nothing saved on this map.");
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    if (!m_QuickSave.Load(GetActiveBall())) {
+        m_BML->SendIngameMessage("Quick load needs the ball saved, physicalized.");
+        return;
+    }
+    const std::chrono::duration<double, std::micro> cost = std::chrono::steady_clock::now() - start;
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Loaded %zu objects in %.0f us.", m_QuickSave.GetBodyCount(), cost.count());
+    m_BML->SendIngameMessage(msg);
+}
+
+void PhysicsMod::RecordTelemetry() {
+    const float values[TC_COUNT] = {
+        m_BallData.position.x, m_BallData.position.y, m_BallData.position.z,
+        m_BallData.angles.x, m_BallData.angles.y, m_BallData.angles.z,
+        m_BallData.velocity.x, m_BallData.velocity.y, m_BallData.velocity.z,
+        m_BallData.angularVelocity.x, m_BallData.angularVelocity.y, m_BallData.angularVelocity.z,
+        m_BallData.speedDamping, m_BallData.rotDamping,
+    };
+
+    auto block = m_Telemetry.Add(values);
+    if (block && m_TelemetryFileOpen)
+        m_TelemetryWriter.Write(std::move(block));
+}
+
+void PhysicsMod::OpenTelemetryFile() {
+    CloseTelemetryFile();
+
+    // The file starts with a block of its own
+    m_Telemetry.Seal();
+
+    char filepath[MAX_PATH];
+    time_t stamp = time(nullptr);
+    tm *curTime = localtime(&stamp);
+    sprintf(filepath, "..\\ModLoader\\Telemetry\\%s_%04d%02d%02d_%02d%02d%02d.ptl", m_MapName.c_str(),
+            curTime->tm_year + 1900, curTime->tm_mon + 1, curTime->tm_mday, curTime->tm_hour, curTime->tm_min,
+            curTime->tm_sec);
+
+    m_TelemetryWriter.Open(filepath);
+    m_TelemetryFileOpen = true;
+}
+
+void PhysicsMod::CloseTelemetryFile() {
+    if (!m_TelemetryFileOpen)
+        return;
+
+    m_TelemetryWriter.Write(m_Telemetry.Seal());
+    m_TelemetryWriter.Close();
+    m_TelemetryFileOpen = false;
 }
 
 void PhysicsMod::OnDraw() {
@@ -159,6 +320,188 @@ void PhysicsMod::OnDraw() {
         ImGui::Text("(%.3f, %.3f, %.3f)", m_BallData.velocity.x, m_BallData.velocity.y, m_BallData.velocity.z);
         ImGui::Text("Angular Velocity:");
         ImGui::Text("(%.3f, %.3f, %.3f)", m_BallData.angularVelocity.x, m_BallData.angularVelocity.y, m_BallData.angularVelocity.z);
+
+        if (m_RecordTelemetry->GetBoolean() && ImGui::CollapsingHeader("Telemetry"))
+            OnDrawTelemetry();
+        if (ImGui::CollapsingHeader("Objects"))
+            OnDrawObjects();
+        if (m_TrackWorld->GetBoolean() && ImGui::CollapsingHeader("World"))
+            OnDrawWorld();
+        if (m_BML->IsCheatEnabled() && ImGui::CollapsingHeader("Sweep"))
+            OnDrawSweep();
     }
     ImGui::End();
+}
+
+void PhysicsMod::OnDrawTelemetry() {
+    ImGui::Text("%zu ticks in %.2f MB", m_Telemetry.GetSampleCount(), m_Telemetry.GetSize() / 1048576.0);
+
+    if (ImGui::Combo("Channel", &m_PlotChannel, TelemetryChannelNames, TC_COUNT))
+        m_PlotSamples = 0;
+    if (ImGui::SliderInt("Ticks", &m_PlotTicks, 60, 60 * 60 * 10, "%d", ImGuiSliderFlags_Logarithmic))
+        m_PlotSamples = 0;
+
+    // Each bucket holds the min and max of its ticks, decoded again once a bucket's worth has come in
+    const float width = ImGui::GetContentRegionAvail().x;
+    const size_t buckets = width > 1.0f ? (size_t) width : 1;
+    const size_t samples = m_Telemetry.GetSampleCount();
+    if (m_PlotSamples == 0 || samples < m_PlotSamples || samples - m_PlotSamples >= m_PlotTicks / buckets + 1) {
+        m_Telemetry.Decimate(m_PlotChannel, m_PlotTicks, buckets, m_PlotValues);
+        m_PlotSamples = samples;
+    }
+
+    ImGui::PlotLines("##Telemetry", m_PlotValues.data(), (int) m_PlotValues.size(), 0, nullptr, FLT_MAX, FLT_MAX,
+                     ImVec2(width, 120.0f));
+}
+
+void PhysicsMod::OnDrawWorld() {
+    const auto &changed = m_Snapshot.GetChanged();
+    ImGui::Text("Objects: %zu, Changed: %zu, Removed: %zu", m_Snapshot.GetCount(), changed.size(),
+                m_Snapshot.GetRemoved().size());
+
+    constexpr ImGuiTableFlags TableFlags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+    if (!ImGui::BeginTable("##World", 3, TableFlags, ImVec2(0.0f, 200.0f)))
+        return;
+
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Object");
+    ImGui::TableSetupColumn("Position");
+    ImGui::TableSetupColumn("Velocity");
+    ImGui::TableHeadersRow();
+
+    CKContext *context = m_BML->GetCKContext();
+    ImGuiListClipper clipper;
+    clipper.Begin((int) changed.size());
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+            const uint32_t i = changed[row];
+            const VxVector &position = m_Snapshot.GetPositions()[i];
+            const VxVector &velocity = m_Snapshot.GetVelocities()[i];
+            CKObject *obj = context->GetObject(m_Snapshot.GetIds()[i]);
+
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(obj && obj->GetName() ? obj->GetName() : "");
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("(%.3f, %.3f, %.3f)", position.x, position.y, position.z);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("(%.3f, %.3f, %.3f)", velocity.x, velocity.y, velocity.z);
+        }
+    }
+    ImGui::EndTable();
+}
+
+void PhysicsMod::OnDrawObjects() {
+    m_Browser.Update();
+
+    CKContext *context = m_BML->GetCKContext();
+    bool filter = ImGui::InputText("Name", m_Browser.name, sizeof(m_Browser.name));
+
+    CKObject *group = m_Browser.group ? context->GetObject(m_Browser.group) : nullptr;
+    if (ImGui::BeginCombo("Group", group ? group->GetName() : "Any")) {
+        if (ImGui::Selectable("Any", !group)) {
+            m_Browser.group = 0;
+            filter = true;
+        }
+        for (CK_ID id : m_Browser.GetGroups()) {
+            CKObject *obj = context->GetObject(id);
+            if (obj && ImGui::Selectable(obj->GetName() ? obj->GetName() : "", id == m_Browser.group)) {
+                m_Browser.group = id;
+                filter = true;
+            }
+        }
+        ImGui::EndCombo();
+    }
+
+    filter |= ImGui::Combo("Motion", &m_Browser.motion, "All\0Movable\0Static\0");
+    if (filter)
+        m_Browser.Filter();
+
+    const auto &rows = m_Browser.GetRows();
+    ImGui::Text("Shown: %zu / %zu", rows.size(), m_Browser.GetCount());
+
+    constexpr ImGuiTableFlags TableFlags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+    if (!ImGui::BeginTable("##Objects", 4, TableFlags, ImVec2(0.0f, 300.0f)))
+        return;
+
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Object");
+    ImGui::TableSetupColumn("Mass");
+    ImGui::TableSetupColumn("Position");
+    ImGui::TableSetupColumn("Velocity");
+    ImGui::TableHeadersRow();
+
+    // Only the rows on screen read the physics objects
+    ImGuiListClipper clipper;
+    clipper.Begin((int) rows.size());
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+            const uint32_t i = rows[row];
+            auto *entity = (CK3dEntity *) context->GetObject(m_Browser.GetId(i));
+            IPhysicsObject *obj = entity ? m_IpionManager->GetPhysicsObject(entity) : nullptr;
+
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(entity && entity->GetName() ? entity->GetName() : "");
+            if (!obj)
+                continue;
+
+            VxVector position, angles, velocity, angularVelocity;
+            obj->GetPosition(&position, &angles);
+            ImGui::TableSetColumnIndex(1);
+            if (m_Browser.IsMovable(i))
+                ImGui::Text("%.3f", obj->GetMass());
+            else
+                ImGui::TextUnformatted("Static");
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("(%.3f, %.3f, %.3f)", position.x, position.y, position.z);
+            if (m_Browser.IsMovable(i)) {
+                obj->GetVelocity(&velocity, &angularVelocity);
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("(%.3f, %.3f, %.3f)", velocity.x, velocity.y, velocity.z);
+            }
+        }
+    }
+    ImGui::EndTable();
+}
+
+void PhysicsMod::OnDrawSweep() {
+    for (int i = 0; i < ParameterSweep::SP_COUNT; ++i) {
+        auto &range = m_Sweep.ranges[i];
+        ImGui::PushID(i);
+        if (ImGui::Checkbox(ParameterSweep::ParamNames[i], &range.enabled) && range.enabled &&
+            range.min == 0.0f && range.max == 0.0f) {
+            // Starts around the value of the ball
+            const float values[] = {m_BallData.mass, 1.0f, m_BallData.speedDamping, m_BallData.rotDamping};
+            range.min = range.max = values[i];
+        }
+        if (range.enabled) {
+            ImGui::InputFloat2("Min / Max", &range.min);
+            ImGui::InputInt("Steps", &range.steps);
+            range.steps = std::max(range.steps, 1);
+        }
+        ImGui::PopID();
+    }
+
+    ImGui::InputInt("Ticks", &m_Sweep.ticks);
+    ImGui::InputFloat("Force", &m_Sweep.force);
+    ImGui::InputText("Script", m_Sweep.script, sizeof(m_Sweep.script));
+
+    if (ImGui::Button("Start")) {
+        char filepath[MAX_PATH];
+        time_t stamp = time(nullptr);
+        tm *curTime = localtime(&stamp);
+        sprintf(filepath, "..\\ModLoader\\Sweeps\\%s_%04d%02d%02d_%02d%02d%02d.csv", m_MapName.c_str(),
+                curTime->tm_year + 1900, curTime->tm_mon + 1, curTime->tm_mday, curTime->tm_hour, curTime->tm_min,
+                curTime->tm_sec);
+
+        m_SweepError.clear();
+        if (!m_Sweep.Start(m_BML, m_IpionManager, &m_QuickSave, GetActiveBall(), filepath, m_SweepError))
+            m_BML->SendIngameMessage(m_SweepError.c_str());
+    }
+
+    if (m_Sweep.GetTotal() > 0)
+        ImGui::Text("Runs: %zu / %zu", m_Sweep.GetDone(), m_Sweep.GetTotal());
+    if (!m_SweepError.empty())
+        ImGui::TextUnformatted(m_SweepError.c_str());
 }
\ No newline at end of file
@@ -7,6 +7,12 @@
 
 #include <BML/BMLAll.h>
 
+#include "ParameterSweep.h"
+#include "PhysicsBrowser.h"
+#include "PhysicsSnapshot.h"
+#include "QuickSave.h"
+#include "Telemetry.h"
+
 class IPhysicsObject
 {
 public:
@@ -185,6 +191,7 @@ public:
     DECLARE_BML_VERSION;
 
     void OnLoad() override;
+    void OnUnload() override;
     void OnLoadObject(const char *filename, CKBOOL isMap, const char *masterName, CK_CLASSID filterClass,
                       CKBOOL addToScene, CKBOOL reuseMeshes, CKBOOL reuseMaterials, CKBOOL dynamic,
                       XObjectArray *objArray, CKObject *masterObj) override;
@@ -197,6 +204,17 @@ public:
     void OnPreExitLevel() override;
 
     void OnDraw();
+    void OnDrawTelemetry();
+    void OnDrawWorld();
+    void OnDrawObjects();
+    void OnDrawSweep();
+
+    void OnQuickSave();
+    void OnQuickLoad();
+
+    void RecordTelemetry();
+    void OpenTelemetryFile();
+    void CloseTelemetryFile();
 
     CK3dEntity *GetActiveBall() const {
         if (m_ActiveBall) {
@@ -230,7 +248,28 @@ public:
     PhysicsData m_BallDataLast;
     PhysicsData m_BallDataOrig;
 
+    // Ball values of every tick, written to a file per attempt when saved
+    TelemetryRing m_Telemetry{8 << 20};
+    TelemetryWriter m_TelemetryWriter;
+    bool m_TelemetryFileOpen = false;
+    int m_PlotChannel = TC_VELOCITY_X;
+    int m_PlotTicks = 600;
+    size_t m_PlotSamples = 0;
+    std::vector<float> m_PlotValues;
+
+    PhysicsSnapshot m_Snapshot;
+    PhysicsBrowser m_Browser;
+    QuickSave m_QuickSave;
+    ParameterSweep m_Sweep;
+    std::string m_SweepError;
+
     IProperty *m_Enabled = nullptr;
+    IProperty *m_TrackWorld = nullptr;
+    IProperty *m_QuickSaveKey = nullptr;
+    IProperty *m_QuickLoadKey = nullptr;
+    IProperty *m_StopSweepKey = nullptr;
+    IProperty *m_RecordTelemetry = nullptr;
+    IProperty *m_SaveTelemetry = nullptr;
 };
 
 MOD_EXPORT IMod *BMLEntry(IBML *bml);
@@ -0,0 +1,101 @@
+#include "PhysicsBrowser.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "Physics.h"
+
+namespace {
+    // Catches objects physicalized after the list was built, a rebuild takes about a millisecond for
+    // thousands of objects
+    constexpr std::chrono::seconds REBUILD_INTERVAL(1);
+
+    bool ContainsNoCase(const char *str, const char *part) {
+        if (!*part)
+            return true;
+        if (!str)
+            return false;
+
+        for (; *str; ++str) {
+            const char *s = str;
+            const char *p = part;
+            while (*s && *p && tolower((unsigned char) *s) == tolower((unsigned char) *p)) {
+                ++s;
+                ++p;
+            }
+            if (!*p)
+                return true;
+        }
+        return false;
+    }
+}
+
+void PhysicsBrowser::Reset(CKContext *context, CKIpionManager *manager) {
+    Clear();
+    m_Context = context;
+    m_Manager = manager;
+}
+
+void PhysicsBrowser::Clear() {
+    m_Ids.clear();
+    m_Movable.clear();
+    m_Groups.clear();
+    m_Rows.clear();
+    m_ObjectCount = -1;
+    group = 0;
+}
+
+void PhysicsBrowser::Update() {
+    if (!m_Context || !m_Manager)
+        return;
+
+    const int count = m_Context->GetObjectsCountByClassID(CKCID_3DOBJECT);
+    if (count != m_ObjectCount || std::chrono::steady_clock::now() - m_LastRebuild >= REBUILD_INTERVAL) {
+        Rebuild();
+        Filter();
+    }
+}
+
+void PhysicsBrowser::Filter() {
+    m_Rows.clear();
+    if (!m_Context)
+        return;
+
+    auto *filterGroup = group ? (CKGroup *) m_Context->GetObject(group) : nullptr;
+    if (group && !filterGroup)
+        group = 0;
+
+    for (uint32_t i = 0; i < m_Ids.size(); ++i) {
+        if ((motion == MF_MOVABLE && !m_Movable[i]) || (motion == MF_STATIC && m_Movable[i]))
+            continue;
+
+        auto *entity = (CK3dEntity *) m_Context->GetObject(m_Ids[i]);
+        if (!entity || (filterGroup && !entity->IsInGroup(filterGroup)) || !ContainsNoCase(entity->GetName(), name))
+            continue;
+        m_Rows.push_back(i);
+    }
+}
+
+void PhysicsBrowser::Rebuild() {
+    m_ObjectCount = m_Context->GetObjectsCountByClassID(CKCID_3DOBJECT);
+    const CK_ID *ids = m_Context->GetObjectsListByClassID(CKCID_3DOBJECT);
+    m_LastRebuild = std::chrono::steady_clock::now();
+
+    m_Ids.clear();
+    m_Movable.clear();
+    m_Groups.clear();
+    for (int i = 0; i < m_ObjectCount; ++i) {
+        auto *entity = (CK3dEntity *) m_Context->GetObject(ids[i]);
+        IPhysicsObject *obj = entity ? m_Manager->GetPhysicsObject(entity) : nullptr;
+        if (!obj)
+            continue;
+
+        m_Ids.push_back(ids[i]);
+        m_Movable.push_back(obj->IsMovable() ? 1 : 0);
+        for (int g = 0; g < entity->GetGroupCount(); ++g) {
+            CKGroup *grp = entity->GetGroup(g);
+            if (grp && std::find(m_Groups.begin(), m_Groups.end(), grp->GetID()) == m_Groups.end())
+                m_Groups.push_back(grp->GetID());
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <BML/BMLAll.h>
+
+class CKIpionManager;
+
+// The physicalized objects of the level as a list to browse, filtered by name, group and motion. The list
+// only holds what filtering needs and is rebuilt when the 3D objects of the level change, or once in a
+// while for objects physicalized later. Live values are left to the caller, read for the rows on screen.
+class PhysicsBrowser {
+public:
+    enum Motion {
+        MF_ALL,
+        MF_MOVABLE,
+        MF_STATIC,
+    };
+
+    // Case insensitive part of the name, a group of the level, 0 for any
+    char name[64] = "";
+    CK_ID group = 0;
+    int motion = MF_ALL;
+
+    void Reset(CKContext *context, CKIpionManager *manager);
+    void Clear();
+
+    // Rebuilds the list if it is out of date, the rows are filtered again when it is
+    void Update();
+
+    // To be called when the filter changed
+    void Filter();
+
+    size_t GetCount() const { return m_Ids.size(); }
+    const std::vector<uint32_t> &GetRows() const { return m_Rows; }
+    CK_ID GetId(uint32_t index) const { return m_Ids[index]; }
+    bool IsMovable(uint32_t index) const { return m_Movable[index] != 0; }
+
+    // Groups of the level holding at least one physicalized object
+    const std::vector<CK_ID> &GetGroups() const { return m_Groups; }
+
+private:
+    void Rebuild();
+
+    CKContext *m_Context = nullptr;
+    CKIpionManager *m_Manager = nullptr;
+
+    std::vector<CK_ID> m_Ids;
+    std::vector<uint8_t> m_Movable;
+    std::vector<CK_ID> m_Groups;
+    std::vector<uint32_t> m_Rows;
+
+    int m_ObjectCount = -1;
+    std::chrono::steady_clock::time_point m_LastRebuild;
+};
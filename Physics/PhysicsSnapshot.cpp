@@ -0,0 +1,131 @@
+#include "PhysicsSnapshot.h"
+
+#include <algorithm>
+
+#include "Physics.h"
+
+namespace {
+    // Room for the objects of a large level, so tracking them does not allocate
+    constexpr size_t RESERVED_OBJECTS = 1024;
+}
+
+void PhysicsSnapshot::Reset(CKContext *context, CKIpionManager *manager) {
+    Clear();
+    m_Context = context;
+    m_Manager = manager;
+
+    m_Ids.reserve(RESERVED_OBJECTS);
+    m_Positions.reserve(RESERVED_OBJECTS);
+    m_Angles.reserve(RESERVED_OBJECTS);
+    m_Velocities.reserve(RESERVED_OBJECTS);
+    m_AngularVelocities.reserve(RESERVED_OBJECTS);
+    m_Changed.reserve(RESERVED_OBJECTS);
+    m_Removed.reserve(RESERVED_OBJECTS);
+}
+
+void PhysicsSnapshot::Clear() {
+    m_Ids.clear();
+    m_Positions.clear();
+    m_Angles.clear();
+    m_Velocities.clear();
+    m_AngularVelocities.clear();
+    m_Changed.clear();
+    m_Removed.clear();
+    m_Candidates.clear();
+    std::fill(m_Tracked.begin(), m_Tracked.end(), 0);
+    m_CandidateCount = -1;
+    m_ScanPos = 0;
+}
+
+void PhysicsSnapshot::Update() {
+    m_Changed.clear();
+    m_Removed.clear();
+    if (!m_Context || !m_Manager)
+        return;
+
+    for (size_t i = 0; i < m_Ids.size();) {
+        auto *entity = (CK3dEntity *) m_Context->GetObject(m_Ids[i]);
+        IPhysicsObject *obj = entity ? m_Manager->GetPhysicsObject(entity) : nullptr;
+        if (!obj) {
+            // The last object takes its place and is read next
+            m_Removed.push_back(m_Ids[i]);
+            Remove(i);
+            continue;
+        }
+
+        VxVector position, angles, velocity, angularVelocity;
+        obj->GetPosition(&position, &angles);
+        obj->GetVelocity(&velocity, &angularVelocity);
+        if (position != m_Positions[i] || angles != m_Angles[i] ||
+            velocity != m_Velocities[i] || angularVelocity != m_AngularVelocities[i]) {
+            m_Positions[i] = position;
+            m_Angles[i] = angles;
+            m_Velocities[i] = velocity;
+            m_AngularVelocities[i] = angularVelocity;
+            m_Changed.push_back((uint32_t) i);
+        }
+        ++i;
+    }
+
+    Scan();
+}
+
+void PhysicsSnapshot::Scan() {
+    // An object deleted and another created in the same tick leave the count as it was, the next pass
+    // finds the new one
+    const int count = m_Context->GetObjectsCountByClassID(CKCID_3DOBJECT);
+    if (count != m_CandidateCount || m_ScanPos >= m_Candidates.size()) {
+        CK_ID *ids = m_Context->GetObjectsListByClassID(CKCID_3DOBJECT);
+        m_Candidates.assign(ids, ids + count);
+        m_CandidateCount = count;
+        m_ScanPos = 0;
+
+        const CK_ID maxId = m_Candidates.empty() ? 0 : *std::max_element(m_Candidates.begin(), m_Candidates.end());
+        if (maxId >= m_Tracked.size())
+            m_Tracked.resize(maxId + 1, 0);
+    }
+
+    const size_t end = std::min(m_ScanPos + SCAN_PER_TICK, m_Candidates.size());
+    while (m_ScanPos < end) {
+        const CK_ID id = m_Candidates[m_ScanPos++];
+        if (m_Tracked[id])
+            continue;
+
+        auto *entity = (CK3dEntity *) m_Context->GetObject(id);
+        IPhysicsObject *obj = entity ? m_Manager->GetPhysicsObject(entity) : nullptr;
+        if (obj)
+            Add(id, obj);
+    }
+}
+
+void PhysicsSnapshot::Add(CK_ID id, IPhysicsObject *obj) {
+    VxVector position, angles, velocity, angularVelocity;
+    obj->GetPosition(&position, &angles);
+    obj->GetVelocity(&velocity, &angularVelocity);
+
+    m_Changed.push_back((uint32_t) m_Ids.size());
+    m_Ids.push_back(id);
+    m_Positions.push_back(position);
+    m_Angles.push_back(angles);
+    m_Velocities.push_back(velocity);
+    m_AngularVelocities.push_back(angularVelocity);
+    m_Tracked[id] = 1;
+}
+
+void PhysicsSnapshot::Remove(size_t index) {
+    if (m_Ids[index] < m_Tracked.size())
+        m_Tracked[m_Ids[index]] = 0;
+
+    const size_t last = m_Ids.size() - 1;
+    m_Ids[index] = m_Ids[last];
+    m_Positions[index] = m_Positions[last];
+    m_Angles[index] = m_Angles[last];
+    m_Velocities[index] = m_Velocities[last];
+    m_AngularVelocities[index] = m_AngularVelocities[last];
+
+    m_Ids.pop_back();
+    m_Positions.pop_back();
+    m_Angles.pop_back();
+    m_Velocities.pop_back();
+    m_AngularVelocities.pop_back();
+}
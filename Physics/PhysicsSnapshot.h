@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <BML/BMLAll.h>
+
+class CKIpionManager;
+class IPhysicsObject;
+
+// The state of every physicalized object of the level, read once per tick into an array per field.
+// Objects are found by going over the 3D objects of the level a slice per tick, so no tick pays for all
+// of them, and dropped once deleted or no longer physicalized. Each update lists the objects it found
+// or whose state changed since the last one, objects at rest never do.
+class PhysicsSnapshot {
+public:
+    static constexpr size_t SCAN_PER_TICK = 64;
+
+    void Reset(CKContext *context, CKIpionManager *manager);
+    void Clear();
+    void Update();
+
+    size_t GetCount() const { return m_Ids.size(); }
+    const CK_ID *GetIds() const { return m_Ids.data(); }
+    const VxVector *GetPositions() const { return m_Positions.data(); }
+    const VxVector *GetAngles() const { return m_Angles.data(); }
+    const VxVector *GetVelocities() const { return m_Velocities.data(); }
+    const VxVector *GetAngularVelocities() const { return m_AngularVelocities.data(); }
+
+    // Indices of the objects found or changed by the last update, and the objects it dropped
+    const std::vector<uint32_t> &GetChanged() const { return m_Changed; }
+    const std::vector<CK_ID> &GetRemoved() const { return m_Removed; }
+
+private:
+    void Scan();
+    void Add(CK_ID id, IPhysicsObject *obj);
+    void Remove(size_t index);
+
+    CKContext *m_Context = nullptr;
+    CKIpionManager *m_Manager = nullptr;
+
+    std::vector<CK_ID> m_Ids;
+    std::vector<VxVector> m_Positions;
+    std::vector<VxVector> m_Angles;
+    std::vector<VxVector> m_Velocities;
+    std::vector<VxVector> m_AngularVelocities;
+
+    std::vector<uint32_t> m_Changed;
+    std::vector<CK_ID> m_Removed;
+
+    // 3D objects of the level, refreshed when their count changes and at the start of every pass over
+    // them, and which of them are tracked
+    std::vector<CK_ID> m_Candidates;
+    std::vector<uint8_t> m_Tracked;
+    int m_CandidateCount = -1;
+    size_t m_ScanPos = 0;
+};
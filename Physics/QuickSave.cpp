@@ -0,0 +1,126 @@
+#include "QuickSave.h"
+
+#include "Physics.h"
+
+namespace {
+    // Points, lives, sector and modul states, the rest of the gameplay arrays do not change in play
+    const char *const SavedArrays[] = {"Energy", "IngameParameter", "PH"};
+
+    bool IsScalarColumn(CKDataArray *array, int column) {
+        const CK_ARRAYTYPE type = array->GetColumnType(column);
+        return type == CKARRAYTYPE_INT || type == CKARRAYTYPE_FLOAT || type == CKARRAYTYPE_OBJECT;
+    }
+
+    template<typename Func>
+    void ForEachScalarColumn(CKDataArray *array, Func func) {
+        for (int c = 0; c < array->GetColumnCount(); ++c) {
+            if (IsScalarColumn(array, c))
+                func(c);
+        }
+    }
+}
+
+void QuickSave::Reset(IBML *bml, CKIpionManager *manager) {
+    m_BML = bml;
+    m_Manager = manager;
+    m_Bodies.clear();
+    m_Values.clear();
+    m_Ball = 0;
+    m_Valid = false;
+}
+
+void QuickSave::Reserve() {
+    if (!m_BML)
+        return;
+
+    m_Bodies.reserve(m_BML->GetCKContext()->GetObjectsCountByClassID(CKCID_3DOBJECT));
+
+    size_t values = 0;
+    for (const char *name : SavedArrays) {
+        CKDataArray *array = m_BML->GetArrayByName(name);
+        if (array)
+            values += 2 + (size_t) array->GetRowCount() * array->GetColumnCount();
+    }
+    m_Values.reserve(values);
+}
+
+bool QuickSave::Save(CK3dEntity *ball) {
+    if (!m_BML || !m_Manager || !ball || !m_Manager->GetPhysicsObject(ball))
+        return false;
+
+    CKContext *context = m_BML->GetCKContext();
+    const int count = context->GetObjectsCountByClassID(CKCID_3DOBJECT);
+    const CK_ID *ids = context->GetObjectsListByClassID(CKCID_3DOBJECT);
+
+    m_Bodies.clear();
+    for (int i = 0; i < count; ++i) {
+        auto *entity = (CK3dEntity *) context->GetObject(ids[i]);
+        IPhysicsObject *obj = entity ? m_Manager->GetPhysicsObject(entity) : nullptr;
+        if (!obj || !obj->IsMovable())
+            continue;
+
+        Body &body = m_Bodies.emplace_back();
+        body.id = ids[i];
+        obj->GetPosition(&body.position, &body.angles);
+        obj->GetVelocity(&body.velocity, &body.angularVelocity);
+    }
+
+    m_Values.clear();
+    for (const char *name : SavedArrays) {
+        CKDataArray *array = m_BML->GetArrayByName(name);
+        const int rows = array ? array->GetRowCount() : 0;
+        m_Values.push_back(rows);
+        const size_t header = m_Values.size();
+        m_Values.push_back(0);
+        for (int r = 0; r < rows; ++r) {
+            ForEachScalarColumn(array, [&](int c) {
+                int value = 0;
+                array->GetElementValue(r, c, &value);
+                m_Values.push_back(value);
+            });
+        }
+        m_Values[header] = (int) (m_Values.size() - header - 1);
+    }
+
+    m_Ball = ball->GetID();
+    m_Valid = true;
+    return true;
+}
+
+bool QuickSave::Load(CK3dEntity *ball) {
+    if (!m_Valid || !ball || ball->GetID() != m_Ball || !m_Manager->GetPhysicsObject(ball))
+        return false;
+
+    // Objects deleted or unphysicalized since the save are left out
+    CKContext *context = m_BML->GetCKContext();
+    for (const Body &body : m_Bodies) {
+        auto *entity = (CK3dEntity *) context->GetObject(body.id);
+        IPhysicsObject *obj = entity ? m_Manager->GetPhysicsObject(entity) : nullptr;
+        if (!obj)
+            continue;
+
+        obj->SetPosition(body.position, body.angles, true);
+        obj->SetVelocity(&body.velocity, &body.angularVelocity);
+        if (body.velocity.SquareMagnitude() > 0.0f || body.angularVelocity.SquareMagnitude() > 0.0f)
+            obj->Wake();
+    }
+
+    // Arrays whose rows changed since the save are left as they are
+    size_t pos = 0;
+    for (const char *name : SavedArrays) {
+        CKDataArray *array = m_BML->GetArrayByName(name);
+        const int rows = m_Values[pos++];
+        const int count = m_Values[pos++];
+        if (!array || array->GetRowCount() != rows) {
+            pos += count;
+            continue;
+        }
+        for (int r = 0; r < rows; ++r) {
+            ForEachScalarColumn(array, [&](int c) {
+                int value = m_Values[pos++];
+                array->SetElementValue(r, c, &value);
+            });
+        }
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <BML/BMLAll.h>
+
+class CKIpionManager;
+
+// The dynamic state of the level kept in memory for practice: position, angles and velocities of every
+// movable physics object, and the scalar columns of the gameplay arrays that go with them. Buffers are
+// reserved when the level starts, so saving or loading only copies values in place. A save outlives
+// restarts of the level, but not the map.
+class QuickSave {
+public:
+    void Reset(IBML *bml, CKIpionManager *manager);
+    void Reserve();
+
+    bool IsValid() const { return m_Valid; }
+    size_t GetBodyCount() const { return m_Bodies.size(); }
+
+    bool Save(CK3dEntity *ball);
+
+    // Fails if the ball is not the one saved or not physicalized
+    bool Load(CK3dEntity *ball);
+
+private:
+    struct Body {
+        CK_ID id;
+        VxVector position;
+        VxVector angles;
+        VxVector velocity;
+        VxVector angularVelocity;
+    };
+
+    IBML *m_BML = nullptr;
+    CKIpionManager *m_Manager = nullptr;
+
+    std::vector<Body> m_Bodies;
+    std::vector<int> m_Values; // For each array its row count and value count, then its scalar values row by row
+    CK_ID m_Ball = 0;
+    bool m_Valid = false;
+};
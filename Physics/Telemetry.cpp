@@ -0,0 +1,281 @@
+#include "Telemetry.h"
+
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+
+const char *const TelemetryChannelNames[TC_COUNT] = {
+    "Position X", "Position Y", "Position Z",
+    "Pitch", "Yaw", "Roll",
+    "Velocity X", "Velocity Y", "Velocity Z",
+    "Angular Velocity X", "Angular Velocity Y", "Angular Velocity Z",
+    "Speed Damping", "Rot Damping",
+};
+
+void XorStream::Put(float value) {
+    const auto bits = std::bit_cast<uint32_t>(value);
+    const uint32_t x = bits ^ (2 * m_Last - m_Prev);
+    m_Prev = m_Last;
+    m_Last = bits;
+
+    if (x == 0) {
+        Write(0, 1);
+        return;
+    }
+
+    const int lead = std::countl_zero(x);
+    const int trail = std::countr_zero(x);
+    if (m_Lead >= 0 && lead >= m_Lead && trail >= m_Trail) {
+        Write(0b10, 2);
+        Write(x >> m_Trail, 32 - m_Lead - m_Trail);
+    } else {
+        const int length = 32 - lead - trail;
+        Write(0b11, 2);
+        Write(lead, 5);
+        Write(length - 1, 5);
+        Write(x >> trail, length);
+        m_Lead = lead;
+        m_Trail = trail;
+    }
+}
+
+void XorStream::Write(uint64_t bits, int count) {
+    const size_t offset = m_Bits & 63;
+    if (offset == 0)
+        m_Words.push_back(0);
+
+    // Bits go from the most significant end of each word
+    const int room = 64 - (int) offset;
+    if (count <= room) {
+        m_Words.back() |= bits << (room - count);
+    } else {
+        m_Words.back() |= bits >> (count - room);
+        m_Words.push_back(bits << (64 - (count - room)));
+    }
+    m_Bits += count;
+}
+
+float XorStream::Reader::Next() {
+    uint32_t x = 0;
+    if (Read(1)) {
+        if (Read(1)) {
+            m_Lead = (int) Read(5);
+            const int length = (int) Read(5) + 1;
+            m_Trail = 32 - m_Lead - length;
+        }
+        x = (uint32_t) (Read(32 - m_Lead - m_Trail) << m_Trail);
+    }
+
+    const uint32_t bits = x ^ (2 * m_Last - m_Prev);
+    m_Prev = m_Last;
+    m_Last = bits;
+    return std::bit_cast<float>(bits);
+}
+
+uint64_t XorStream::Reader::Read(int count) {
+    const auto &words = m_Stream.m_Words;
+    if (m_Pos + count > m_Stream.m_Bits)
+        return 0;
+
+    const size_t offset = m_Pos & 63;
+    const int room = 64 - (int) offset;
+    const uint64_t mask = count == 64 ? ~0ull : (1ull << count) - 1;
+    uint64_t bits;
+    if (count <= room) {
+        bits = words[m_Pos >> 6] >> (room - count);
+    } else {
+        bits = words[m_Pos >> 6] << (count - room);
+        bits |= words[(m_Pos >> 6) + 1] >> (64 - (count - room));
+    }
+    m_Pos += count;
+    return bits & mask;
+}
+
+size_t TelemetryBlock::GetSize() const {
+    size_t size = sizeof(TelemetryBlock);
+    for (const auto &channel : channels)
+        size += channel.GetWords().capacity() * sizeof(uint64_t);
+    return size;
+}
+
+void TelemetryRing::Clear() {
+    m_Blocks.clear();
+    m_Open.reset();
+    m_Size = 0;
+    m_Samples = 0;
+}
+
+std::shared_ptr<const TelemetryBlock> TelemetryRing::Add(const float (&values)[TC_COUNT]) {
+    if (!m_Open)
+        m_Open = std::make_shared<TelemetryBlock>();
+
+    for (int i = 0; i < TC_COUNT; i++)
+        m_Open->channels[i].Put(values[i]);
+    if (++m_Open->count < TelemetryBlock::SAMPLES)
+        return nullptr;
+    return Seal();
+}
+
+std::shared_ptr<const TelemetryBlock> TelemetryRing::Seal() {
+    if (!m_Open || m_Open->count == 0)
+        return nullptr;
+
+    for (auto &channel : m_Open->channels)
+        channel.Shrink();
+    std::shared_ptr<const TelemetryBlock> block = std::move(m_Open);
+    Push(block);
+    return block;
+}
+
+void TelemetryRing::Decimate(int channel, size_t samples, size_t buckets, std::vector<float> &out) const {
+    out.clear();
+    samples = std::min(samples, GetSampleCount());
+    if (samples == 0 || buckets == 0 || channel < 0 || channel >= TC_COUNT)
+        return;
+    buckets = std::min(buckets, samples);
+    out.resize(buckets * 2);
+    for (size_t b = 0; b < buckets; b++) {
+        out[b * 2] = FLT_MAX;
+        out[b * 2 + 1] = -FLT_MAX;
+    }
+
+    // Blocks are only decoded from the first one holding a wanted sample
+    size_t skip = GetSampleCount() - samples;
+    size_t index = 0;
+    auto scan = [&](const TelemetryBlock &block) {
+        if (skip >= block.count) {
+            skip -= block.count;
+            return;
+        }
+        XorStream::Reader reader(block.channels[channel]);
+        for (size_t i = 0; i < block.count; i++) {
+            const float value = reader.Next();
+            if (skip > 0) {
+                skip--;
+                continue;
+            }
+            const size_t b = index++ * buckets / samples;
+            out[b * 2] = std::min(out[b * 2], value);
+            out[b * 2 + 1] = std::max(out[b * 2 + 1], value);
+        }
+    };
+
+    for (const auto &block : m_Blocks)
+        scan(*block);
+    if (m_Open)
+        scan(*m_Open);
+}
+
+void TelemetryRing::Push(std::shared_ptr<const TelemetryBlock> block) {
+    m_Size += block->GetSize();
+    m_Samples += block->count;
+    m_Blocks.push_back(std::move(block));
+
+    while (m_Size > m_Budget && m_Blocks.size() > 1) {
+        m_Size -= m_Blocks.front()->GetSize();
+        m_Samples -= m_Blocks.front()->count;
+        m_Blocks.pop_front();
+    }
+}
+
+void TelemetryWriter::Start() {
+    if (m_Worker.joinable())
+        return;
+
+    m_Stop = false;
+    m_Worker = std::thread(&TelemetryWriter::Run, this);
+}
+
+void TelemetryWriter::Stop() {
+    if (!m_Worker.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Wake.notify_one();
+    m_Worker.join();
+}
+
+void TelemetryWriter::Open(const std::string &path) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        Job job;
+        job.path = path;
+        m_Jobs.push_back(std::move(job));
+    }
+    m_Wake.notify_one();
+}
+
+void TelemetryWriter::Write(std::shared_ptr<const TelemetryBlock> block) {
+    if (!block)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        Job job;
+        job.block = std::move(block);
+        m_Jobs.push_back(std::move(job));
+    }
+    m_Wake.notify_one();
+}
+
+void TelemetryWriter::Close() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        Job job;
+        job.close = true;
+        m_Jobs.push_back(std::move(job));
+    }
+    m_Wake.notify_one();
+}
+
+void TelemetryWriter::Run() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true) {
+        m_Wake.wait(lock, [this] { return m_Stop || !m_Jobs.empty(); });
+        if (m_Jobs.empty())
+            break;
+
+        Job job = std::move(m_Jobs.front());
+        m_Jobs.pop_front();
+        lock.unlock();
+        Process(job);
+        lock.lock();
+    }
+
+    if (m_File) {
+        fclose(m_File);
+        m_File = nullptr;
+    }
+}
+
+void TelemetryWriter::Process(const Job &job) {
+    if (job.close || !job.path.empty()) {
+        if (m_File) {
+            fclose(m_File);
+            m_File = nullptr;
+        }
+        if (job.close)
+            return;
+
+        m_File = fopen(job.path.c_str(), "wb");
+        if (m_File) {
+            const uint32_t header[] = {MAGIC, VERSION, TC_COUNT};
+            fwrite(header, sizeof(header), 1, m_File);
+        }
+        return;
+    }
+
+    if (!m_File || !job.block)
+        return;
+
+    const auto count = (uint32_t) job.block->count;
+    fwrite(&count, sizeof(count), 1, m_File);
+    for (const auto &channel : job.block->channels) {
+        const auto bits = (uint32_t) channel.GetBitCount();
+        fwrite(&bits, sizeof(bits), 1, m_File);
+        fwrite(channel.GetWords().data(), sizeof(uint64_t), (bits + 63) / 64, m_File);
+    }
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum TelemetryChannel {
+    TC_POSITION_X,
+    TC_POSITION_Y,
+    TC_POSITION_Z,
+    TC_PITCH,
+    TC_YAW,
+    TC_ROLL,
+    TC_VELOCITY_X,
+    TC_VELOCITY_Y,
+    TC_VELOCITY_Z,
+    TC_ANGULAR_VELOCITY_X,
+    TC_ANGULAR_VELOCITY_Y,
+    TC_ANGULAR_VELOCITY_Z,
+    TC_SPEED_DAMPING,
+    TC_ROT_DAMPING,
+    TC_COUNT
+};
+
+extern const char *const TelemetryChannelNames[TC_COUNT];
+
+// The values of a channel, each stored as its XOR with a prediction from the last two as in Gorilla:
+//   0                                  the prediction was exact
+//   10 <bits>                          the changed bits fit in the window of the last ones
+//   11 <5 leading zeros> <5 length-1> <bits>
+// The prediction extends the line through the bit patterns of the last two values, which leaves fewer
+// changed bits than the last value alone would for positions and angles, as they change steadily from
+// tick to tick. Integer arithmetic keeps it exact whatever the floating point model.
+class XorStream {
+public:
+    class Reader {
+    public:
+        explicit Reader(const XorStream &stream) : m_Stream(stream) {}
+
+        float Next();
+
+    private:
+        uint64_t Read(int count);
+
+        const XorStream &m_Stream;
+        size_t m_Pos = 0;
+        uint32_t m_Last = 0;
+        uint32_t m_Prev = 0;
+        int m_Lead = -1;
+        int m_Trail = 0;
+    };
+
+    void Put(float value);
+    void Shrink() { m_Words.shrink_to_fit(); }
+
+    size_t GetBitCount() const { return m_Bits; }
+    const std::vector<uint64_t> &GetWords() const { return m_Words; }
+
+private:
+    void Write(uint64_t bits, int count);
+
+    std::vector<uint64_t> m_Words;
+    size_t m_Bits = 0;
+    uint32_t m_Last = 0;
+    uint32_t m_Prev = 0;
+    int m_Lead = -1;
+    int m_Trail = 0;
+};
+
+struct TelemetryBlock {
+    static constexpr size_t SAMPLES = 1024;
+
+    size_t count = 0;
+    XorStream channels[TC_COUNT];
+
+    size_t GetSize() const;
+};
+
+// Values of every channel per tick, compressed in blocks. Filled blocks are immutable and shared with
+// the writer, the oldest ones are dropped once the blocks take more than the budget.
+class TelemetryRing {
+public:
+    explicit TelemetryRing(size_t budget) : m_Budget(budget) {}
+
+    void Clear();
+
+    // Returns the block the values filled, null if it still has room
+    std::shared_ptr<const TelemetryBlock> Add(const float (&values)[TC_COUNT]);
+
+    // Closes the open block however short it is, null if it is empty
+    std::shared_ptr<const TelemetryBlock> Seal();
+
+    size_t GetSampleCount() const { return m_Samples + (m_Open ? m_Open->count : 0); }
+    size_t GetSize() const { return m_Size + (m_Open ? m_Open->GetSize() : 0); }
+
+    // Min and max of the last samples of the channel split into buckets, interleaved for PlotLines
+    void Decimate(int channel, size_t samples, size_t buckets, std::vector<float> &out) const;
+
+private:
+    void Push(std::shared_ptr<const TelemetryBlock> block);
+
+    const size_t m_Budget;
+    std::deque<std::shared_ptr<const TelemetryBlock>> m_Blocks;
+    std::shared_ptr<TelemetryBlock> m_Open;
+    size_t m_Size = 0;
+    size_t m_Samples = 0;
+};
+
+// Appends blocks to the file opened last on a worker thread.
+//
+// File: [magic][version][channel count], then for each block its sample count and for each channel
+// its bit count and the 64-bit words holding them.
+class TelemetryWriter {
+public:
+    static constexpr uint32_t MAGIC = 0x4D4C5450; // "PTLM"
+    static constexpr uint32_t VERSION = 1;
+
+    TelemetryWriter() = default;
+    TelemetryWriter(const TelemetryWriter &) = delete;
+    TelemetryWriter &operator=(const TelemetryWriter &) = delete;
+    ~TelemetryWriter() { Stop(); }
+
+    void Start();
+
+    // Writes the queued blocks, closes the file and stops the worker
+    void Stop();
+
+    void Open(const std::string &path);
+    void Write(std::shared_ptr<const TelemetryBlock> block);
+    void Close();
+
+private:
+    struct Job {
+        std::string path;
+        bool close = false;
+        std::shared_ptr<const TelemetryBlock> block;
+    };
+
+    void Run();
+    void Process(const Job &job);
+
+    std::thread m_Worker;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    bool m_Stop = false;
+    std::deque<Job> m_Jobs;
+
+    FILE *m_File = nullptr; // Worker only
+};
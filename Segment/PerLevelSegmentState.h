@@ -1,17 +1,25 @@
 #pragma once
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
 
 class PerLevelSegmentState {
 public:
     explicit PerLevelSegmentState(const size_t segment_count)
         : segment_time_(segment_count, 0.0f),
-          segment_time_to_compare_(segment_count, -1.0f) {}
+          segment_time_to_compare_(segment_count, -1.0f),
+          history_(segment_count),
+          best_(segment_count, -1.0f),
+          median_(segment_count, -1.0f),
+          best_after_(segment_count + 1, 0.0f),
+          median_after_(segment_count + 1, 0.0f),
+          missing_after_(segment_count + 1, 0) {
+        refresh_history_figures();
+    }
 
-    PerLevelSegmentState(PerLevelSegmentState &&other) noexcept
-        : is_counting_(other.is_counting_),
-          current_segment_(other.current_segment_),
-          segment_time_(std::move(other.segment_time_)) {}
+    PerLevelSegmentState(PerLevelSegmentState &&other) noexcept = default;
 
     void enable_counting(bool enabled) {
         is_counting_ = enabled;
@@ -20,6 +28,7 @@ public:
     void update(const float dt) {
         if (!is_counting_) return;
         segment_time_[current_segment_] += dt;
+        refresh_prediction();
     }
 
     void update_target_figures() {
@@ -30,17 +39,53 @@ public:
             if (segment_time_[i] > 0 && (segment_time_[i] < segment_time_to_compare_[i] || segment_time_to_compare_[i] < 0))
                 segment_time_to_compare_[i] = segment_time_[i];
         }
+
+        // Each completed segment of the run enters the history once, however often this is called
+        const int completed = std::min(current_segment_, static_cast<int>(size()));
+        for (int i = committed_; i < completed; ++i) {
+            if (segment_time_[i] > 0)
+                add_history(i, static_cast<int32_t>(std::lround(segment_time_[i] * 1000.0f)));
+        }
+        committed_ = std::max(committed_, completed);
     }
 
     void reset() {
         update_target_figures();
         is_counting_ = false;
         current_segment_ = 0;
+        committed_ = 0;
+        elapsed_before_ = 0.0f;
         std::fill(segment_time_.begin(), segment_time_.end(), 0.0f);
+        refresh_prediction();
     }
 
     void clear_history() {
         std::fill(segment_time_to_compare_.begin(), segment_time_to_compare_.end(), -1.0f);
+        for (auto &times: history_)
+            times.clear();
+        history_events_.emplace_back(-1, 0);
+        refresh_history_figures();
+    }
+
+    // Adds a completed time in milliseconds
+    void add_history(const int seg, const int32_t ms) {
+        auto &times = history_[seg];
+        times.insert(std::upper_bound(times.begin(), times.end(), ms), ms);
+        history_events_.emplace_back(seg, ms);
+        refresh_history_figures();
+    }
+
+    // Replaces the completed times of a segment with saved ones
+    void load_history(const size_t seg, std::vector<int32_t> times) {
+        std::sort(times.begin(), times.end());
+        history_[seg] = std::move(times);
+        refresh_history_figures();
+    }
+
+    // Completed times added or histories cleared (segment -1) since the last call
+    void take_history_events(std::vector<std::pair<int, int32_t>> &events) {
+        events.clear();
+        events.swap(history_events_);
     }
 
     void reset_segment(const int seg) {
@@ -53,6 +98,11 @@ public:
         else
             enable_counting(false);
         current_segment_ = seg;
+
+        elapsed_before_ = 0.0f;
+        for (int i = 0; i < seg && i < static_cast<int>(size()); ++i)
+            elapsed_before_ += segment_time_[i];
+        refresh_prediction();
     }
 
     float &segment(const size_t segment) {
@@ -71,6 +121,20 @@ public:
         return segment_time_to_compare_[segment];
     }
 
+    const std::vector<float> &segment_targets() const {
+        return segment_time_to_compare_;
+    }
+
+    // Figures of the completed times, in seconds, -1 without enough history
+    float segment_best(const size_t segment) const { return best_[segment]; }
+    float segment_median(const size_t segment) const { return median_[segment]; }
+    size_t segment_history_size(const size_t segment) const { return history_[segment].size(); }
+    float sum_of_best() const { return missing_after_[0] == 0 ? best_after_[0] : -1.0f; }
+
+    // Final time of the run if the rest of it went as the best, or the median, of each segment
+    float best_possible_time() const { return best_possible_; }
+    float predicted_time() const { return predicted_; }
+
     int get_current_segment() const {
         return current_segment_;
     }
@@ -89,8 +153,62 @@ public:
     bool is_saving_ = true;
 
 private:
+    // Runs whenever a completed time is added, the suffix sums let the prediction follow each tick in O(1)
+    void refresh_history_figures() {
+        const size_t count = size();
+        for (size_t i = 0; i < count; ++i) {
+            const auto &times = history_[i];
+            if (times.empty()) {
+                best_[i] = median_[i] = -1.0f;
+                continue;
+            }
+            const size_t mid = times.size() / 2;
+            best_[i] = times.front() / 1000.0f;
+            median_[i] = (times.size() % 2 ? times[mid] : (times[mid - 1] + times[mid]) / 2.0f) / 1000.0f;
+        }
+
+        best_after_[count] = median_after_[count] = 0.0f;
+        missing_after_[count] = 0;
+        for (size_t i = count; i-- > 0;) {
+            const bool missing = history_[i].empty();
+            best_after_[i] = best_after_[i + 1] + (missing ? 0.0f : best_[i]);
+            median_after_[i] = median_after_[i + 1] + (missing ? 0.0f : median_[i]);
+            missing_after_[i] = missing_after_[i + 1] + (missing ? 1 : 0);
+        }
+        refresh_prediction();
+    }
+
+    void refresh_prediction() {
+        const size_t count = size();
+        const size_t seg = std::min(static_cast<size_t>(std::max(current_segment_, 0)), count);
+        if (seg == count) {
+            best_possible_ = predicted_ = elapsed_before_;
+        } else if (missing_after_[seg] > 0) {
+            best_possible_ = predicted_ = -1.0f;
+        } else {
+            // The current segment takes at least the time already spent in it
+            const float time = segment_time_[seg];
+            best_possible_ = elapsed_before_ + std::max(time, best_[seg]) + best_after_[seg + 1];
+            predicted_ = elapsed_before_ + std::max(time, median_[seg]) + median_after_[seg + 1];
+        }
+    }
+
     bool is_counting_ = false;
     int current_segment_ = 0;
     std::vector<float> segment_time_;
     std::vector<float> segment_time_to_compare_;
+
+    // Completed times of each segment in milliseconds, sorted, and the figures derived from them
+    std::vector<std::vector<int32_t>> history_;
+    std::vector<float> best_;
+    std::vector<float> median_;
+    std::vector<float> best_after_;
+    std::vector<float> median_after_;
+    std::vector<int> missing_after_;
+    std::vector<std::pair<int, int32_t>> history_events_;
+    int committed_ = 0;
+
+    float elapsed_before_ = 0.0f;
+    float best_possible_ = -1.0f;
+    float predicted_ = -1.0f;
 };
@@ -2,6 +2,136 @@
 
 #include "CommandSeg.h"
 
+namespace {
+    // SAX contexts for the records of versions before the journal, read without building a DOM:
+    // [{"<map path>": {"name": "<level name>", "segments": [<target>, ...]}}, ...]
+    // Anything a context does not take fails the parse.
+    class deny_context : public picojson::deny_parse_context {
+    public:
+        bool parse_object_stop() { return false; }
+    };
+
+    class number_context : public deny_context {
+    public:
+        explicit number_context(float &value) : value_(value) {}
+
+#ifdef PICOJSON_USE_INT64
+        bool set_int64(const int64_t value) {
+            value_ = static_cast<float>(value);
+            return true;
+        }
+#endif
+        bool set_number(const double value) {
+            value_ = static_cast<float>(value);
+            return true;
+        }
+
+    private:
+        float &value_;
+    };
+
+    class string_context : public deny_context {
+    public:
+        explicit string_context(std::string &value) : value_(value) {}
+
+        template<typename Iter>
+        bool parse_string(picojson::input<Iter> &in) {
+            value_.clear();
+            return picojson::_parse_string(value_, in);
+        }
+
+    private:
+        std::string &value_;
+    };
+
+    class targets_context : public deny_context {
+    public:
+        explicit targets_context(std::vector<float> &targets) : targets_(targets) {}
+
+        bool parse_array_start() {
+            targets_.clear();
+            return true;
+        }
+
+        template<typename Iter>
+        bool parse_array_item(picojson::input<Iter> &in, size_t) {
+            number_context ctx(targets_.emplace_back());
+            return picojson::_parse(ctx, in);
+        }
+
+        bool parse_array_stop(size_t) { return true; }
+
+    private:
+        std::vector<float> &targets_;
+    };
+
+    class level_context : public deny_context {
+    public:
+        explicit level_context(SegmentJournal::map_record &record) : record_(record) {}
+
+        bool parse_object_start() { return true; }
+
+        template<typename Iter>
+        bool parse_object_item(picojson::input<Iter> &in, const std::string &key) {
+            if (key == "name") {
+                string_context ctx(record_.name);
+                has_name_ = true;
+                return picojson::_parse(ctx, in);
+            }
+            if (key == "segments") {
+                targets_context ctx(record_.targets);
+                has_segments_ = true;
+                return picojson::_parse(ctx, in);
+            }
+            picojson::null_parse_context ctx;
+            return picojson::_parse(ctx, in);
+        }
+
+        bool parse_object_stop() { return has_name_ && has_segments_; }
+
+    private:
+        SegmentJournal::map_record &record_;
+        bool has_name_ = false;
+        bool has_segments_ = false;
+    };
+
+    class maps_context : public deny_context {
+    public:
+        explicit maps_context(SegmentJournal::map_records &records) : records_(records) {}
+
+        bool parse_object_start() { return true; }
+
+        template<typename Iter>
+        bool parse_object_item(picojson::input<Iter> &in, const std::string &key) {
+            level_context ctx(records_[key]);
+            return picojson::_parse(ctx, in);
+        }
+
+        bool parse_object_stop() { return true; }
+
+    private:
+        SegmentJournal::map_records &records_;
+    };
+
+    class records_context : public deny_context {
+    public:
+        explicit records_context(SegmentJournal::map_records &records) : records_(records) {}
+
+        bool parse_array_start() { return true; }
+
+        template<typename Iter>
+        bool parse_array_item(picojson::input<Iter> &in, size_t) {
+            maps_context ctx(records_);
+            return picojson::_parse(ctx, in);
+        }
+
+        bool parse_array_stop(size_t) { return true; }
+
+    private:
+        SegmentJournal::map_records &records_;
+    };
+}
+
 IMod *BMLEntry(IBML *bml) {
     return new Segment(bml);
 }
@@ -25,7 +155,15 @@ void Segment::OnLoad() {
 
     m_BML->RegisterCommand(new CommandSeg(this));
 
-    load_sessions_from_file();
+    // Saving over records not moved yet would hide them from the next attempt
+    if (migrate_records())
+        journal_.start();
+    else
+        GetLogger()->Warn("Segment records will not be saved until they have been moved into shards.");
+}
+
+void Segment::OnUnload() {
+    journal_.stop();
 }
 
 void Segment::OnModifyConfig(const char *category, const char *key, IProperty *prop) {
@@ -50,8 +188,11 @@ void Segment::OnLoadObject(const char *filename, CKBOOL isMap, const char *maste
     //state_ = std::make_unique<PerLevelSegmentState>(sector_count);
     //gui_ = std::make_unique<SegmentGui>(*state_, get_current_level());
 
+    // Only the shard of this map is read, the first time it is loaded
     if (sessions_.find(filename) == sessions_.end()) {
-        if (!is_custom_map(filename))
+        if (auto loaded = load_session(filename))
+            sessions_[filename] = std::move(loaded);
+        else if (!is_custom_map(filename))
             sessions_[filename] = std::make_shared<session>(current_level, sector_count);
         else {
             CKPathSplitter splitter(const_cast<char*>(filename));
@@ -61,6 +202,7 @@ void Segment::OnLoadObject(const char *filename, CKBOOL isMap, const char *maste
     }
 
     session_ = sessions_[filename];
+    session_path_ = filename;
     session_->gui.set_cursor_visible(true);
     session_->gui.set_settings_visible_(show_settings_->GetBoolean());
     session_->gui.set_font_scale(font_scale_->GetFloat());
@@ -71,7 +213,7 @@ void Segment::OnPreExitLevel() {
     session_->state.enable_counting(false);
     if (!cheat_enabled_once_)
         session_->state.update_target_figures();
-    save_pico_to_file(serialize_sessions_to_pico());
+    save_session();
     cheat_enabled_once_ = false;
 }
 
@@ -94,7 +236,7 @@ void Segment::OnPreEndLevel() {
     session_->state.change_segment(get_current_sector() + 1);
     if (!cheat_enabled_once_)
         session_->state.update_target_figures();
-    save_pico_to_file(serialize_sessions_to_pico());
+    save_session();
     cheat_enabled_once_ = false;
 }
 
@@ -134,7 +276,7 @@ void Segment::OnPreResetLevel() {
     session_->state.enable_counting(false);
     if (!cheat_enabled_once_)
         session_->state.update_target_figures();
-    save_pico_to_file(serialize_sessions_to_pico());
+    save_session();
     cheat_enabled_once_ = false;
 }
 
@@ -142,108 +284,58 @@ void Segment::OnPostCheckpointReached() {
     session_->state.change_segment(get_current_sector());
 }
 
-picojson::value Segment::serialize_sessions_to_pico(serialize_from_t serialize_from) const {
-    picojson::array records;
-    for (const auto &[path, session]: sessions_) {
-        picojson::object map_obj;
-
-        picojson::object level_obj;
-        picojson::array arr;
-        const auto &state = session->state;
-        switch (serialize_from) {
-            case serialize_from_t::Target:
-                for (size_t i = 0; i < state.size(); ++i) {
-                    arr.emplace_back(state.segment_target(i));
-                }
-                break;
-            case serialize_from_t::Current:
-                for (size_t i = 0; i < state.size(); ++i) {
-                    arr.emplace_back(state.segment(i));
-                }
-                break;
-            default:
-                assert(false);
-        }
+void Segment::save_session() {
+    if (!session_)
+        return;
+    std::vector<std::pair<int, int32_t>> history;
+    session_->state.take_history_events(history);
+    journal_.record(session_path_, session_->gui.current_level_name_, session_->state.segment_targets(),
+                    session_->saved_targets, history);
+}
 
-        level_obj.emplace("name", session->gui.current_level_name_);
-        level_obj.emplace("segments", arr);
-        map_obj.emplace(path, level_obj);
+std::shared_ptr<Segment::session> Segment::load_session(const std::string &path) {
+    SegmentJournal::map_record record;
+    if (!journal_.load(path, record))
+        return nullptr;
 
-        records.emplace_back(map_obj);
+    auto loaded = std::make_shared<session>(record.name, record.targets.size());
+    for (size_t j = 0; j < record.targets.size(); ++j) {
+        loaded->state.segment_target(j) = record.targets[j];
+        loaded->state.load_history(j, record.history[j]);
     }
-    picojson::value v(records);
-    return v;
+    loaded->saved_targets = record.targets;
+    return loaded;
 }
 
-void Segment::save_pico_to_file(const picojson::value &v) {
-    //std::string path = (std::filesystem::current_path() / RECORD_SAVE_PATH).lexically_normal().string();
-    std::ofstream fs(RECORD_SAVE_PATH, std::ios::trunc);
-    fs << v.serialize();
-    fs.close();
-}
+bool Segment::migrate_records() {
+    if (journal_.exists())
+        return true;
 
-bool Segment::load_sessions_from_file() {
-    picojson::value v;
-    std::ifstream fs(RECORD_SAVE_PATH);
-    fs >> v;
-    std::string err = picojson::get_last_error();
-    if (!err.empty()) {
-        GetLogger()->Warn("Error loading sessions from file.");
-        GetLogger()->Warn(err.c_str());
-
-        sessions_.clear();
+    // First run with the shards, they start with everything the old records hold
+    SegmentJournal::map_records records;
+    if (!load_records_from_file(records))
         return false;
-    }
-
-    if (!v.is<picojson::array>()) {
-        GetLogger()->Error("Outermost array in illegal form.");
-
-        sessions_.clear();
+    if (!journal_.create(records)) {
+        GetLogger()->Warn("Error moving sessions into shards.");
         return false;
     }
-    picojson::array records = v.get<picojson::array>();
-
-    for (const auto &record: records) {
-        if (!record.is<picojson::object>()) {
-            GetLogger()->Error("Record object in illegal form.");
-
-            sessions_.clear();
-            return false;
-        }
-        picojson::object map_obj = record.get<picojson::object>();
-
-        for (picojson::value::object::const_iterator i = map_obj.begin(); i != map_obj.end(); ++i) {
-            if (!i->second.is<picojson::object>()) {
-                GetLogger()->Error("Level object in illegal form.");
-
-                sessions_.clear();
-                return false;
-            }
-            picojson::object obj = i->second.get<picojson::object>();
-
-            if (!obj.contains("name") || !obj["name"].is<std::string>()) {
-                GetLogger()->Error("Level object does not have \'name\' field.");
-
-                sessions_.clear();
-                return false;
-            }
-            std::string name = obj["name"].get<std::string>();
+    return true;
+}
 
-            if (!obj.contains("segments") || !obj["segments"].is<picojson::array>()) {
-                GetLogger()->Error("Level object does not have \'segments\' field.");
+bool Segment::load_records_from_file(SegmentJournal::map_records &records) {
+    std::ifstream fs(RECORD_SAVE_PATH, std::ios::binary);
+    if (!fs)
+        return true;
 
-                sessions_.clear();
-                return false;
-            }
-            const auto &arr = obj["segments"].get<picojson::array>();
+    std::string err;
+    records_context ctx(records);
+    picojson::_parse(ctx, std::istreambuf_iterator<char>(fs.rdbuf()), std::istreambuf_iterator<char>(), &err);
+    if (!err.empty()) {
+        GetLogger()->Warn("Error loading sessions from file.");
+        GetLogger()->Warn(err.c_str());
 
-            sessions_[i->first] = std::make_shared<session>(name, arr.size());
-            auto &state = sessions_[i->first]->state;
-            for (size_t j = 0; j < state.size(); ++j) {
-                state.segment_target(j) = static_cast<float>(arr[j].get<double>());
-            }
-        }
+        records.clear();
+        return false;
     }
-
     return true;
-}
\ No newline at end of file
+}
@@ -9,6 +9,7 @@
 
 #include "PerLevelSegmentState.h"
 #include "SegmentGui.h"
+#include "SegmentJournal.h"
 
 #include "picojson.h"
 
@@ -33,6 +34,7 @@ public:
     DECLARE_BML_VERSION;
 
     void OnLoad() override;
+    void OnUnload() override;
     void OnModifyConfig(const char *category, const char *key, IProperty *prop) override;
     void OnPreEndLevel() override;
     void OnCounterActive() override;
@@ -68,6 +70,7 @@ public:
 private:
     const static inline std::string SEG_VERSION = std::format("{}.{}.{}", SEG_MAJOR_VER, SEG_MINOR_VER, SEG_PATCH_VER);
     const static inline std::string RECORD_SAVE_PATH = "../ModLoader/Configs/SegmentRecords.json";
+    const static inline std::string RECORD_SHARD_DIR = "../ModLoader/Configs/SegmentRecords";
 
     struct session {
         session(const int current_level, const int sector_count): state(sector_count), gui(state, current_level) {
@@ -79,25 +82,31 @@ private:
 
         PerLevelSegmentState state;
         SegmentGui gui;
+
+        // Target figures as last written to the journal
+        std::vector<float> saved_targets;
     };
 
     std::unordered_map<std::string, std::shared_ptr<session>> sessions_;
     std::shared_ptr<session> session_;
+    std::string session_path_;
+    SegmentJournal journal_{RECORD_SHARD_DIR};
     bool cheat_enabled_once_ = false;
 
     IProperty *font_scale_ = nullptr;
     IProperty *show_settings_ = nullptr;
 
-    enum class serialize_from_t {
-        Current,
-        Target
-    };
+    void save_session();
 
-    picojson::value serialize_sessions_to_pico(serialize_from_t serialize_from = serialize_from_t::Target) const;
+    // Reads the session of the map from its shard, null if the map has never been saved
+    std::shared_ptr<session> load_session(const std::string &path);
 
-    void save_pico_to_file(const picojson::value &v);
+    // Moves the records of versions before the shards into them. The shards only exist once it has
+    // succeeded, until then it is tried again on every launch.
+    bool migrate_records();
 
-    bool load_sessions_from_file();
+    // Records of versions before the shards
+    bool load_records_from_file(SegmentJournal::map_records &records);
 
     static bool is_custom_map(const std::string_view filename) {
         return filename.substr(0, 11) != "3D Entities";
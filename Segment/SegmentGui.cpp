@@ -1,11 +1,48 @@
 #include "SegmentGui.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <string>
 #include <format>
 
+namespace {
+    constexpr int32_t NO_TIME = INT32_MIN;
+
+    // Times are shown to the millisecond, their labels only change with it
+    int32_t to_ms(const float time) {
+        return time < 0.f ? NO_TIME : static_cast<int32_t>(std::lround(time * 1000.0f));
+    }
+}
+
+void SegmentGui::time_label::set(const int32_t time_ms, const char *format, const char *missing) {
+    if (time_ms == ms)
+        return;
+    ms = time_ms;
+    if (ms == NO_TIME)
+        std::snprintf(text, sizeof(text), "%s", missing);
+    else
+        std::snprintf(text, sizeof(text), format, ms / 1000.0);
+}
+
+void SegmentGui::init_rows() {
+    rows_.resize(state_.size());
+    for (size_t i = 0; i < rows_.size(); ++i) {
+        rows_[i].sector = std::format("#{}", i + 1);
+        rows_[i].target_id = std::format("##seg{}", i);
+    }
+}
+
 void SegmentGui::update() {
     if (!visible_)
         return;
 
+    const auto start = std::chrono::steady_clock::now();
+    draw();
+    const std::chrono::duration<float, std::micro> cost = std::chrono::steady_clock::now() - start;
+    frame_cost_ += (cost.count() - frame_cost_) * 0.05f;
+}
+
+void SegmentGui::draw() {
     ImGui::PushStyleColor(ImGuiCol_WindowBg, bg_color);
 
     const float oldScale = ImGui::GetFont()->Scale;
@@ -22,38 +59,40 @@ void SegmentGui::update() {
                            ImGuiWindowFlags_NoNav;
 
     ImGui::Begin("Segments", nullptr, WinFlags); {
-        ImGui::Text(current_level_name_.c_str());
+        ImGui::TextUnformatted(current_level_name_.c_str());
 
-        if (ImGui::BeginTable("##Segments", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        if (ImGui::BeginTable("##Segments", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
             ImGui::TableSetupColumn("Sector", ImGuiTableColumnFlags_WidthStretch);
             ImGui::TableSetupColumn("Current", ImGuiTableColumnFlags_WidthStretch);
             ImGui::TableSetupColumn("Target", ImGuiTableColumnFlags_WidthStretch);
             ImGui::TableSetupColumn("Delta", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("Median", ImGuiTableColumnFlags_WidthStretch);
 
             ImGui::TableHeadersRow();
             for (size_t i = 0; i < state_.size(); ++i) {
+                auto &row = rows_[i];
+                const auto time = state_.segment(i);
+                auto &time_to_compare = state_.segment_target(i);
+                row.current.set(to_ms(time), "%.3fs", "----");
+                row.delta.set(time_to_compare < 0.f ? NO_TIME : to_ms(std::abs(time - time_to_compare)) *
+                                  (time < time_to_compare ? -1 : 1), "%+.3fs", "----");
+                row.median.set(to_ms(state_.segment_median(i)), "%.3fs", "----");
+
                 ImGui::TableNextRow();
 
                 ImGui::TableSetColumnIndex(0);
-                ImGui::Text("#%d", i + 1);
+                ImGui::TextUnformatted(row.sector.c_str());
                 ImGui::TableSetColumnIndex(1);
-                const auto time = state_.segment(i);
-                ImGui::Text("%.3fs", time);
+                ImGui::TextUnformatted(row.current.text);
                 ImGui::TableSetColumnIndex(2);
-                auto &time_to_compare = state_.segment_target(i);
                 ImGui::PushItemWidth(-1);
-                ImGui::DragFloat(std::format("##seg{}", i).c_str(), &time_to_compare,
+                ImGui::DragFloat(row.target_id.c_str(), &time_to_compare,
                                  0.1f, 0.0f, 1e6f,
                                  (time_to_compare >= 0.f) ? "%.3fs" : "----");
-                /*if (time_to_compare < 0.f)
-                    ImGui::Text("----");
-                else
-                    ImGui::Text("%.3fs", time_to_compare);*/
                 ImGui::TableSetColumnIndex(3);
-                if (time_to_compare < 0.f)
-                    ImGui::Text("----");
-                else
-                    ImGui::Text("%+.3fs", time - time_to_compare);
+                ImGui::TextUnformatted(row.delta.text);
+                ImGui::TableSetColumnIndex(4);
+                ImGui::TextUnformatted(row.median.text);
 
                 if (cursor_visible_ && i == state_.get_current_segment()) {
                     if (time_to_compare < 0 || std::abs(time - time_to_compare) < 1e-7)
@@ -68,10 +107,18 @@ void SegmentGui::update() {
             ImGui::EndTable();
         }
 
+        sum_of_best_.set(to_ms(state_.sum_of_best()), "Sum of Best %.3fs", "Sum of Best ----");
+        best_possible_.set(to_ms(state_.best_possible_time()), "Best Possible %.3fs", "Best Possible ----");
+        predicted_.set(to_ms(state_.predicted_time()), "Predicted %.3fs", "Predicted ----");
+        ImGui::TextUnformatted(sum_of_best_.text);
+        ImGui::TextUnformatted(best_possible_.text);
+        ImGui::TextUnformatted(predicted_.text);
+
         if (settings_visible_ && ImGui::TreeNode("History Settings")) {
             if (ImGui::Button("Clear History"))
                 state_.clear_history();
             ImGui::Checkbox("Update History", &state_.is_saving_);
+            ImGui::Text("Overlay: %.1f us", frame_cost_);
             ImGui::TreePop();
         }
 
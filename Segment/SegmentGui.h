@@ -1,5 +1,8 @@
 #pragma once
+#include <cstdint>
 #include <format>
+#include <string>
+#include <vector>
 #include <imgui.h>
 
 #include "PerLevelSegmentState.h"
@@ -7,10 +10,10 @@
 class SegmentGui {
 public:
     SegmentGui(PerLevelSegmentState &state, const int level)
-        : state_(state), current_level_name_(std::format("Level {}", level)) {}
+        : state_(state), current_level_name_(std::format("Level {}", level)) { init_rows(); }
 
     SegmentGui(PerLevelSegmentState &state, const std::string_view level_name)
-        : state_(state), current_level_name_(level_name) {}
+        : state_(state), current_level_name_(level_name) { init_rows(); }
 
     void update();
 
@@ -26,6 +29,31 @@ public:
     bool settings_visible_ = false;
     float font_scale_ = 0.7f;
 
+    // Text of a time, formatted again only when it changes at the precision shown
+    struct time_label {
+        int32_t ms = INT32_MAX;
+        char text[32] = "";
+
+        void set(int32_t time_ms, const char *format, const char *missing);
+    };
+
+    struct row_labels {
+        std::string sector;
+        std::string target_id; // Widget ID of the target figure
+        time_label current;
+        time_label delta;
+        time_label median;
+    };
+
+    std::vector<row_labels> rows_;
+    time_label sum_of_best_;
+    time_label best_possible_;
+    time_label predicted_;
+    float frame_cost_ = 0.0f; // Microseconds spent in update, averaged over recent frames
+
+    void init_rows();
+    void draw();
+
     const static inline std::string STYLES_SAVE_PATH = "../ModLoader/Configs/SegmentStyles.ini";
     const static inline ImU32 lead_color = ImGui::GetColorU32(ImVec4(0.2f, 0.8f, 0.2f, 0.75f));
     const static inline ImU32 even_color = ImGui::GetColorU32(ImVec4(1.f, 0.66f, 0.f, 0.75f));
@@ -0,0 +1,369 @@
+#include "SegmentJournal.h"
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+
+namespace {
+    // Maps have at most 9 sectors, anything much larger is corrupt
+    constexpr size_t MAX_SEGMENTS = 64;
+
+    // A field of a line: a target figure, completed times of a segment or the clearing of all of them
+    struct field_op {
+        char kind = 't';
+        size_t segment = 0;
+        float target = 0.0f;
+        std::vector<int32_t> times;
+    };
+
+    template<typename T>
+    bool parse_number(std::string_view text, T &value) {
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc() && ptr == text.data() + text.size();
+    }
+
+    bool parse_field(std::string_view field, field_op &op) {
+        if (field == "x") {
+            op.kind = 'x';
+            return true;
+        }
+
+        size_t space = field.find(' ');
+        if (space == std::string_view::npos)
+            return false;
+        if (field[0] != 'h') {
+            op.kind = 't';
+            return parse_number(field.substr(0, space), op.segment) &&
+                   parse_number(field.substr(space + 1), op.target);
+        }
+
+        // The first time is absolute, the following ones are deltas from the previous
+        op.kind = 'h';
+        if (!parse_number(field.substr(1, space - 1), op.segment))
+            return false;
+        int32_t time = 0;
+        while (space != std::string_view::npos) {
+            const size_t next = field.find(' ', space + 1);
+            int32_t value;
+            if (!parse_number(field.substr(space + 1, next - space - 1), value))
+                return false;
+            time = op.times.empty() ? value : time + value;
+            op.times.push_back(time);
+            space = next;
+        }
+        return true;
+    }
+
+    bool parse_line(std::string_view line, std::string_view &path, std::string_view &name, size_t &count,
+                    std::vector<field_op> &ops) {
+        std::vector<std::string_view> fields;
+        size_t begin = 0;
+        while (true) {
+            const size_t end = line.find('\t', begin);
+            fields.push_back(line.substr(begin, end - begin));
+            if (end == std::string_view::npos)
+                break;
+            begin = end + 1;
+        }
+        if (fields.size() < 3 || fields[0].empty())
+            return false;
+
+        path = fields[0];
+        name = fields[1];
+        if (!parse_number(fields[2], count) || count > MAX_SEGMENTS)
+            return false;
+
+        ops.resize(fields.size() - 3);
+        for (size_t i = 3; i < fields.size(); ++i) {
+            if (fields[i].empty() || !parse_field(fields[i], ops[i - 3]))
+                return false;
+        }
+        return true;
+    }
+
+    size_t number_size(int32_t value) {
+        char buffer[16];
+        return std::to_chars(buffer, buffer + sizeof(buffer), value).ptr - buffer;
+    }
+
+    // Bytes the times add to the history of a segment as append_history writes it
+    size_t history_size(const size_t segment, const std::vector<int32_t> &times,
+                        const std::vector<int32_t> &added) {
+        if (added.empty())
+            return 0;
+        size_t size = times.empty() ? std::format("\th{}", segment).size() : 0;
+        int32_t last = times.empty() ? 0 : times.back();
+        for (size_t i = 0; i < added.size(); ++i) {
+            size += 1 + number_size(times.empty() && i == 0 ? added[i] : added[i] - last);
+            last = added[i];
+        }
+        return size;
+    }
+
+    void append_history(std::string &line, const size_t segment, const std::vector<int32_t> &times) {
+        line += std::format("\th{}", segment);
+        int32_t last = 0;
+        for (size_t i = 0; i < times.size(); ++i) {
+            line += std::format(" {}", i == 0 ? times[i] : times[i] - last);
+            last = times[i];
+        }
+    }
+}
+
+bool SegmentJournal::exists() const {
+    std::error_code ec;
+    return std::filesystem::exists(dir_, ec);
+}
+
+bool SegmentJournal::create(const map_records &records) {
+    // Written aside and moved in place, so an interrupted first run starts over
+    const std::string temp_dir = dir_ + ".tmp";
+    std::error_code ec;
+    std::filesystem::remove_all(temp_dir, ec);
+    if (!std::filesystem::create_directories(temp_dir, ec))
+        return false;
+
+    std::unordered_map<std::string, std::string> files;
+    for (const auto &[path, record]: records)
+        files[shard_name(path)] += format_record(path, record);
+    for (const auto &[name, data]: files) {
+        std::ofstream fs(temp_dir + "/" + name, std::ios::binary | std::ios::trunc);
+        fs << data;
+        fs.close();
+        if (!fs)
+            return false;
+    }
+
+    std::filesystem::rename(temp_dir, dir_, ec);
+    return !ec;
+}
+
+bool SegmentJournal::load(const std::string &path, map_record &record) {
+    shard &target = get_shard(path);
+    std::lock_guard lock(target.mutex);
+    if (!target.read)
+        read(target);
+
+    const auto it = target.records.find(path);
+    if (it == target.records.end())
+        return false;
+    record = it->second;
+    return true;
+}
+
+void SegmentJournal::start() {
+    if (worker_.joinable())
+        return;
+    stop_ = false;
+    worker_ = std::thread(&SegmentJournal::run, this);
+}
+
+void SegmentJournal::stop() {
+    if (!worker_.joinable())
+        return;
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+}
+
+void SegmentJournal::record(const std::string &path, const std::string &name, const std::vector<float> &targets,
+                            std::vector<float> &saved, const std::vector<std::pair<int, int32_t>> &history) {
+    if (!worker_.joinable())
+        return;
+
+    // A map new to the journal is written even without figures
+    std::string line;
+    if (saved.size() != targets.size() || !history.empty())
+        line = std::format("{}\t{}\t{}", path, name, targets.size());
+    if (saved.size() != targets.size())
+        saved.assign(targets.size(), -1.0f);
+
+    for (const auto &[segment, time]: history) {
+        if (segment < 0)
+            line += "\tx";
+        else
+            line += std::format("\th{} {}", segment, time);
+    }
+
+    for (size_t i = 0; i < targets.size(); ++i) {
+        if (targets[i] == saved[i])
+            continue;
+        if (line.empty())
+            line = std::format("{}\t{}\t{}", path, name, targets.size());
+        line += std::format("\t{} {}", i, targets[i]);
+        saved[i] = targets[i];
+    }
+    if (line.empty())
+        return;
+
+    line += '\n';
+    shard *target = &get_shard(path);
+    {
+        std::lock_guard lock(mutex_);
+        lines_.emplace_back(target, std::move(line));
+    }
+    wake_.notify_one();
+}
+
+std::string SegmentJournal::shard_name(const std::string &path) {
+    // FNV-1a, stable across builds unlike std::hash
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char c: path) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return std::format("{:016x}.journal", hash);
+}
+
+SegmentJournal::shard &SegmentJournal::get_shard(const std::string &path) {
+    std::string file = dir_ + "/" + shard_name(path);
+    std::lock_guard lock(mutex_);
+    auto &target = shards_[file];
+    if (!target) {
+        target = std::make_unique<shard>();
+        target->file = std::move(file);
+    }
+    return *target;
+}
+
+void SegmentJournal::run() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return stop_ || !lines_.empty(); });
+        if (lines_.empty())
+            break;
+
+        std::deque<std::pair<shard *, std::string>> lines;
+        lines.swap(lines_);
+        lock.unlock();
+
+        for (const auto &[target, line]: lines) {
+            std::lock_guard shard_lock(target->mutex);
+            // Its figures are needed to know when to compact it
+            if (!target->read)
+                read(*target);
+
+            std::ofstream fs(target->file, std::ios::binary | std::ios::app);
+            fs << line;
+            fs.close();
+            target->file_size += line.size();
+            apply(*target, std::string_view(line).substr(0, line.size() - 1));
+
+            if (target->file_size > COMPACT_MIN_SIZE && target->file_size > 2 * target->live_size)
+                compact(*target);
+        }
+
+        lock.lock();
+    }
+}
+
+void SegmentJournal::read(shard &target) {
+    target.read = true;
+    // Lines appended after a torn one would be lost in it
+    if (!replay(target))
+        compact(target);
+}
+
+bool SegmentJournal::replay(shard &target) {
+    std::ifstream fs(target.file, std::ios::binary);
+    if (!fs)
+        return true;
+    std::stringstream ss;
+    ss << fs.rdbuf();
+    const std::string data = ss.str();
+    fs.close();
+
+    size_t begin = 0;
+    while (true) {
+        const size_t end = data.find('\n', begin);
+        // Without its newline the line may be cut short
+        if (end == std::string::npos)
+            break;
+        apply(target, std::string_view(data).substr(begin, end - begin));
+        begin = end + 1;
+    }
+    target.file_size = data.size();
+    return begin == data.size();
+}
+
+void SegmentJournal::apply(shard &target, std::string_view line) {
+    std::string_view path, name;
+    size_t count;
+    std::vector<field_op> ops;
+    if (!parse_line(line, path, name, count, ops))
+        return;
+
+    const std::string key(path);
+    auto &record = target.records[key];
+    auto &size = target.record_sizes[key];
+    if (size.header == 0 || record.name != name || record.targets.size() != count)
+        size.header = std::format("{}\t{}\t{}\n", key, name, count).size();
+    record.name = name;
+    record.targets.resize(count, -1.0f);
+    record.history.resize(count);
+    size.targets.resize(count);
+    size.history.resize(count);
+    for (const auto &op: ops) {
+        if (op.kind == 'x') {
+            for (auto &times: record.history)
+                times.clear();
+            std::fill(size.history.begin(), size.history.end(), 0);
+        } else if (op.segment < count) {
+            auto &times = record.history[op.segment];
+            if (op.kind == 't') {
+                record.targets[op.segment] = op.target;
+                size.targets[op.segment] =
+                    op.target >= 0.0f ? std::format("\t{} {}", op.segment, op.target).size() : 0;
+            } else {
+                size.history[op.segment] += history_size(op.segment, times, op.times);
+                times.insert(times.end(), op.times.begin(), op.times.end());
+            }
+        }
+    }
+
+    // Proportional to the segments of the map, not to its history
+    target.live_size -= size.total;
+    size.total = size.header;
+    for (size_t i = 0; i < count; ++i)
+        size.total += size.targets[i] + size.history[i];
+    target.live_size += size.total;
+}
+
+void SegmentJournal::compact(shard &target) {
+    const std::string temp_path = target.file + ".tmp";
+    std::ofstream fs(temp_path, std::ios::binary | std::ios::trunc);
+    size_t size = 0;
+    for (const auto &[path, record]: target.records) {
+        const std::string line = format_record(path, record);
+        fs << line;
+        size += line.size();
+    }
+    fs.close();
+    if (!fs)
+        return;
+
+    std::error_code ec;
+    std::filesystem::rename(temp_path, target.file, ec);
+    if (!ec)
+        target.file_size = size;
+}
+
+std::string SegmentJournal::format_record(const std::string &path, const map_record &record) {
+    std::string line = std::format("{}\t{}\t{}", path, record.name, record.targets.size());
+    for (size_t i = 0; i < record.targets.size(); ++i) {
+        if (record.targets[i] >= 0.0f)
+            line += std::format("\t{} {}", i, record.targets[i]);
+    }
+    for (size_t i = 0; i < record.history.size(); ++i) {
+        if (!record.history[i].empty())
+            append_history(line, i, record.history[i]);
+    }
+    line += '\n';
+    return line;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Append-only record of the target figures of every map, sharded by a hash of the map path so only
+// the shard of the map being played is ever read. Each save appends one line holding only the figures
+// of a map that changed since its last save, so the cost of a save does not depend on how many maps
+// were played. Lines are written by a worker thread, which also rewrites a shard with a single line
+// per map once it has grown to more than twice that size.
+//
+// Line: <map path>\t<level name>\t<segment count> followed by fields, each one of
+//   x                          clears the completed times of every segment
+//   h<segment> <ms> [<ms>]...  completed times, integer milliseconds, each after the first a delta
+//   <segment> <target>         target figure
+// Loading replays the lines in order, a torn last line is ignored. Maps whose paths share a hash share
+// a shard, told apart by the path each line starts with.
+class SegmentJournal {
+public:
+    struct map_record {
+        std::string name;
+        std::vector<float> targets;
+        std::vector<std::vector<int32_t>> history; // Completed times of each segment in order
+    };
+    using map_records = std::unordered_map<std::string, map_record>;
+
+    explicit SegmentJournal(std::string dir) : dir_(std::move(dir)) {}
+    SegmentJournal(const SegmentJournal &) = delete;
+    SegmentJournal &operator=(const SegmentJournal &) = delete;
+    ~SegmentJournal() { stop(); }
+
+    bool exists() const;
+
+    // Writes the shards of the records at once, to be called before start when none exist
+    bool create(const map_records &records);
+
+    // Reads the record of the map from its shard, false if the map has none
+    bool load(const std::string &path, map_record &record);
+
+    // Starts the worker writing to the shards, which create has to have written first
+    void start();
+
+    // Writes the queued lines and stops the worker
+    void stop();
+
+    // Queues the figures of the map that differ from the saved ones, which are updated, and the
+    // completed times added since the last call, segment -1 clearing them. Nothing is queued unless
+    // the worker runs.
+    void record(const std::string &path, const std::string &name, const std::vector<float> &targets,
+                std::vector<float> &saved, const std::vector<std::pair<int, int32_t>> &history);
+
+private:
+    static constexpr size_t COMPACT_MIN_SIZE = 64 * 1024;
+
+    // Size of the line a map takes in a compacted shard, kept by field so a line of the journal only
+    // updates the fields it changes
+    struct record_size {
+        size_t header = 0;
+        std::vector<size_t> targets;
+        std::vector<size_t> history;
+        size_t total = 0;
+    };
+
+    // The figures a shard holds and its size against that of a compacted one. Read on the first load of
+    // one of its maps, then updated by the worker with every line it writes, under its mutex.
+    struct shard {
+        std::string file;
+        std::mutex mutex;
+        bool read = false;
+        map_records records;
+        std::unordered_map<std::string, record_size> record_sizes;
+        size_t file_size = 0;
+        size_t live_size = 0;
+    };
+
+    static std::string shard_name(const std::string &path);
+    shard &get_shard(const std::string &path);
+    void run();
+    static void read(shard &target);
+    static bool replay(shard &target); // False if its last line is torn
+    static void apply(shard &target, std::string_view line);
+    static void compact(shard &target);
+    static std::string format_record(const std::string &path, const map_record &record);
+
+    const std::string dir_;
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::deque<std::pair<shard *, std::string>> lines_;
+    std::unordered_map<std::string, std::unique_ptr<shard>> shards_;
+};
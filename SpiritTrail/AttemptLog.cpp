@@ -0,0 +1,332 @@
+#include "AttemptLog.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+    constexpr uint32_t INDEX_MAGIC = 0x474C5441; // "ATLG"
+    constexpr uint32_t INDEX_VERSION = 1;
+    constexpr int64_t INDEX_HEADER_SIZE = 8;
+
+    // Dead ghosts are only worth copying the data file for past this size
+    constexpr int64_t COMPACT_MIN_SIZE = 1 << 20;
+
+    // The data file may outgrow the 2 GB a long reaches on Windows
+    int64_t GetFileSize(FILE *fp) {
+        _fseeki64(fp, 0, SEEK_END);
+        return _ftelli64(fp);
+    }
+
+    bool FileExists(const std::string &path) {
+        FILE *fp = fopen(path.c_str(), "rb");
+        if (!fp)
+            return false;
+        fclose(fp);
+        return true;
+    }
+}
+
+bool AttemptLog::Open(const std::string &dir) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_DataPath = dir + "attempts.dat";
+    m_IndexPath = dir + "attempts.idx";
+    m_Attempts.clear();
+    m_Sectors.clear();
+    m_DataSize = 0;
+    m_DeadSize = 0;
+
+    // Compaction moves the new data file in before the new index. A data file still waiting means the
+    // old pair is whole, an index alone that it was cut short after the data file.
+    std::string dataTemp = m_DataPath + ".tmp", indexTemp = m_IndexPath + ".tmp";
+    if (FileExists(dataTemp)) {
+        remove(dataTemp.c_str());
+        remove(indexTemp.c_str());
+    } else if (FileExists(indexTemp) && !ReplaceFileAtomic(indexTemp.c_str(), m_IndexPath.c_str())) {
+        m_IndexPath.clear();
+        return false;
+    }
+
+    FILE *fp = fopen(m_DataPath.c_str(), "rb");
+    if (fp) {
+        m_DataSize = GetFileSize(fp);
+        fclose(fp);
+    }
+
+    bool truncated = false;
+    fp = fopen(m_IndexPath.c_str(), "rb");
+    if (fp) {
+        uint32_t header[2] = {0, 0};
+        if (fread(header, sizeof(header), 1, fp) != 1 || header[0] != INDEX_MAGIC || header[1] != INDEX_VERSION) {
+            // Leave files we do not understand alone
+            fclose(fp);
+            m_IndexPath.clear();
+            return false;
+        }
+
+        Entry entry;
+        while (fread(&entry, sizeof(entry), 1, fp) == 1) {
+            if (entry.sector < 0) {
+                if (entry.offset < m_Attempts.size())
+                    Remove((uint32_t) entry.offset);
+                continue;
+            }
+
+            Attempt attempt;
+            attempt.id = (uint32_t) m_Attempts.size();
+            attempt.sector = entry.sector;
+            attempt.hsscore = entry.hsscore;
+            attempt.srscore = entry.srscore;
+            attempt.date = entry.date;
+            attempt.offset = (int64_t) entry.offset;
+            attempt.size = (int64_t) entry.size;
+
+            // The ghost is written before its entry, a missing one means the data file was damaged
+            if (attempt.offset + attempt.size > m_DataSize)
+                attempt.size = 0;
+            m_Attempts.push_back(attempt);
+            if (attempt.size > 0)
+                Insert(attempt);
+        }
+
+        int64_t expected = INDEX_HEADER_SIZE + (_ftelli64(fp) - INDEX_HEADER_SIZE) / (int64_t) sizeof(Entry) * (int64_t) sizeof(Entry);
+        truncated = GetFileSize(fp) != expected;
+        fclose(fp);
+    }
+
+    // A torn entry at the end of the index would misalign the following ones. Only ghosts of removed
+    // attempts count as dead, those of a lost index are kept.
+    if (truncated || (m_DataSize > COMPACT_MIN_SIZE && m_DeadSize > m_DataSize / 2))
+        Compact();
+    return true;
+}
+
+bool AttemptLog::Append(int sector, const GhostRecord &record, const std::vector<char> &data, int64_t date) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_IndexPath.empty())
+        return false;
+
+    FILE *fp = fopen(m_DataPath.c_str(), "ab");
+    if (!fp)
+        return false;
+    int64_t offset = GetFileSize(fp);
+    bool written = fwrite(data.data(), data.size(), 1, fp) == 1;
+    fclose(fp);
+    if (!written)
+        return false;
+
+    Entry entry = {sector, record.hsscore, record.srscore, (uint32_t) data.size(), date, (uint64_t) offset};
+    if (!WriteEntry(entry))
+        return false;
+
+    Attempt attempt;
+    attempt.id = (uint32_t) m_Attempts.size();
+    attempt.sector = sector;
+    attempt.hsscore = record.hsscore;
+    attempt.srscore = record.srscore;
+    attempt.date = date;
+    attempt.offset = offset;
+    attempt.size = (int64_t) data.size();
+    m_Attempts.push_back(attempt);
+    Insert(attempt);
+    m_DataSize = offset + attempt.size;
+    return true;
+}
+
+size_t AttemptLog::Prune(int sector, size_t maxAttempts, size_t keepBest) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Sectors.find(sector);
+    if (it == m_Sectors.end())
+        return 0;
+
+    size_t removed = 0;
+    Sector &list = it->second;
+    while (list.byDate.size() > maxAttempts) {
+        size_t best = (std::min)(keepBest, list.byDate.size());
+        auto isKept = [&](uint32_t id) {
+            return std::find(list.byTime.begin(), list.byTime.begin() + best, id) != list.byTime.begin() + best ||
+                   std::find(list.byScore.begin(), list.byScore.begin() + best, id) != list.byScore.begin() + best;
+        };
+
+        auto victim = std::find_if_not(list.byDate.begin(), list.byDate.end(), isKept);
+        if (victim == list.byDate.end())
+            break;
+
+        uint32_t id = *victim;
+        Entry tombstone = {-1, 0, 0.0f, 0, 0, id};
+        if (!WriteEntry(tombstone))
+            break;
+        Remove(id);
+        ++removed;
+    }
+    return removed;
+}
+
+std::vector<Attempt> AttemptLog::Query(int sector, Order order, size_t count) const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::vector<Attempt> attempts;
+    auto it = m_Sectors.find(sector);
+    if (it == m_Sectors.end())
+        return attempts;
+
+    const Sector &list = it->second;
+    switch (order) {
+        case BY_TIME:
+            for (size_t i = 0; i < list.byTime.size() && i < count; i++)
+                attempts.push_back(m_Attempts[list.byTime[i]]);
+            break;
+        case BY_SCORE:
+            for (size_t i = 0; i < list.byScore.size() && i < count; i++)
+                attempts.push_back(m_Attempts[list.byScore[i]]);
+            break;
+        case BY_DATE:
+            for (auto id = list.byDate.rbegin(); id != list.byDate.rend() && attempts.size() < count; ++id)
+                attempts.push_back(m_Attempts[*id]);
+            break;
+    }
+    return attempts;
+}
+
+bool AttemptLog::GetMedian(int sector, Attempt &attempt) const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Sectors.find(sector);
+    if (it == m_Sectors.end() || it->second.byTime.empty())
+        return false;
+
+    const auto &byTime = it->second.byTime;
+    attempt = m_Attempts[byTime[(byTime.size() - 1) / 2]];
+    return true;
+}
+
+bool AttemptLog::Find(uint32_t id, Attempt &attempt) const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (id >= m_Attempts.size() || m_Attempts[id].size == 0)
+        return false;
+    attempt = m_Attempts[id];
+    return true;
+}
+
+size_t AttemptLog::GetCount(int sector) const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Sectors.find(sector);
+    return it == m_Sectors.end() ? 0 : it->second.byDate.size();
+}
+
+GhostSource AttemptLog::GetSource(const Attempt &attempt) const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    GhostSource source;
+    source.path = m_DataPath;
+    source.offset = attempt.offset;
+    source.size = attempt.size;
+    return source;
+}
+
+void AttemptLog::Insert(const Attempt &attempt) {
+    Sector &list = m_Sectors[attempt.sector];
+    auto byTime = [this](uint32_t a, uint32_t b) {
+        return m_Attempts[a].srscore < m_Attempts[b].srscore || (m_Attempts[a].srscore == m_Attempts[b].srscore && a < b);
+    };
+    auto byScore = [this](uint32_t a, uint32_t b) {
+        return m_Attempts[a].hsscore > m_Attempts[b].hsscore || (m_Attempts[a].hsscore == m_Attempts[b].hsscore && a < b);
+    };
+    auto byDate = [this](uint32_t a, uint32_t b) {
+        return m_Attempts[a].date < m_Attempts[b].date || (m_Attempts[a].date == m_Attempts[b].date && a < b);
+    };
+
+    uint32_t id = attempt.id;
+    list.byTime.insert(std::upper_bound(list.byTime.begin(), list.byTime.end(), id, byTime), id);
+    list.byScore.insert(std::upper_bound(list.byScore.begin(), list.byScore.end(), id, byScore), id);
+    list.byDate.insert(std::upper_bound(list.byDate.begin(), list.byDate.end(), id, byDate), id);
+}
+
+void AttemptLog::Remove(uint32_t id) {
+    Attempt &attempt = m_Attempts[id];
+    if (attempt.size == 0)
+        return;
+
+    auto it = m_Sectors.find(attempt.sector);
+    if (it != m_Sectors.end()) {
+        for (auto *ids : {&it->second.byTime, &it->second.byScore, &it->second.byDate})
+            ids->erase(std::remove(ids->begin(), ids->end(), id), ids->end());
+    }
+    m_DeadSize += attempt.size;
+    attempt.size = 0;
+}
+
+bool AttemptLog::WriteEntry(const Entry &entry) {
+    FILE *fp = fopen(m_IndexPath.c_str(), "ab");
+    if (!fp)
+        return false;
+
+    bool res = true;
+    if (GetFileSize(fp) == 0) {
+        uint32_t header[2] = {INDEX_MAGIC, INDEX_VERSION};
+        res = fwrite(header, sizeof(header), 1, fp) == 1;
+    }
+    res = res && fwrite(&entry, sizeof(entry), 1, fp) == 1;
+    fclose(fp);
+    return res;
+}
+
+bool AttemptLog::Compact() {
+    std::string dataTemp = m_DataPath + ".tmp", indexTemp = m_IndexPath + ".tmp";
+    FILE *src = fopen(m_DataPath.c_str(), "rb");
+    FILE *data = fopen(dataTemp.c_str(), "wb");
+    FILE *index = data ? fopen(indexTemp.c_str(), "wb") : nullptr; // Never an index temp alone
+
+    std::vector<Attempt> attempts;
+    bool res = data && index;
+    if (res) {
+        uint32_t header[2] = {INDEX_MAGIC, INDEX_VERSION};
+        res = fwrite(header, sizeof(header), 1, index) == 1;
+    }
+
+    std::vector<char> buffer;
+    int64_t offset = 0;
+    for (const auto &attempt : m_Attempts) {
+        if (!res)
+            break;
+        if (attempt.size == 0)
+            continue;
+
+        buffer.resize(attempt.size);
+        res = src && _fseeki64(src, attempt.offset, SEEK_SET) == 0 &&
+              fread(buffer.data(), buffer.size(), 1, src) == 1 &&
+              fwrite(buffer.data(), buffer.size(), 1, data) == 1;
+
+        Attempt &moved = attempts.emplace_back(attempt);
+        moved.id = (uint32_t) (attempts.size() - 1);
+        moved.offset = offset;
+        offset += moved.size;
+
+        Entry entry = {moved.sector, moved.hsscore, moved.srscore, (uint32_t) moved.size, moved.date, (uint64_t) moved.offset};
+        res = res && fwrite(&entry, sizeof(entry), 1, index) == 1;
+    }
+
+    if (src) fclose(src);
+    if (data) res = fflush(data) == 0 && fclose(data) == 0 && res;
+    if (index) res = fflush(index) == 0 && fclose(index) == 0 && res;
+
+    // The index goes last, until it is in the old index still matches the old data file
+    if (!res || !ReplaceFileAtomic(dataTemp.c_str(), m_DataPath.c_str())) {
+        remove(dataTemp.c_str());
+        remove(indexTemp.c_str());
+        return false;
+    }
+
+    bool indexed = ReplaceFileAtomic(indexTemp.c_str(), m_IndexPath.c_str());
+
+    m_Attempts.clear();
+    m_Sectors.clear();
+    m_DeadSize = 0;
+    for (const auto &attempt : attempts) {
+        m_Attempts.push_back(attempt);
+        Insert(attempt);
+    }
+    m_DataSize = offset;
+
+    // The old index no longer matches, entries appended to it would be lost when the next Open moves
+    // the new one in
+    if (!indexed)
+        m_IndexPath.clear();
+    return indexed;
+}
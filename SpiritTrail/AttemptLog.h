@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "GhostFile.h"
+
+// A completed sector attempt.
+struct Attempt {
+    uint32_t id = 0; // Stable until the log is compacted
+    int sector = 0;
+    int hsscore = 0;
+    float srscore = 0;
+    int64_t date = 0; // Seconds since the epoch
+    int64_t offset = 0; // Ghost file in the data file
+    int64_t size = 0;
+};
+
+// Append-only log of every completed sector attempt of a map.
+//
+// attempts.dat holds the ghost files of the attempts one after another and attempts.idx a fixed size
+// entry for each of them, so opening the log only reads the index. Attempts are removed by appending
+// a tombstone entry; their ghosts stay in the data file until the log is compacted, which happens when
+// it is opened and most of the data file is held by removed attempts. Without an index nothing is known
+// to be dead, so the data file is left alone. Compaction moves the new data file in before the new
+// index, and opening the log finishes a compaction cut short between the two. All methods may be
+// called from any thread.
+class AttemptLog {
+public:
+    enum Order {
+        BY_TIME,  // Best SR first
+        BY_SCORE, // Best HS first
+        BY_DATE,  // Most recent first
+    };
+
+    bool Open(const std::string &dir);
+
+    // Data is the ghost file of the record
+    bool Append(int sector, const GhostRecord &record, const std::vector<char> &data, int64_t date);
+
+    // Removes the oldest attempts of a sector beyond maxAttempts, sparing the keepBest best ones by
+    // time and by score. Returns the number of removed attempts.
+    size_t Prune(int sector, size_t maxAttempts, size_t keepBest);
+
+    std::vector<Attempt> Query(int sector, Order order, size_t count) const;
+    bool GetMedian(int sector, Attempt &attempt) const; // By time
+    bool Find(uint32_t id, Attempt &attempt) const;
+    size_t GetCount(int sector) const;
+
+    GhostSource GetSource(const Attempt &attempt) const;
+
+private:
+    // On-disk index entry, a tombstone has a negative sector and the removed id as offset
+    struct Entry {
+        int32_t sector;
+        int32_t hsscore;
+        float srscore;
+        uint32_t size;
+        int64_t date;
+        uint64_t offset;
+    };
+    static_assert(sizeof(Entry) == 32);
+
+    // Attempt ids of a sector in each order
+    struct Sector {
+        std::vector<uint32_t> byTime;
+        std::vector<uint32_t> byScore;
+        std::vector<uint32_t> byDate;
+    };
+
+    void Insert(const Attempt &attempt);
+    void Remove(uint32_t id);
+    bool WriteEntry(const Entry &entry);
+    bool Compact();
+
+    std::string m_DataPath;
+    std::string m_IndexPath;
+    std::vector<Attempt> m_Attempts; // By id, removed attempts have no size
+    std::map<int, Sector> m_Sectors;
+    int64_t m_DataSize = 0;
+    int64_t m_DeadSize = 0; // Ghosts of removed attempts
+    mutable std::mutex m_Mutex;
+};
@@ -0,0 +1,66 @@
+#include "GhostCommand.h"
+#include "SpiritTrail.h"
+
+#include <time.h>
+
+void GhostCommand::Execute(IBML *bml, const std::vector<std::string> &args) {
+    AttemptLog *history = m_Mod->GetHistory();
+    if (!history) {
+        bml->SendIngameMessage("No map has been loaded");
+        return;
+    }
+
+    if (args.size() >= 2 && args[1] == "list") {
+        AttemptLog::Order order = AttemptLog::BY_TIME;
+        if (args.size() >= 3 && args[2] == "score")
+            order = AttemptLog::BY_SCORE;
+        else if (args.size() >= 3 && args[2] == "date")
+            order = AttemptLog::BY_DATE;
+        int sector = args.size() >= 4 ? ParseInteger(args[3], 1) : m_Mod->GetSector();
+
+        auto attempts = history->Query(sector, order, 10);
+        bml->SendIngameMessage(("Sector " + std::to_string(sector) + ": " +
+                                std::to_string(history->GetCount(sector)) + " attempts").c_str());
+        for (const auto &attempt : attempts) {
+            char date[32];
+            time_t seconds = (time_t) attempt.date;
+            strftime(date, sizeof(date), "%Y-%m-%d %H:%M", localtime(&seconds));
+
+            int ms = (int) attempt.srscore;
+            char line[128];
+            snprintf(line, sizeof(line), "#%u  %d:%02d.%03d  %d pts  %s", attempt.id, ms / 60000, ms / 1000 % 60,
+                     ms % 1000, attempt.hsscore, date);
+            bml->SendIngameMessage(line);
+        }
+        return;
+    }
+
+    if (args.size() >= 3 && args[1] == "pin") {
+        Attempt attempt;
+        uint32_t id = (uint32_t) ParseInteger(args[2], 0);
+        if (!history->Find(id, attempt)) {
+            bml->SendIngameMessage(("No attempt #" + args[2]).c_str());
+            return;
+        }
+        m_Mod->PinAttempt(id);
+        bml->SendIngameMessage(("Attempt #" + args[2] + " will be played in sector " + std::to_string(attempt.sector)).c_str());
+        return;
+    }
+
+    if (args.size() >= 2 && args[1] == "unpin") {
+        m_Mod->UnpinAttempt();
+        return;
+    }
+
+    bml->SendIngameMessage("Usage: ghosts list [time|score|date] [sector]");
+    bml->SendIngameMessage("       ghosts pin <id>");
+    bml->SendIngameMessage("       ghosts unpin");
+}
+
+const std::vector<std::string> GhostCommand::GetTabCompletion(IBML *bml, const std::vector<std::string> &args) {
+    if (args.size() == 2)
+        return {"list", "pin", "unpin"};
+    if (args.size() == 3 && args[1] == "list")
+        return {"time", "score", "date"};
+    return {};
+}
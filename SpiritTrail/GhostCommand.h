@@ -0,0 +1,20 @@
+#pragma once
+
+#include "BML/BMLAll.h"
+
+class SpiritTrail;
+
+class GhostCommand : public ICommand {
+public:
+    explicit GhostCommand(SpiritTrail *mod) : m_Mod(mod) {}
+
+    std::string GetName() override { return "ghosts"; }
+    std::string GetAlias() override { return ""; }
+    std::string GetDescription() override { return "Browse past attempts and choose one to play as a ghost."; }
+    bool IsCheat() override { return false; }
+    void Execute(IBML *bml, const std::vector<std::string> &args) override;
+    const std::vector<std::string> GetTabCompletion(IBML *bml, const std::vector<std::string> &args) override;
+
+private:
+    SpiritTrail *m_Mod;
+};
@@ -0,0 +1,144 @@
+#include "GhostPath.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "GhostTrack.h"
+
+namespace {
+    // Samples in a segment between two keyframes, bounds the size of the path of a teleported ball
+    constexpr int MAX_SAMPLES = 64;
+
+    // Distance in units a millisecond away from the previous projection weighs
+    constexpr float TIME_WEIGHT = 1.0f / 5000.0f;
+
+    constexpr int CELL_BITS = 21;
+    constexpr int CELL_BIAS = 1 << (CELL_BITS - 1);
+}
+
+void GhostPath::Build(const GhostRecord &record) {
+    Clear();
+
+    const auto &states = record.states;
+    for (size_t i = 0; i + 1 < states.size(); i++) {
+        const auto &a = states[i], &b = states[i + 1];
+        float length = Magnitude(b.pos - a.pos);
+        int samples = std::clamp((int) std::ceil(length / STEP), 1, MAX_SAMPLES);
+        for (int k = 0; k < samples; k++)
+            AddVertex(InterpolateState(a, b, a.time + (b.time - a.time) * k / samples));
+    }
+    if (!states.empty())
+        AddVertex(states.back());
+    if (IsEmpty())
+        return;
+
+    // Register each segment in every cell its bounding box touches
+    std::vector<std::pair<uint64_t, uint32_t>> entries;
+    entries.reserve(m_Time.size() * 2);
+    for (uint32_t s = 0; s + 1 < m_Time.size(); s++) {
+        int lo[3], hi[3];
+        for (int i = 0; i < 3; i++) {
+            lo[i] = GetCell((std::min)(m_Pos[i][s], m_Pos[i][s + 1]));
+            hi[i] = GetCell((std::max)(m_Pos[i][s], m_Pos[i][s + 1]));
+        }
+        for (int x = lo[0]; x <= hi[0]; x++)
+            for (int y = lo[1]; y <= hi[1]; y++)
+                for (int z = lo[2]; z <= hi[2]; z++)
+                    entries.emplace_back(GetCellKey(x, y, z), s);
+    }
+    std::sort(entries.begin(), entries.end());
+
+    m_Segments.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (i == 0 || entries[i].first != entries[i - 1].first) {
+            m_CellKeys.push_back(entries[i].first);
+            m_CellStart.push_back((uint32_t) m_Segments.size());
+        }
+        m_Segments.push_back(entries[i].second);
+    }
+    m_CellStart.push_back((uint32_t) m_Segments.size());
+}
+
+void GhostPath::Clear() {
+    for (auto &pos : m_Pos)
+        pos.clear();
+    m_Time.clear();
+    m_CellKeys.clear();
+    m_CellStart.clear();
+    m_Segments.clear();
+    m_LastTime = 0.0f;
+}
+
+bool GhostPath::Project(const VxVector &pos, float &time) {
+    if (IsEmpty())
+        return false;
+
+    const float p[3] = {pos.x, pos.y, pos.z};
+    const int cx = GetCell(p[0]), cy = GetCell(p[1]), cz = GetCell(p[2]);
+
+    bool found = false;
+    float bestScore = 0.0f, bestTime = 0.0f;
+    for (int x = cx - 1; x <= cx + 1; x++) {
+        for (int y = cy - 1; y <= cy + 1; y++) {
+            for (int z = cz - 1; z <= cz + 1; z++) {
+                uint64_t key = GetCellKey(x, y, z);
+                auto cell = std::lower_bound(m_CellKeys.begin(), m_CellKeys.end(), key);
+                if (cell == m_CellKeys.end() || *cell != key)
+                    continue;
+
+                size_t c = cell - m_CellKeys.begin();
+                for (uint32_t i = m_CellStart[c]; i < m_CellStart[c + 1]; i++) {
+                    uint32_t s = m_Segments[i];
+                    float d[3], r[3], dd = 0.0f, rd = 0.0f;
+                    for (int k = 0; k < 3; k++) {
+                        d[k] = m_Pos[k][s + 1] - m_Pos[k][s];
+                        r[k] = p[k] - m_Pos[k][s];
+                        dd += d[k] * d[k];
+                        rd += r[k] * d[k];
+                    }
+
+                    float u = dd > 0.0f ? std::clamp(rd / dd, 0.0f, 1.0f) : 0.0f;
+                    float dist2 = 0.0f;
+                    for (int k = 0; k < 3; k++) {
+                        float e = r[k] - d[k] * u;
+                        dist2 += e * e;
+                    }
+                    if (dist2 > MAX_DISTANCE * MAX_DISTANCE)
+                        continue;
+
+                    float t = m_Time[s] + (m_Time[s + 1] - m_Time[s]) * u;
+                    float score = std::sqrt(dist2) + std::fabs(t - m_LastTime) * TIME_WEIGHT;
+                    if (!found || score < bestScore) {
+                        found = true;
+                        bestScore = score;
+                        bestTime = t;
+                    }
+                }
+            }
+        }
+    }
+
+    if (found) {
+        m_LastTime = bestTime;
+        time = bestTime;
+    }
+    return found;
+}
+
+uint64_t GhostPath::GetCellKey(int x, int y, int z) {
+    constexpr uint64_t mask = (1ull << CELL_BITS) - 1;
+    return ((uint64_t) (x + CELL_BIAS) & mask) << (2 * CELL_BITS) |
+           ((uint64_t) (y + CELL_BIAS) & mask) << CELL_BITS |
+           ((uint64_t) (z + CELL_BIAS) & mask);
+}
+
+int GhostPath::GetCell(float coord) {
+    return (int) std::floor(coord / CELL_SIZE);
+}
+
+void GhostPath::AddVertex(const GhostRecord::State &state) {
+    m_Pos[0].push_back(state.pos.x);
+    m_Pos[1].push_back(state.pos.y);
+    m_Pos[2].push_back(state.pos.z);
+    m_Time.push_back(state.time);
+}
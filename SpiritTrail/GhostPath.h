@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "GhostCodec.h"
+
+// The path of a ghost as a polyline, indexed by a uniform grid so the point of the path closest to a
+// position can be found without walking it.
+//
+// The Hermite curve between keyframes is sampled every STEP units, which keeps segments far shorter
+// than a cell. The grid is stored sparse: the keys of the occupied cells are sorted, each with the
+// range of its segments, so a query is a binary search for each of the 27 cells around the position.
+class GhostPath {
+public:
+    static constexpr float STEP = 0.5f;
+    static constexpr float CELL_SIZE = 4.0f;
+
+    // Positions further than this from the path are not projected on it
+    static constexpr float MAX_DISTANCE = CELL_SIZE;
+
+    void Build(const GhostRecord &record);
+    void Clear();
+
+    [[nodiscard]] bool IsEmpty() const { return m_Time.size() < 2; }
+
+    // Projects the position on the closest point of the path and gives the time the ghost passed
+    // there. Where the path crosses itself, the point closest in time to the previous projection wins.
+    bool Project(const VxVector &pos, float &time);
+
+private:
+    static uint64_t GetCellKey(int x, int y, int z);
+    static int GetCell(float coord);
+
+    void AddVertex(const GhostRecord::State &state);
+
+    // Vertices of the polyline, segment i goes from vertex i to vertex i + 1
+    std::vector<float> m_Pos[3];
+    std::vector<float> m_Time;
+
+    // Occupied cells sorted by key, the segments of cell i are m_Segments[m_CellStart[i], m_CellStart[i + 1])
+    std::vector<uint64_t> m_CellKeys;
+    std::vector<uint32_t> m_CellStart;
+    std::vector<uint32_t> m_Segments;
+
+    float m_LastTime = 0.0f;
+};
@@ -0,0 +1,84 @@
+#include "GhostRoute.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "GhostTrack.h"
+
+namespace {
+    // Steps the curve is walked in, well below the spacing of the vertices
+    constexpr float WALK_STEP = 0.25f;
+    constexpr int MAX_STEPS = 256;
+}
+
+void GhostRoute::Build(const GhostRecord &record) {
+    Clear();
+
+    const auto &states = record.states;
+    if (states.empty())
+        return;
+
+    AddVertex(states.front());
+    for (size_t i = 0; i + 1 < states.size(); i++) {
+        const auto &a = states[i], &b = states[i + 1];
+        int steps = std::clamp((int) std::ceil(Magnitude(b.pos - a.pos) / WALK_STEP), 1, MAX_STEPS);
+        for (int k = 1; k <= steps; k++) {
+            GhostRecord::State state = k == steps ? b : InterpolateState(a, b, a.time + (b.time - a.time) * k / steps);
+            if (SquareMagnitude(state.pos - m_Positions.back()) >= SPACING * SPACING)
+                AddVertex(state);
+        }
+    }
+
+    // The end of the route is always drawn
+    if (m_Times.back() < states.back().time)
+        AddVertex(states.back());
+
+    float maxSpeed = *std::max_element(m_Speeds.begin(), m_Speeds.end());
+    m_Colors.reserve(m_Speeds.size());
+    for (float speed : m_Speeds) {
+        float u = maxSpeed > 0.0f ? speed / maxSpeed : 0.0f;
+        m_Colors.push_back(RGBAFTOCOLOR(u, 0.2f, 1.0f - u, 1.0f));
+    }
+    m_Speeds.clear();
+    m_Speeds.shrink_to_fit();
+}
+
+void GhostRoute::Clear() {
+    m_Positions.clear();
+    m_Speeds.clear();
+    m_Colors.clear();
+    m_Times.clear();
+}
+
+void GhostRoute::Draw(CKRenderContext *dev, float time, float ahead) const {
+    if (IsEmpty())
+        return;
+
+    size_t first = 0, last = m_Times.size();
+    if (ahead > 0.0f) {
+        // Start from the vertex before the time so the line reaches the ghost
+        first = std::upper_bound(m_Times.begin(), m_Times.end(), time) - m_Times.begin();
+        first = first > 0 ? first - 1 : 0;
+        last = std::upper_bound(m_Times.begin() + first, m_Times.end(), time + ahead) - m_Times.begin();
+    }
+    if (last - first < 2)
+        return;
+
+    VxDrawPrimitiveData data = {};
+    data.VertexCount = (int) (last - first);
+    data.Flags = CKRST_DP_TRANSFORM | CKRST_DP_DOCLIP | CKRST_DP_DIFFUSE;
+    data.PositionPtr = (void *) &m_Positions[first];
+    data.PositionStride = sizeof(VxVector);
+    data.ColorPtr = (void *) &m_Colors[first];
+    data.ColorStride = sizeof(CKDWORD);
+
+    dev->SetWorldTransformationMatrix(VxMatrix::Identity());
+    dev->SetTexture(nullptr);
+    dev->DrawPrimitive(VX_LINESTRIP, nullptr, 0, &data);
+}
+
+void GhostRoute::AddVertex(const GhostRecord::State &state) {
+    m_Positions.push_back(state.pos);
+    m_Speeds.push_back(Magnitude(state.vel));
+    m_Times.push_back(state.time);
+}
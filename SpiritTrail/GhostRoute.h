@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include <BML/BMLAll.h>
+
+#include "GhostCodec.h"
+
+// The route of a ghost drawn as a line strip colored by speed, from blue when slow to red at its
+// top speed.
+//
+// The vertices are built once when the record is loaded: the Hermite curve between keyframes is
+// walked in fine steps and a vertex is only kept once the ball has moved SPACING units from the last
+// one. Drawing hands the kept arrays to the rasterizer as they are, a part of the route is a range of
+// them found by a binary search on time, so a frame costs a single draw call whatever the length.
+class GhostRoute {
+public:
+    static constexpr float SPACING = 1.0f;
+
+    void Build(const GhostRecord &record);
+    void Clear();
+
+    [[nodiscard]] bool IsEmpty() const { return m_Positions.size() < 2; }
+
+    // Draws the route from time for ahead milliseconds, or the whole route when ahead is not positive
+    void Draw(CKRenderContext *dev, float time, float ahead) const;
+
+private:
+    void AddVertex(const GhostRecord::State &state);
+
+    std::vector<VxVector> m_Positions;
+    std::vector<float> m_Speeds; // Only while building
+    std::vector<CKDWORD> m_Colors;
+    std::vector<float> m_Times;
+};
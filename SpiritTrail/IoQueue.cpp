@@ -0,0 +1,74 @@
+#include "IoQueue.h"
+
+void IoQueue::Start() {
+    if (m_Worker.joinable())
+        return;
+
+    m_Stop = false;
+    m_Worker = std::thread(&IoQueue::Run, this);
+}
+
+void IoQueue::Stop() {
+    if (!m_Worker.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Wake.notify_one();
+    m_Worker.join();
+    m_Completions.clear();
+}
+
+uint64_t IoQueue::Push(Job job) {
+    uint64_t ticket;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Jobs.push_back(std::move(job));
+        ticket = ++m_Pushed;
+    }
+    m_Wake.notify_one();
+    return ticket;
+}
+
+void IoQueue::Poll() {
+    std::deque<Completion> completions;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Completions.empty())
+            return;
+        completions.swap(m_Completions);
+    }
+
+    for (auto &completion : completions)
+        completion();
+}
+
+void IoQueue::Wait(uint64_t ticket) {
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Done.wait(lock, [this, ticket]() { return m_Finished >= ticket || !m_Worker.joinable(); });
+    }
+    Poll();
+}
+
+void IoQueue::Run() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true) {
+        m_Wake.wait(lock, [this]() { return m_Stop || !m_Jobs.empty(); });
+        if (m_Jobs.empty())
+            break;
+
+        Job job = std::move(m_Jobs.front());
+        m_Jobs.pop_front();
+        lock.unlock();
+        Completion completion = job();
+        lock.lock();
+
+        if (completion)
+            m_Completions.push_back(std::move(completion));
+        m_Finished++;
+        m_Done.notify_all();
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs file jobs one after another on a single worker thread, in the order they were pushed, so a
+// file saved by a job is complete before a later job loads it. Each job may hand back a completion
+// that is run on the game thread by Poll or Wait.
+class IoQueue {
+public:
+    using Completion = std::function<void()>;
+    using Job = std::function<Completion()>;
+
+    IoQueue() = default;
+    IoQueue(const IoQueue &) = delete;
+    IoQueue &operator=(const IoQueue &) = delete;
+    ~IoQueue() { Stop(); }
+
+    void Start();
+
+    // Finishes the pushed jobs and stops the worker, completions left are dropped
+    void Stop();
+
+    // Returns a ticket to wait for the job
+    uint64_t Push(Job job);
+
+    // Runs the completions of finished jobs
+    void Poll();
+
+    // Blocks until the job of the ticket is done, then runs the finished completions
+    void Wait(uint64_t ticket);
+
+private:
+    void Run();
+
+    std::thread m_Worker;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::condition_variable m_Done;
+    bool m_Stop = false;
+
+    std::deque<Job> m_Jobs;
+    std::deque<Completion> m_Completions;
+    uint64_t m_Pushed = 0;
+    uint64_t m_Finished = 0;
+};
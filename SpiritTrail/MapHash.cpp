@@ -0,0 +1,135 @@
+#include "MapHash.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include <sys/stat.h>
+
+#include <BML/BMLAll.h>
+
+#include "GhostFile.h"
+
+namespace {
+    constexpr size_t BLOCK_SIZE = 64 * 1024;
+}
+
+std::string ComputeMapHash(const char *filename) {
+    if (!filename) return "";
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return "";
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    // Each quarter is CRCed block by block, chaining the CRC gives the same value as a single call
+    std::vector<char> buffer(BLOCK_SIZE);
+    std::string res;
+    long segm[] = {0, size / 4, size / 2, size * 3 / 4, size};
+    for (int i = 0; i < 4; i++) {
+        CKDWORD crc = 0;
+        long remaining = segm[i + 1] - segm[i];
+        do {
+            size_t block = (size_t) (std::min)(remaining, (long) BLOCK_SIZE);
+            if (fread(buffer.data(), 1, block, fp) != block) {
+                fclose(fp);
+                return "";
+            }
+            crc = CKComputeDataCRC(buffer.data(), (int) block, crc);
+            remaining -= (long) block;
+        } while (remaining > 0);
+
+        char hash[10];
+        sprintf(hash, "%08lx", crc);
+        res += hash;
+    }
+
+    fclose(fp);
+    return res;
+}
+
+bool MapHashCache::Load(const std::string &cachePath) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_CachePath = cachePath;
+    m_Entries.clear();
+
+    FILE *fp = fopen(m_CachePath.c_str(), "r");
+    if (!fp)
+        return true;
+
+    size_t lines = 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), fp)) {
+        char hash[40];
+        long long size, mtime;
+        int pathStart = 0;
+        if (sscanf(line, "%32s %lld %lld %n", hash, &size, &mtime, &pathStart) != 3 || pathStart == 0)
+            continue;
+
+        std::string path = line + pathStart;
+        while (!path.empty() && (path.back() == '\n' || path.back() == '\r'))
+            path.pop_back();
+        if (path.empty())
+            continue;
+
+        // Later lines replace the fingerprints of maps that have changed
+        Entry &entry = m_Entries[path];
+        entry.size = size;
+        entry.mtime = mtime;
+        entry.hash = hash;
+        lines++;
+    }
+    fclose(fp);
+
+    if (lines > m_Entries.size() * 2)
+        return Rewrite();
+    return true;
+}
+
+std::string MapHashCache::Get(const std::string &filename) {
+    struct stat buf = {0};
+    if (stat(filename.c_str(), &buf) != 0)
+        return ComputeMapHash(filename.c_str());
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_Entries.find(filename);
+        if (it != m_Entries.end() && it->second.size == (int64_t) buf.st_size && it->second.mtime == (int64_t) buf.st_mtime)
+            return it->second.hash;
+    }
+
+    std::string hash = ComputeMapHash(filename.c_str());
+    if (hash.empty())
+        return hash;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Entry &entry = m_Entries[filename];
+    entry.size = buf.st_size;
+    entry.mtime = buf.st_mtime;
+    entry.hash = hash;
+
+    if (!m_CachePath.empty()) {
+        FILE *fp = fopen(m_CachePath.c_str(), "a");
+        if (fp) {
+            fprintf(fp, "%s %lld %lld %s\n", hash.c_str(), (long long) entry.size, (long long) entry.mtime, filename.c_str());
+            fclose(fp);
+        }
+    }
+    return hash;
+}
+
+bool MapHashCache::Rewrite() {
+    std::vector<char> data;
+    char line[64];
+    for (auto &[path, entry] : m_Entries) {
+        int size = snprintf(line, sizeof(line), "%s %lld %lld ", entry.hash.c_str(), (long long) entry.size, (long long) entry.mtime);
+        if (size < 0 || size >= (int) sizeof(line))
+            return false;
+        data.insert(data.end(), line, line + size);
+        data.insert(data.end(), path.begin(), path.end());
+        data.push_back('\n');
+    }
+
+    // A rewrite cut short leaves the cache as it was
+    return WriteFileAtomic(m_CachePath.c_str(), data);
+}
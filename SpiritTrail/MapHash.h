@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Fingerprint of a map naming its trail directory, the CRCs of the four quarters of the file.
+// The file is read in blocks, it is never held in memory at once.
+std::string ComputeMapHash(const char *filename);
+
+// Fingerprints of maps by resolved path, kept as long as the size and modification time of the map
+// do not change, so a map is only read the first time it is loaded. The cache file is a line of
+// [hash] [size] [mtime] [path] per map, new fingerprints are appended to it. Get may be called from
+// any thread.
+class MapHashCache {
+public:
+    // Returns false if the cache file had to be rewritten and could not be
+    bool Load(const std::string &cachePath);
+
+    // Returns the fingerprint of the map, computing it when it is not cached
+    std::string Get(const std::string &filename);
+
+private:
+    struct Entry {
+        int64_t size = 0;
+        int64_t mtime = 0;
+        std::string hash;
+    };
+
+    bool Rewrite();
+
+    std::string m_CachePath;
+    std::unordered_map<std::string, Entry> m_Entries;
+    std::mutex m_Mutex;
+};
@@ -1,7 +1,10 @@
 #include "SpiritTrail.h"
+#include "GhostCommand.h"
 
+#include <algorithm>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <time.h>
 
 IMod *BMLEntry(IBML *bml) {
     return new SpiritTrail(bml);
@@ -11,148 +14,115 @@ void BMLExit(IMod *mod) {
     delete mod;
 }
 
-std::pair<char *, int> ReadDataFromFile(const char *filename) {
-    if (!filename) return {nullptr, 0};
-    FILE *fp = fopen(filename, "rb");
-    if (!fp) return {nullptr, 0};
-
-    fseek(fp, 0, SEEK_END);
-    int size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
+void SpiritTrail::OnLoad() {
+    VxMakeDirectory("..\\ModLoader\\Trails\\");
+    if (!m_HashCache.Load("..\\ModLoader\\Trails\\maps.txt"))
+        GetLogger()->Warn("Failed to rewrite the map fingerprint cache");
+    m_IoQueue.Start();
 
-    char *buffer = new char[size];
-    fread(buffer, size, 1, fp);
-    fclose(fp);
+    GetConfig()->SetCategoryComment("Misc", "Miscellaneous");
+    m_Enabled = GetConfig()->GetProperty("Misc", "Enable");
+    m_Enabled->SetComment("Enable Spirit Trail");
+    m_Enabled->SetDefaultBoolean(false);
 
-    return {buffer, size};
-}
+    m_HSSR = GetConfig()->GetProperty("Misc", "HS_SR");
+    m_HSSR->SetComment("Play HS(No) or SR(Yes) record");
+    m_HSSR->SetDefaultBoolean(false);
 
-std::string GetFileHash(const char *filename) {
-    if (!filename) return "";
-    auto data = ReadDataFromFile(filename);
-    if (!data.first) return "";
-
-    std::string res;
-    int segm[] = {0, data.second / 4, data.second / 2, data.second * 3 / 4, data.second};
-    for (int i = 0; i < 4; i++) {
-        char hash[10];
-        CKDWORD crc = CKComputeDataCRC(data.first + segm[i], segm[i + 1] - segm[i]);
-        sprintf(hash, "%08lx", crc);
-        res += hash;
-    }
+    m_DeathReset = GetConfig()->GetProperty("Misc", "DeathReset");
+    m_DeathReset->SetComment("Reset record on Death");
+    m_DeathReset->SetDefaultBoolean(true);
 
-    delete[] data.first;
-    return res;
-}
+    GetConfig()->SetCategoryComment("Ghosts", "Ghosts played along with the best record");
+    m_ShowLast = GetConfig()->GetProperty("Ghosts", "ShowLast");
+    m_ShowLast->SetComment("Play the last finished attempt of the sector");
+    m_ShowLast->SetDefaultBoolean(false);
 
-void WriteDataToFile(char *data, int size, const char *filename) {
-    if (!data || size == 0 || !filename)
-        return;
+    m_ShowImported = GetConfig()->GetProperty("Ghosts", "ShowImported");
+    m_ShowImported->SetComment("Play records put in the ghosts\\<sector> folder of the map");
+    m_ShowImported->SetDefaultBoolean(false);
 
-    FILE *fp = fopen(filename, "wb");
-    fwrite(data, size, 1, fp);
-    fclose(fp);
-}
+    m_MaxGhosts = GetConfig()->GetProperty("Ghosts", "MaxGhosts");
+    m_MaxGhosts->SetComment("Maximum number of ghosts played at once");
+    m_MaxGhosts->SetDefaultInteger(16);
 
-std::pair<char *, int> UncompressDataFromFile(const char *filename) {
-    if (!filename) return {nullptr, 0};
+    m_ShowDelta = GetConfig()->GetProperty("Ghosts", "ShowDelta");
+    m_ShowDelta->SetComment("Show how far ahead or behind the best record the ball is");
+    m_ShowDelta->SetDefaultBoolean(true);
 
-    FILE *fp = fopen(filename, "rb");
-    if (!fp) return {nullptr, 0};
+    m_ShowRoute = GetConfig()->GetProperty("Ghosts", "ShowRoute");
+    m_ShowRoute->SetComment("Draw the route of the best record, colored by speed");
+    m_ShowRoute->SetDefaultBoolean(false);
 
-    fseek(fp, 0, SEEK_END);
-    int nsize = ftell(fp) - 4;
-    fseek(fp, 0, SEEK_SET);
+    m_RouteAhead = GetConfig()->GetProperty("Ghosts", "RouteAhead");
+    m_RouteAhead->SetComment("Seconds of the route drawn ahead of the best record, 0 for the whole route");
+    m_RouteAhead->SetDefaultFloat(0.0f);
 
-    int size;
-    char *buffer = new char[nsize];
-    fread(&size, 4, 1, fp);
-    fread(buffer, nsize, 1, fp);
-    fclose(fp);
+    m_HistoryBest = GetConfig()->GetProperty("Ghosts", "HistoryBest");
+    m_HistoryBest->SetComment("Number of fastest past attempts of the sector to play");
+    m_HistoryBest->SetDefaultInteger(0);
 
-    char *res = CKUnPackData(size, buffer, nsize);
-    delete[] buffer;
-    return {res, size};
-}
+    m_HistoryRecent = GetConfig()->GetProperty("Ghosts", "HistoryRecent");
+    m_HistoryRecent->SetComment("Number of most recent past attempts of the sector to play");
+    m_HistoryRecent->SetDefaultInteger(0);
 
-void CompressDataToFile(char *data, int size, const char *filename) {
-    if (!data || size == 0 || !filename)
-        return;
+    m_HistoryMedian = GetConfig()->GetProperty("Ghosts", "HistoryMedian");
+    m_HistoryMedian->SetComment("Play the past attempt of the sector with the median time");
+    m_HistoryMedian->SetDefaultBoolean(false);
 
-    int nsize;
-    char *res = CKPackData(data, size, nsize, 9);
+    GetConfig()->SetCategoryComment("Record", "Recording Settings");
+    m_Tolerance = GetConfig()->GetProperty("Record", "Tolerance");
+    m_Tolerance->SetComment("Maximum distance between the recorded and replayed ball");
+    m_Tolerance->SetDefaultFloat(0.05f);
 
-    FILE *fp = fopen(filename, "wb");
-    if (!fp) return;
+    m_AngleTolerance = GetConfig()->GetProperty("Record", "AngleTolerance");
+    m_AngleTolerance->SetComment("Maximum angle in degrees between the recorded and replayed ball");
+    m_AngleTolerance->SetDefaultFloat(3.0f);
 
-    fwrite(&size, 4, 1, fp);
-    fwrite(res, nsize, 1, fp);
-    fclose(fp);
+    m_MaxAttempts = GetConfig()->GetProperty("Record", "MaxAttempts");
+    m_MaxAttempts->SetComment("Past attempts kept per sector, the oldest are removed first except the 10 best");
+    m_MaxAttempts->SetDefaultInteger(100);
 
-    CKDeletePointer(res);
+    m_BML->RegisterCommand(new GhostCommand(this));
+    m_BML->GetRenderContext()->AddPostRenderCallBack(RenderRoute, this, FALSE, TRUE);
 }
 
-void SpiritTrail::OnLoad() {
-    VxMakeDirectory("..\\ModLoader\\Trails\\");
-
-    GetConfig()->SetCategoryComment("Misc", "Miscellaneous");
-    m_Enabled = GetConfig()->GetProperty("Misc", "Enable");
-    m_Enabled->SetComment("Enable Spirit Trail");
-    m_Enabled->SetDefaultBoolean(false);
-
-    m_HSSR = GetConfig()->GetProperty("Misc", "HS_SR");
-    m_HSSR->SetComment("Play HS(No) or SR(Yes) record");
-    m_HSSR->SetDefaultBoolean(false);
-
-    m_DeathReset = GetConfig()->GetProperty("Misc", "DeathReset");
-    m_DeathReset->SetComment("Reset record on Death");
-    m_DeathReset->SetDefaultBoolean(true);
+void SpiritTrail::OnUnload() {
+    m_BML->GetRenderContext()->RemovePostRenderCallBack(RenderRoute, this);
+    m_IoQueue.Stop();
 }
 
 void SpiritTrail::OnLoadObject(const char *filename, CKBOOL isMap, const char *masterName, CK_CLASSID filterClass,
                                CKBOOL addToScene, CKBOOL reuseMeshes, CKBOOL reuseMaterials, CKBOOL dynamic,
                                XObjectArray *objArray, CKObject *masterObj) {
     if (isMap) {
+        WaitForMap();
         m_CurMap = filename;
         XString filepath = filename;
         m_BML->GetPathManager()->ResolveFileName(filepath, DATA_PATH_IDX);
-        m_RecordDir = "..\\ModLoader\\Trails\\" + GetFileHash(filepath.CStr()) + "\\";
-        VxMakeDirectory((CKSTRING) m_RecordDir.c_str());
+
+        m_History.reset();
+        m_PinnedAttempt = UINT32_MAX;
+
+        // The map is fingerprinted while the rest of the level loads, it is only read when not cached.
+        // Saves of the previous map were queued before, they are done by the time the new history opens.
+        m_MapJob = m_IoQueue.Push([this, path = std::string(filepath.CStr())]() -> IoQueue::Completion {
+            std::string dir = "..\\ModLoader\\Trails\\" + m_HashCache.Get(path) + "\\";
+            VxMakeDirectory((CKSTRING) dir.c_str());
+
+            auto history = std::make_shared<AttemptLog>();
+            bool opened = history->Open(dir);
+            return [this, dir, history, opened]() {
+                m_RecordDir = dir;
+                m_History = history;
+                if (!opened)
+                    GetLogger()->Warn("Failed to open the attempt history of this map");
+            };
+        });
     }
 
     if (!strcmp(filename, "3D Entities\\Balls.nmo")) {
-        CKDataArray *physBall = m_BML->GetArrayByName("Physicalize_GameBall");
-        for (int i = 0; i < physBall->GetRowCount(); i++) {
-            SpiritBall ball;
-            ball.name.resize(physBall->GetElementStringValue(i, 0, nullptr), '\0');
-            physBall->GetElementStringValue(i, 0, &ball.name[0]);
-            ball.name.pop_back();
-            ball.obj = m_BML->Get3dObjectByName(ball.name.c_str());
-
-            CKDependencies dep;
-            dep.Resize(40);
-            dep.Fill(0);
-            dep.m_Flags = CK_DEPENDENCIES_CUSTOM;
-            dep[CKCID_OBJECT] = CK_DEPENDENCIES_COPY_OBJECT_NAME | CK_DEPENDENCIES_COPY_OBJECT_UNIQUENAME;
-            dep[CKCID_MESH] = CK_DEPENDENCIES_COPY_MESH_MATERIAL;
-            dep[CKCID_3DENTITY] = CK_DEPENDENCIES_COPY_3DENTITY_MESH;
-            ball.obj = (CK3dObject *) m_BML->GetCKContext()->CopyObject(ball.obj, &dep, "_Spirit");
-            for (int j = 0; j < ball.obj->GetMeshCount(); j++) {
-                CKMesh *mesh = ball.obj->GetMesh(j);
-                for (int k = 0; k < mesh->GetMaterialCount(); k++) {
-                    CKMaterial *mat = mesh->GetMaterial(k);
-                    mat->EnableAlphaBlend();
-                    mat->SetSourceBlend(VXBLEND_SRCALPHA);
-                    mat->SetDestBlend(VXBLEND_INVSRCALPHA);
-                    VxColor color = mat->GetDiffuse();
-                    color.a = 0.5f;
-                    mat->SetDiffuse(color);
-                    ball.materials.push_back(mat);
-                    m_BML->SetIC(mat);
-                }
-            }
-            m_DualBalls.push_back(ball);
-        }
+        m_Balls.Load(m_BML, "Spirit");
         GetLogger()->Info("Created Spirit Balls");
     }
 
@@ -164,30 +134,32 @@ void SpiritTrail::OnLoadObject(const char *filename, CKBOOL isMap, const char *m
 }
 
 void SpiritTrail::OnProcess() {
+    m_IoQueue.Poll();
+
     if (m_SRActivated)
         m_SRTimer += m_BML->GetTimeManager()->GetLastDeltaTime();
 
-    const float delta = 1000.0f / TICK_SPEED;
     if (m_IsRecording && !m_RecordPaused) {
-        m_RecordTimer += m_BML->GetTimeManager()->GetLastDeltaTime();
-        m_RecordTimer = (std::min)(m_RecordTimer, 1000.0f);
-
-        while (m_RecordTimer > 0) {
-            m_RecordTimer -= delta;
-
-            int curBall = GetCurrentBall();
-            if (curBall != m_CurBall)
-                m_Record.trafo.emplace_back(m_Record.states.size(), curBall);
-            m_CurBall = curBall;
-
-            auto *ball = (CK3dObject *) m_CurLevel->GetElementObject(0, 1);
-            if (ball) {
-                Record::State state;
-                ball->GetPosition(&state.pos);
-                ball->GetQuaternion(&state.rot);
-                m_Record.states.push_back(state);
-            }
+        m_RecordTime += m_BML->GetTimeManager()->GetLastDeltaTime();
+
+        // Ball transformations always get keyframes of their own, the last sample of the old ball ends a
+        // segment and the first sample of the new ball, where playback switches, starts the next one
+        int curBall = GetCurrentBall();
+        bool transformed = curBall != m_CurBall;
+        if (transformed)
+            m_Simplifier.Split();
+        m_CurBall = curBall;
+
+        auto *ball = (CK3dObject *) m_CurLevel->GetElementObject(0, 1);
+        if (ball) {
+            VxVector pos;
+            VxQuaternion rot;
+            ball->GetPosition(&pos);
+            ball->GetQuaternion(&rot);
+            m_Simplifier.Add(m_RecordTime, pos, rot);
         }
+        if (transformed)
+            m_Record.trafo.emplace_back(m_Simplifier.Split(), curBall);
 
         if (m_BML->IsCheatEnabled()) {
             StopRecording();
@@ -200,41 +172,49 @@ void SpiritTrail::OnProcess() {
     }
 
     if (m_IsPlaying && !m_PlayPaused) {
-        m_PlayTimer += m_BML->GetTimeManager()->GetLastDeltaTime();
-        m_PlayTimer = std::min(m_PlayTimer, 1000.0f);
-
-        while (m_PlayTimer > 0) {
-            m_PlayTimer -= delta;
-            m_PlayFrame++;
-
-            auto &trafos = m_Play[m_PlayHSSR].trafo;
-            if (m_PlayTrafo < trafos.size()) {
-                auto &trafo = trafos[m_PlayTrafo];
-                if (m_PlayFrame == trafo.first) {
-                    SetCurrentBall(trafo.second);
-                    m_PlayTrafo++;
+        m_PlayTime += m_BML->GetTimeManager()->GetLastDeltaTime();
+        m_Player.Update(m_PlayTime);
+
+        // Where the best record passed the position of the ball, not just when both reach a checkpoint
+        m_HasDelta = false;
+        if (!m_Path.IsEmpty()) {
+            auto *ball = (CK3dObject *) m_CurLevel->GetElementObject(0, 1);
+            if (ball) {
+                VxVector pos;
+                float time;
+                ball->GetPosition(&pos);
+                if (m_Path.Project(pos, time)) {
+                    m_Delta = m_PlayTime - time;
+                    m_HasDelta = true;
                 }
             }
         }
 
-        auto &states = m_Play[m_PlayHSSR].states;
-        if (m_PlayFrame >= 0 && m_PlayFrame < states.size() - 1) {
-            if (m_PlayBall >= 0 && m_PlayBall < m_DualBalls.size()) {
-                CKObject *playerBall = m_CurLevel->GetElementObject(0, 1);
-                CK3dObject *ball = m_DualBalls[m_PlayBall].obj;
-                ball->Show(playerBall->IsVisible() ? CKSHOW : CKHIDE);
-
-                float portion = (m_PlayTimer / delta + 1);
-                Record::State &cur = states[m_PlayFrame], &next = states[m_PlayFrame + 1];
-                VxVector position = (next.pos - cur.pos) * portion + cur.pos;
-                VxQuaternion rotation = Slerp(portion, cur.rot, next.rot);
-                ball->SetPosition(&position);
-                ball->SetQuaternion(&rotation);
+        CKObject *playerBall = m_CurLevel->GetElementObject(0, 1);
+        bool playing = false;
+        for (size_t i = 0; i < m_Player.GetGhostCount(); i++) {
+            if (!m_Player.IsEnded(i))
+                playing = true;
+            if (!m_Player.IsPlaying(i)) {
+                m_Balls.Hide(i);
+                continue;
             }
-        } else {
-            StopPlaying();
+
+            m_Balls.Show(i, m_Player.GetBall(i), playerBall->IsVisible(),
+                         m_Player.GetPosition(i), m_Player.GetRotation(i));
         }
+
+        // The delta and the route are still shown once the best record has finished
+        if (!playing && m_Path.IsEmpty() && m_Route.IsEmpty())
+            StopPlaying();
     }
+
+    if (m_IsPlaying && m_HasDelta)
+        DrawDelta();
+}
+
+void SpiritTrail::WaitForMap() {
+    m_IoQueue.Wait(m_MapJob);
 }
 
 int SpiritTrail::GetHSScore() {
@@ -246,15 +226,7 @@ int SpiritTrail::GetHSScore() {
 
 int SpiritTrail::GetCurrentBall() {
     CKObject *ball = m_CurLevel->GetElementObject(0, 1);
-    if (ball) {
-        std::string ballName = ball->GetName();
-        for (size_t i = 0; i < m_DualBalls.size(); i++) {
-            if (m_DualBalls[i].name == ballName)
-                return i;
-        }
-    }
-
-    return 0;
+    return ball ? m_Balls.GetBallType(ball->GetName()) : 0;
 }
 
 int SpiritTrail::GetCurrentSector() {
@@ -263,45 +235,136 @@ int SpiritTrail::GetCurrentSector() {
     return res;
 }
 
-void SpiritTrail::SetCurrentBall(int curBall) {
-    m_PlayBall = curBall;
-    for (auto &ball: m_DualBalls)
-        ball.obj->Show(CKHIDE);
-    if (m_PlayBall >= 0 && m_PlayBall < m_DualBalls.size())
-        m_DualBalls[m_PlayBall].obj->Show();
+void SpiritTrail::DrawDelta() {
+    Bui::ImGuiContextScope scope;
+
+    const ImVec2 &vpSize = ImGui::GetMainViewport()->Size;
+    ImGui::SetNextWindowPos(ImVec2(vpSize.x * 0.5f, vpSize.y * 0.05f), ImGuiCond_Always, ImVec2(0.5f, 0.0f));
+
+    constexpr ImGuiWindowFlags DeltaFlags = ImGuiWindowFlags_NoDecoration |
+                                            ImGuiWindowFlags_NoBackground |
+                                            ImGuiWindowFlags_NoMove |
+                                            ImGuiWindowFlags_NoNav |
+                                            ImGuiWindowFlags_NoInputs |
+                                            ImGuiWindowFlags_AlwaysAutoResize |
+                                            ImGuiWindowFlags_NoBringToFrontOnFocus |
+                                            ImGuiWindowFlags_NoFocusOnAppearing |
+                                            ImGuiWindowFlags_NoSavedSettings;
+
+    if (ImGui::Begin("SpiritTrail_Delta", nullptr, DeltaFlags)) {
+        // Ahead of the record in green, behind in red
+        float seconds = m_Delta / 1000.0f;
+        ImVec4 color = seconds <= 0.0f ? ImVec4(0.2f, 0.8f, 0.2f, 1.0f) : ImVec4(0.85f, 0.08f, 0.25f, 1.0f);
+        ImGui::TextColored(color, "%+.3f", seconds);
+    }
+    ImGui::End();
+}
+
+void SpiritTrail::RenderRoute(CKRenderContext *dev, void *arg) {
+    auto *mod = (SpiritTrail *) arg;
+    if (mod->m_IsPlaying)
+        mod->m_Route.Draw(dev, mod->m_PlayTime, mod->m_RouteAhead->GetFloat() * 1000.0f);
 }
 
 void SpiritTrail::PreparePlaying() {
     if (!m_IsPlaying && m_Enabled->GetBoolean() && !m_WaitPlaying) {
         m_WaitPlaying = true;
 
-        m_LoadPlay = std::thread([this]() {
-            std::string recfile[2] = {(m_RecordDir + "hs" + std::to_string(m_CurSector) + ".rec"),
-                                      (m_RecordDir + "sr" + std::to_string(m_CurSector) + ".rec")};
-            m_PlayHSSR = m_HSSR->GetBoolean();
+        // Everything the worker needs is copied here, what it loads is handed back to the game thread
+        struct PlayLoad {
+            Record play[2];
+            std::vector<GhostSource> sources;
+            GhostPath path;
+            GhostRoute route;
+        };
+        auto load = std::make_shared<PlayLoad>();
+        bool hssr = m_HSSR->GetBoolean(), showDelta = m_ShowDelta->GetBoolean(), showRoute = m_ShowRoute->GetBoolean(),
+            showLast = m_ShowLast->GetBoolean(), showImported = m_ShowImported->GetBoolean(),
+            historyMedian = m_HistoryMedian->GetBoolean();
+        size_t historyBest = (std::max)(m_HistoryBest->GetInteger(), 0),
+            historyRecent = (std::max)(m_HistoryRecent->GetInteger(), 0),
+            maxGhosts = (std::max)(m_MaxGhosts->GetInteger(), 1);
+
+        m_PlayJob = m_IoQueue.Push([this, load, hssr, showDelta, showRoute, showLast, showImported, historyMedian,
+                                    historyBest, historyRecent, maxGhosts, dir = m_RecordDir, sector = m_CurSector,
+                                    history = m_History, pinned = m_PinnedAttempt]() -> IoQueue::Completion {
+            std::string recfile[2] = {(dir + "hs" + std::to_string(sector) + ".rec"),
+                                      (dir + "sr" + std::to_string(sector) + ".rec")};
 
             struct stat buf = {0};
             for (int i = 0; i < 2; i++) {
-                if (stat(recfile[i].c_str(), &buf) == 0) {
-                    std::pair<char *, int> data = UncompressDataFromFile(recfile[i].c_str());
-                    m_Play[i].hsscore = *reinterpret_cast<int *>(data.first);
-                    m_Play[i].srscore = *reinterpret_cast<float *>(data.first + 4);
-                    if (bool(i) == m_PlayHSSR) {
-                        int ssize = *reinterpret_cast<int *>(data.first + 8);
-                        int tsize = *reinterpret_cast<int *>(data.first + 12);
-                        m_Play[i].states.resize(ssize);
-                        memcpy(&m_Play[i].states[0], data.first + 16, ssize * sizeof(Record::State));
-                        m_Play[i].trafo.resize(tsize);
-                        memcpy(&m_Play[i].trafo[0], data.first + 16 + ssize * sizeof(Record::State),
-                               tsize * sizeof(std::pair<int, int>));
-                    }
+                if (stat(recfile[i].c_str(), &buf) != 0 || !LoadGhostFile(recfile[i].c_str(), load->play[i], true)) {
+                    load->play[i].states.clear();
+                    load->play[i].trafo.clear();
+                    load->play[i].hsscore = INT_MIN;
+                    load->play[i].srscore = FLT_MAX;
+                }
+            }
+
+            // The ghosts are only opened here, they are read while they are played
+            std::vector<std::string> files;
+            if (load->play[hssr].hsscore > INT_MIN) {
+                files.push_back(recfile[hssr]);
+
+                // Only the path and the route of the best record are kept in memory, not its keyframes
+                GhostRecord best;
+                if ((showDelta || showRoute) && LoadGhostFile(recfile[hssr].c_str(), best, false)) {
+                    if (showDelta)
+                        load->path.Build(best);
+                    if (showRoute)
+                        load->route.Build(best);
+                }
+            }
+            if (showLast)
+                files.push_back(dir + "last" + std::to_string(sector) + ".rec");
+            if (showImported) {
+                std::string ghostdir = dir + "ghosts\\" + std::to_string(sector) + "\\";
+                CKDirectoryParser parser((CKSTRING) ghostdir.c_str(), (CKSTRING) "*.rec", FALSE);
+                for (char *path = parser.GetNextFile(); path != nullptr; path = parser.GetNextFile())
+                    files.emplace_back(path);
+            }
 
-                    CKDeletePointer(data.first);
-                } else {
-                    m_Play[i].hsscore = INT_MIN;
-                    m_Play[i].srscore = FLT_MAX;
+            for (auto &file : files) {
+                if (stat(file.c_str(), &buf) == 0) {
+                    GhostSource source;
+                    source.path = file;
+                    load->sources.push_back(source);
+                }
+            }
+
+            // Past attempts from the history of the map
+            if (history) {
+                std::vector<Attempt> attempts;
+                Attempt attempt;
+                if (pinned != UINT32_MAX && history->Find(pinned, attempt) && attempt.sector == sector)
+                    attempts.push_back(attempt);
+                for (auto &best : history->Query(sector, AttemptLog::BY_TIME, historyBest))
+                    attempts.push_back(best);
+                for (auto &recent : history->Query(sector, AttemptLog::BY_DATE, historyRecent))
+                    attempts.push_back(recent);
+                if (historyMedian && history->GetMedian(sector, attempt))
+                    attempts.push_back(attempt);
+
+                std::vector<uint32_t> added;
+                for (auto &past : attempts) {
+                    if (std::find(added.begin(), added.end(), past.id) == added.end()) {
+                        added.push_back(past.id);
+                        load->sources.push_back(history->GetSource(past));
+                    }
                 }
             }
+
+            if (load->sources.size() > maxGhosts)
+                load->sources.resize(maxGhosts);
+
+            return [this, load, hssr]() {
+                m_PlayHSSR = hssr;
+                for (int i = 0; i < 2; i++)
+                    m_Play[i] = std::move(load->play[i]);
+                m_GhostSources = std::move(load->sources);
+                m_Path = std::move(load->path);
+                m_Route = std::move(load->route);
+            };
         });
     }
 }
@@ -310,16 +373,15 @@ void SpiritTrail::StartPlaying() {
     if (!m_IsPlaying && m_Enabled->GetBoolean() && m_WaitPlaying) {
         m_WaitPlaying = false;
 
-        if (m_LoadPlay.joinable())
-            m_LoadPlay.join();
+        m_IoQueue.Wait(m_PlayJob);
 
-        if (m_Play[m_PlayHSSR].hsscore > INT_MIN) {
+        m_Player.Start(m_GhostSources);
+        if (m_Player.GetGhostCount() > 0) {
             m_IsPlaying = true;
             m_PlayPaused = false;
-            m_PlayTimer = -1000.0f / TICK_SPEED;
-            m_PlayFrame = 0;
-            m_PlayTrafo = 1;
-            SetCurrentBall(m_Play[m_PlayHSSR].trafo[0].second);
+            m_PlayTime = 0;
+            m_Balls.Reserve(m_Player.GetGhostCount());
+            m_Balls.HideAll();
         }
     }
 }
@@ -335,15 +397,18 @@ void SpiritTrail::UnpausePlaying() {
 void SpiritTrail::StopPlaying() {
     if (m_IsPlaying) {
         m_IsPlaying = false;
+        m_HasDelta = false;
+        m_Path.Clear();
+        m_Route.Clear();
         for (int i = 0; i < 2; i++) {
             m_Play[i].states.clear();
             m_Play[i].states.shrink_to_fit();
             m_Play[i].trafo.clear();
             m_Play[i].trafo.shrink_to_fit();
         }
+        m_Player.Stop();
 
-        for (auto &ball: m_DualBalls)
-            ball.obj->Show(CKHIDE);
+        m_Balls.HideAll();
     }
 }
 
@@ -360,9 +425,11 @@ void SpiritTrail::StartRecording() {
         m_RecordPaused = false;
 
         m_StartHS = GetHSScore();
-        m_RecordTimer = 0;
+        m_RecordTime = 0;
         m_SRTimer = 0;
         m_CurBall = GetCurrentBall();
+        m_Simplifier.Reset();
+        m_Simplifier.SetTolerance(m_Tolerance->GetFloat(), m_AngleTolerance->GetFloat());
         m_Record.trafo.emplace_back(0, m_CurBall);
     }
 }
@@ -378,6 +445,7 @@ void SpiritTrail::UnpauseRecording() {
 void SpiritTrail::StopRecording() {
     if (m_IsRecording) {
         m_IsRecording = false;
+        m_Simplifier.Reset();
         m_Record.trafo.clear();
         m_Record.trafo.shrink_to_fit();
         m_Record.states.clear();
@@ -385,61 +453,39 @@ void SpiritTrail::StopRecording() {
     }
 }
 
-static bool CopyFile(const char *src, const char *dst) {
-    FILE *fin = fopen(src, "rb");
-    if (!fin) return false;
-    FILE *fout = fopen(dst, "wb");
-    if (!fout) return false;
-
-    int ch;
-    while ((ch = fgetc(fin)) != EOF)
-        fputc(ch, fout);
-
-    fclose(fin);
-    fclose(fout);
-    return true;
-}
-
 void SpiritTrail::EndRecording() {
     if (m_IsRecording) {
+        m_Simplifier.Finish();
         m_Record.hsscore = GetHSScore() - m_StartHS;
         m_Record.srscore = GetSRScore();
 
         bool savehs = m_Record.hsscore > m_Play[0].hsscore,
             savesr = m_Record.srscore < m_Play[1].srscore;
-        if (savehs || savesr) {
-            int ssize = sizeof(Record::State) * m_Record.states.size();
-            int tsize = sizeof(std::pair<int, int>) * m_Record.trafo.size();
-            int size = 16 + ssize + tsize;
-
-            char *buffer = new char[size];
-            *reinterpret_cast<int *>(buffer) = m_Record.hsscore;
-            *reinterpret_cast<float *>(buffer + 4) = m_Record.srscore;
-            *reinterpret_cast<int *>(buffer + 8) = m_Record.states.size();
-            *reinterpret_cast<int *>(buffer + 12) = m_Record.trafo.size();
-            memcpy(buffer + 16, &m_Record.states[0], ssize);
-            memcpy(buffer + 16 + ssize, &m_Record.trafo[0], tsize);
-
-            std::string hspath = m_RecordDir + "hs" + std::to_string(m_CurSector) + ".rec",
-                srpath = m_RecordDir + "sr" + std::to_string(m_CurSector) + ".rec";
-
-            std::thread([savehs, savesr, hspath, srpath, buffer, size]() {
-                if (savehs) {
-                    CompressDataToFile(buffer, size, hspath.c_str());
-                    if (savesr) {
-                        CopyFile(hspath.c_str(), srpath.c_str());
-                    }
-                } else {
-                    CompressDataToFile(buffer, size, srpath.c_str());
-                }
-                delete[] buffer;
-            }).detach();
-
-            if (savehs)
-                GetLogger()->Info("HS of sector %d has updated", m_CurSector);
-            if (savesr)
-                GetLogger()->Info("SR of sector %d has updated", m_CurSector);
-        }
+        std::string lastpath = m_RecordDir + "last" + std::to_string(m_CurSector) + ".rec",
+            hspath = m_RecordDir + "hs" + std::to_string(m_CurSector) + ".rec",
+            srpath = m_RecordDir + "sr" + std::to_string(m_CurSector) + ".rec";
+
+        // Every finished attempt is kept as the last one and in the history, improved scores get a copy of it.
+        // Saves are queued before any later load of the same files.
+        m_IoQueue.Push([this, savehs, savesr, lastpath, hspath, srpath, history = m_History, sector = m_CurSector,
+                        maxAttempts = (size_t) (std::max)(m_MaxAttempts->GetInteger(), 1),
+                        record = std::move(m_Record)]() -> IoQueue::Completion {
+            bool saved = EncodeGhostFile(record, m_SaveBuffer) && WriteFileAtomic(lastpath.c_str(), m_SaveBuffer);
+            bool hs = saved && savehs && WriteFileAtomic(hspath.c_str(), m_SaveBuffer);
+            bool sr = saved && savesr && WriteFileAtomic(srpath.c_str(), m_SaveBuffer);
+
+            if (saved && history && history->Append(sector, record, m_SaveBuffer, (int64_t) time(nullptr)))
+                history->Prune(sector, maxAttempts, 10);
+
+            return [this, sector, saved, hs, sr]() {
+                if (!saved)
+                    GetLogger()->Warn("Failed to save the record of sector %d", sector);
+                if (hs)
+                    GetLogger()->Info("HS of sector %d has updated", sector);
+                if (sr)
+                    GetLogger()->Info("SR of sector %d has updated", sector);
+            };
+        });
 
         StopRecording();
     }
@@ -1,10 +1,19 @@
 #pragma once
 
-#include <thread>
+#include <memory>
 
 #include <BML/BMLAll.h>
 
-#define TICK_SPEED 8
+#include "AttemptLog.h"
+#include "GhostBalls.h"
+#include "GhostCodec.h"
+#include "GhostFile.h"
+#include "GhostPath.h"
+#include "GhostPlayer.h"
+#include "GhostRoute.h"
+#include "GhostTrack.h"
+#include "IoQueue.h"
+#include "MapHash.h"
 
 MOD_EXPORT IMod *BMLEntry(IBML *bml);
 MOD_EXPORT void BMLExit(IMod *mod);
@@ -21,12 +30,14 @@ public:
     DECLARE_BML_VERSION;
 
     void OnLoad() override;
+    void OnUnload() override;
     void OnLoadObject(const char *filename, CKBOOL isMap, const char *masterName, CK_CLASSID filterClass,
                       CKBOOL addToScene, CKBOOL reuseMeshes, CKBOOL reuseMaterials, CKBOOL dynamic,
                       XObjectArray *objArray, CKObject *masterObj) override;
     void OnProcess() override;
 
     void OnStartLevel() override {
+        WaitForMap();
         m_CurSector = 1;
         PreparePlaying();
         PrepareRecording();
@@ -95,7 +106,15 @@ public:
     int GetCurrentBall();
     int GetCurrentSector();
 
-    void SetCurrentBall(int curBall);
+    AttemptLog *GetHistory() { return m_History.get(); }
+    int GetSector() const { return m_CurSector; }
+    void PinAttempt(uint32_t id) { m_PinnedAttempt = id; }
+    void UnpinAttempt() { m_PinnedAttempt = UINT32_MAX; }
+
+    void WaitForMap();
+
+    void DrawDelta();
+    static void RenderRoute(CKRenderContext *dev, void *arg);
 
     void PreparePlaying();
     void StartPlaying();
@@ -113,50 +132,56 @@ public:
 private:
     std::string m_CurMap;
     std::string m_RecordDir;
+    MapHashCache m_HashCache;
+    IoQueue m_IoQueue;
+    uint64_t m_MapJob = 0;
+    uint64_t m_PlayJob = 0;
+    std::vector<char> m_SaveBuffer; // I/O worker only
     int m_CurSector = 0;
 
     bool m_WaitRecording = false;
     bool m_IsRecording = false;
     int m_StartHS = 0;
-    float m_RecordTimer = 0;
-    size_t m_CurBall = 0;
+    float m_RecordTime = 0;
+    int m_CurBall = 0;
     bool m_RecordPaused = false;
 
     bool m_WaitPlaying = false;
     bool m_IsPlaying = false;
-    float m_PlayTimer = 0;
-    size_t m_PlayBall = 0;
+    float m_PlayTime = 0;
     bool m_PlayHSSR = false;
-    size_t m_PlayFrame = 0;
-    size_t m_PlayTrafo = 0;
     bool m_PlayPaused = false;
 
-    struct Record {
-        int hsscore;
-        float srscore;
-
-        struct State {
-            VxVector pos;
-            VxQuaternion rot;
-        };
-
-        std::vector<State> states;
-        std::vector<std::pair<int, int>> trafo;
-    };
+    using Record = GhostRecord;
     Record m_Record, m_Play[2];
-    std::thread m_LoadPlay;
-    bool m_LoadingPlay = false;
+    std::vector<GhostSource> m_GhostSources;
+    std::shared_ptr<AttemptLog> m_History;
+    uint32_t m_PinnedAttempt = UINT32_MAX;
+    GhostPlayer m_Player;
+    GhostPath m_Path;
+    GhostRoute m_Route;
+    float m_Delta = 0;
+    bool m_HasDelta = false;
+    GhostSimplifier m_Simplifier{m_Record.states};
 
     IProperty *m_Enabled = nullptr;
     IProperty *m_HSSR = nullptr;
     IProperty *m_DeathReset = nullptr;
-
-    struct SpiritBall {
-        std::string name;
-        CK3dObject *obj;
-        std::vector<CKMaterial *> materials;
-    };
-    std::vector<SpiritBall> m_DualBalls;
+    IProperty *m_ShowLast = nullptr;
+    IProperty *m_ShowImported = nullptr;
+    IProperty *m_MaxGhosts = nullptr;
+    IProperty *m_ShowDelta = nullptr;
+    IProperty *m_ShowRoute = nullptr;
+    IProperty *m_RouteAhead = nullptr;
+    IProperty *m_HistoryBest = nullptr;
+    IProperty *m_HistoryRecent = nullptr;
+    IProperty *m_HistoryMedian = nullptr;
+    IProperty *m_MaxAttempts = nullptr;
+    IProperty *m_Tolerance = nullptr;
+    IProperty *m_AngleTolerance = nullptr;
+
+    // Each played ghost has its own set of balls
+    GhostBalls m_Balls;
 
     CKDataArray *m_Energy = nullptr;
     CKDataArray *m_CurLevel = nullptr;
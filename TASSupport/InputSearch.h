@@ -0,0 +1,388 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+// Key bits used by the search engine. They mirror the fields of InputState so that the
+// engine does not depend on the Virtools headers and can be driven by any simulator.
+enum InputKey : uint16_t {
+    INPUT_KEY_UP = 0x001,
+    INPUT_KEY_DOWN = 0x002,
+    INPUT_KEY_LEFT = 0x004,
+    INPUT_KEY_RIGHT = 0x008,
+    INPUT_KEY_SHIFT = 0x010,
+    INPUT_KEY_SPACE = 0x020,
+    INPUT_KEY_Q = 0x040,
+    INPUT_KEY_ESC = 0x080,
+    INPUT_KEY_ENTER = 0x100,
+};
+
+// Parse an alphabet like "U,UR,R,DL,-" into key masks ('-' or an empty entry means no key).
+// Letters: U D L R, S (shift), P (space), Q.
+inline std::vector<uint16_t> ParseInputAlphabet(const char *text) {
+    std::vector<uint16_t> alphabet;
+    if (!text)
+        return alphabet;
+
+    uint16_t mask = 0;
+    bool any = false;
+    for (const char *p = text;; ++p) {
+        const char c = *p;
+        if (c == ',' || c == ';' || c == ' ' || c == '\0') {
+            if (any)
+                alphabet.push_back(mask);
+            mask = 0;
+            any = false;
+            if (c == '\0')
+                break;
+            continue;
+        }
+
+        any = true;
+        switch (c) {
+            case 'U': case 'u': mask |= INPUT_KEY_UP; break;
+            case 'D': case 'd': mask |= INPUT_KEY_DOWN; break;
+            case 'L': case 'l': mask |= INPUT_KEY_LEFT; break;
+            case 'R': case 'r': mask |= INPUT_KEY_RIGHT; break;
+            case 'S': case 's': mask |= INPUT_KEY_SHIFT; break;
+            case 'P': case 'p': mask |= INPUT_KEY_SPACE; break;
+            case 'Q': case 'q': mask |= INPUT_KEY_Q; break;
+            default: break;
+        }
+    }
+    return alphabet;
+}
+
+struct InputSearchConfig {
+    size_t window = 60;             // Frames to optimize
+    size_t hold = 6;                // Frames each decision is held for
+    size_t beamWidth = 64;          // Candidates kept per decision step
+    double pruneMargin = std::numeric_limits<double>::infinity(); // Drop candidates this far below the step's best
+    bool cancelOpposites = true;    // Up+Down and Left+Right push the ball in opposite directions and cancel out
+    std::vector<uint16_t> alphabet; // Key sets the search may hold
+};
+
+struct InputSearchStats {
+    size_t simulatedFrames = 0;
+    size_t restores = 0;
+    size_t candidates = 0;
+    size_t failed = 0;
+    size_t duplicates = 0;
+    size_t pruned = 0;
+};
+
+// Beam search over input sequences inside a window of frames.
+//
+// The window is split into decision steps of `hold` frames. Every candidate of a step keeps the
+// simulator snapshot taken at its end, so its children are simulated from that snapshot instead of
+// replaying the shared prefix from the window start. Each step keeps at most `beamWidth` candidates,
+// drops the ones that failed or fell more than `pruneMargin` behind, and collapses candidates whose
+// simulator fingerprints match (different inputs that led to the same state).
+//
+// The engine is driven one tick at a time through Advance(), so it works both with a synchronous
+// stand-in simulator and with the game, where each tick is a real engine frame. A simulator provides:
+//
+//     using Snapshot = ...;
+//     Snapshot Save();
+//     void Restore(const Snapshot &snapshot);
+//     void Apply(uint16_t keys);   // Inputs of the next tick (a stand-in simulator may step immediately)
+//     double Evaluate();           // Objective after the last ticked frame, higher is better
+//     bool IsFailed();             // The candidate is dead (ball fell, ...)
+//     uint64_t Fingerprint();      // Hash of the quantized state, used for deduplication
+template <typename Simulator>
+class InputSearch {
+public:
+    using Snapshot = typename Simulator::Snapshot;
+
+    explicit InputSearch(InputSearchConfig config) : m_Config(std::move(config)) {
+        if (m_Config.hold == 0)
+            m_Config.hold = 1;
+        if (m_Config.beamWidth == 0)
+            m_Config.beamWidth = 1;
+
+        // Deduplicate the alphabet itself: equal masks, and masks that only differ by cancelling keys.
+        std::vector<uint16_t> alphabet;
+        for (uint16_t keys : m_Config.alphabet) {
+            keys = Canonicalize(keys);
+            if (std::find(alphabet.begin(), alphabet.end(), keys) == alphabet.end())
+                alphabet.push_back(keys);
+        }
+        if (alphabet.empty())
+            alphabet.push_back(0);
+        m_Config.alphabet = std::move(alphabet);
+
+        m_StepCount = (m_Config.window + m_Config.hold - 1) / m_Config.hold;
+    }
+
+    [[nodiscard]] const InputSearchConfig &GetConfig() const { return m_Config; }
+    [[nodiscard]] const InputSearchStats &GetStats() const { return m_Stats; }
+
+    [[nodiscard]] bool IsRunning() const { return m_Running; }
+    [[nodiscard]] bool IsFinished() const { return m_Finished; }
+
+    [[nodiscard]] size_t GetStep() const { return m_Step; }
+    [[nodiscard]] size_t GetStepCount() const { return m_StepCount; }
+
+    // Best input sequence found, one key mask per frame of the window.
+    [[nodiscard]] const std::vector<uint16_t> &GetBestInputs() const { return m_BestInputs; }
+    [[nodiscard]] double GetBestScore() const { return m_BestScore; }
+    [[nodiscard]] bool HasResult() const { return !m_BestInputs.empty(); }
+
+    const Snapshot &GetRootSnapshot() const { return m_Root; }
+
+    void Begin(Simulator &sim) {
+        m_Root = sim.Save();
+
+        m_Layer.clear();
+        m_Next.clear();
+        m_TraceStore.clear();
+        m_Fingerprints.clear();
+        m_BestInputs.clear();
+        m_BestScore = -std::numeric_limits<double>::infinity();
+        m_Stats = {};
+
+        Node root;
+        root.snapshot = m_Root;
+        root.trace = -1;
+        m_Layer.push_back(std::move(root));
+
+        m_Step = 0;
+        m_NodeIndex = 0;
+        m_SymbolIndex = 0;
+        m_FramesDone = 0;
+        m_Expanding = false;
+        m_SimAtNode = 0;
+        m_Running = m_StepCount > 0;
+        m_Finished = !m_Running;
+    }
+
+    // Offset inside the window of the frame the next Advance() will apply inputs for.
+    [[nodiscard]] size_t GetNextFrameOffset() const {
+        if (!m_Running)
+            return m_Config.window;
+        if (m_Expanding && m_FramesDone < GetHold(m_Step))
+            return m_Step * m_Config.hold + m_FramesDone;
+
+        size_t node = m_NodeIndex, symbol = m_SymbolIndex;
+        if (m_Expanding)
+            NextCandidate(node, symbol);
+        if (node < m_Layer.size())
+            return m_Step * m_Config.hold;
+        return (m_Step + 1) * m_Config.hold;
+    }
+
+    // Performs the work of one tick. Returns false once the search is finished; the simulator is then
+    // left restored to the window start.
+    bool Advance(Simulator &sim) {
+        if (!m_Running)
+            return false;
+
+        if (m_Expanding) {
+            if (m_FramesDone < GetHold(m_Step)) {
+                sim.Apply(m_Config.alphabet[m_SymbolIndex]);
+                ++m_FramesDone;
+                ++m_Stats.simulatedFrames;
+                return true;
+            }
+
+            FinishCandidate(sim);
+            NextCandidate(m_NodeIndex, m_SymbolIndex);
+        }
+
+        while (m_NodeIndex >= m_Layer.size()) {
+            if (!FinishStep()) {
+                Finish(sim);
+                return false;
+            }
+        }
+
+        if (m_SimAtNode != m_NodeIndex) {
+            sim.Restore(m_Layer[m_NodeIndex].snapshot);
+            ++m_Stats.restores;
+        }
+        m_SimAtNode = SIZE_MAX;
+
+        m_Expanding = true;
+        m_FramesDone = 1;
+        ++m_Stats.simulatedFrames;
+        sim.Apply(m_Config.alphabet[m_SymbolIndex]);
+        return true;
+    }
+
+    // Runs the whole search synchronously. Only meaningful for simulators whose Apply() steps.
+    void Run(Simulator &sim) {
+        Begin(sim);
+        while (Advance(sim))
+            continue;
+    }
+
+    // Stops the search, keeping the best sequence of the last completed step if there is one.
+    void Cancel(Simulator &sim) {
+        if (m_Running)
+            Finish(sim);
+    }
+
+private:
+    struct Node {
+        Snapshot snapshot;
+        double score = 0.0;
+        int trace = -1;
+    };
+
+    struct Trace {
+        int parent = -1;
+        uint16_t keys = 0;
+    };
+
+    uint16_t Canonicalize(uint16_t keys) const {
+        if (m_Config.cancelOpposites) {
+            if ((keys & (INPUT_KEY_UP | INPUT_KEY_DOWN)) == (INPUT_KEY_UP | INPUT_KEY_DOWN))
+                keys &= ~(INPUT_KEY_UP | INPUT_KEY_DOWN);
+            if ((keys & (INPUT_KEY_LEFT | INPUT_KEY_RIGHT)) == (INPUT_KEY_LEFT | INPUT_KEY_RIGHT))
+                keys &= ~(INPUT_KEY_LEFT | INPUT_KEY_RIGHT);
+        }
+        return keys;
+    }
+
+    [[nodiscard]] size_t GetHold(size_t step) const {
+        return (std::min)(m_Config.hold, m_Config.window - step * m_Config.hold);
+    }
+
+    void NextCandidate(size_t &node, size_t &symbol) const {
+        if (++symbol >= m_Config.alphabet.size()) {
+            symbol = 0;
+            ++node;
+        }
+    }
+
+    void FinishCandidate(Simulator &sim) {
+        m_Expanding = false;
+        ++m_Stats.candidates;
+
+        if (sim.IsFailed()) {
+            ++m_Stats.failed;
+            return;
+        }
+
+        if (!m_Fingerprints.insert(sim.Fingerprint()).second) {
+            ++m_Stats.duplicates;
+            return;
+        }
+
+        Trace trace;
+        trace.parent = m_Layer[m_NodeIndex].trace;
+        trace.keys = m_Config.alphabet[m_SymbolIndex];
+
+        Node node;
+        node.score = sim.Evaluate();
+        node.trace = (int) m_TraceStore.size();
+        m_TraceStore.push_back(trace);
+
+        // No snapshot is taken for candidates that can no longer make it into the beam.
+        if (m_Next.size() >= m_Config.beamWidth && node.score <= m_NextWorst) {
+            ++m_Stats.pruned;
+            return;
+        }
+
+        node.snapshot = sim.Save();
+        m_Next.push_back(std::move(node));
+
+        if (m_Next.size() > m_Config.beamWidth * 2)
+            TrimNext();
+        else
+            m_NextWorst = (std::min)(m_NextWorst, m_Next.back().score);
+    }
+
+    void TrimNext() {
+        auto mid = m_Next.begin() + (std::ptrdiff_t) m_Config.beamWidth;
+        std::nth_element(m_Next.begin(), mid - 1, m_Next.end(), [](const Node &a, const Node &b) {
+            return a.score > b.score;
+        });
+        m_Stats.pruned += m_Next.size() - m_Config.beamWidth;
+        m_Next.erase(mid, m_Next.end());
+
+        m_NextWorst = std::numeric_limits<double>::infinity();
+        for (const auto &node : m_Next)
+            m_NextWorst = (std::min)(m_NextWorst, node.score);
+    }
+
+    bool FinishStep() {
+        if (m_Next.size() > m_Config.beamWidth)
+            TrimNext();
+
+        std::sort(m_Next.begin(), m_Next.end(), [](const Node &a, const Node &b) {
+            return a.score > b.score;
+        });
+
+        if (!m_Next.empty() && m_Config.pruneMargin < std::numeric_limits<double>::infinity()) {
+            const double limit = m_Next.front().score - m_Config.pruneMargin;
+            auto it = std::find_if(m_Next.begin(), m_Next.end(), [limit](const Node &n) { return n.score < limit; });
+            m_Stats.pruned += m_Next.end() - it;
+            m_Next.erase(it, m_Next.end());
+        }
+
+        ++m_Step;
+        if (!m_Next.empty()) {
+            m_BestScore = m_Next.front().score;
+            BuildInputs(m_Next.front().trace, m_Step);
+        }
+
+        m_Layer.swap(m_Next);
+        m_Next.clear();
+        m_Fingerprints.clear();
+        m_NextWorst = std::numeric_limits<double>::infinity();
+        m_NodeIndex = 0;
+        m_SymbolIndex = 0;
+
+        return m_Step < m_StepCount && !m_Layer.empty();
+    }
+
+    void BuildInputs(int trace, size_t steps) {
+        m_BestInputs.assign((std::min)(steps * m_Config.hold, m_Config.window), 0);
+        for (size_t step = steps; step-- > 0 && trace >= 0;) {
+            const Trace &t = m_TraceStore[trace];
+            const size_t begin = step * m_Config.hold;
+            std::fill_n(m_BestInputs.begin() + (std::ptrdiff_t) begin, GetHold(step), t.keys);
+            trace = t.parent;
+        }
+    }
+
+    void Finish(Simulator &sim) {
+        m_Running = false;
+        m_Finished = true;
+        m_Expanding = false;
+        m_Layer.clear();
+        m_Next.clear();
+        m_Fingerprints.clear();
+        sim.Restore(m_Root);
+        ++m_Stats.restores;
+    }
+
+    InputSearchConfig m_Config;
+    InputSearchStats m_Stats;
+    size_t m_StepCount = 0;
+
+    Snapshot m_Root{};
+    std::vector<Node> m_Layer;
+    std::vector<Node> m_Next;
+    double m_NextWorst = std::numeric_limits<double>::infinity();
+    std::vector<Trace> m_TraceStore;
+    std::unordered_set<uint64_t> m_Fingerprints;
+
+    size_t m_Step = 0;
+    size_t m_NodeIndex = 0;
+    size_t m_SymbolIndex = 0;
+    size_t m_FramesDone = 0;
+    size_t m_SimAtNode = SIZE_MAX;
+    bool m_Expanding = false;
+    bool m_Running = false;
+    bool m_Finished = false;
+
+    std::vector<uint16_t> m_BestInputs;
+    double m_BestScore = -std::numeric_limits<double>::infinity();
+};
@@ -0,0 +1,47 @@
+#include "TASCommand.h"
+#include "TASSupport.h"
+
+void TASCommand::Execute(IBML *bml, const std::vector<std::string> &args) {
+    if (args.size() >= 4 && args[1] == "splice") {
+        std::vector<std::string> sources(args.begin() + 3, args.end());
+        bool force = sources.back() == "-f";
+        if (force)
+            sources.pop_back();
+
+        if (!sources.empty() && m_Mod->SpliceRecord(args[2], sources, force))
+            bml->SendIngameMessage(("Spliced TAS record " + args[2]).c_str());
+        return;
+    }
+
+    if (args.size() < 3 || (args[1] != "totext" && args[1] != "tobin")) {
+        bml->SendIngameMessage("Usage: tasctl totext|tobin <record|*>");
+        bml->SendIngameMessage("       tasctl splice <output> <record>[:<sector>]... [-f]");
+        return;
+    }
+
+    bool toText = args[1] == "totext";
+    if (args[2] != "*") {
+        if (m_Mod->ConvertRecord(args[2], toText))
+            bml->SendIngameMessage(("Converted TAS record " + args[2]).c_str());
+        return;
+    }
+
+    int converted = 0;
+    for (const auto &record : m_Mod->ListRecords()) {
+        if (record.IsText() != toText && m_Mod->ConvertRecord(record.GetName(), toText))
+            ++converted;
+    }
+    bml->SendIngameMessage(("Converted " + std::to_string(converted) + " TAS records").c_str());
+}
+
+const std::vector<std::string> TASCommand::GetTabCompletion(IBML *bml, const std::vector<std::string> &args) {
+    if (args.size() == 2)
+        return {"totext", "tobin", "splice"};
+
+    std::vector<std::string> names;
+    if (args.size() == 3 || (args.size() > 3 && args[1] == "splice")) {
+        for (const auto &record : m_Mod->ListRecords())
+            names.push_back(record.GetName());
+    }
+    return names;
+}
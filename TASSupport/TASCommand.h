@@ -0,0 +1,20 @@
+#pragma once
+
+#include "BML/BMLAll.h"
+
+class TASSupport;
+
+class TASCommand : public ICommand {
+public:
+    explicit TASCommand(TASSupport *mod) : m_Mod(mod) {}
+
+    std::string GetName() override { return "tasctl"; }
+    std::string GetAlias() override { return ""; }
+    std::string GetDescription() override { return "Manage TAS records."; }
+    bool IsCheat() override { return false; }
+    void Execute(IBML *bml, const std::vector<std::string> &args) override;
+    const std::vector<std::string> GetTabCompletion(IBML *bml, const std::vector<std::string> &args) override;
+
+private:
+    TASSupport *m_Mod;
+};
@@ -12,6 +12,7 @@
 #include "BML/Guids.h"
 
 #include "physics_RT.h"
+#include "TASRandom.h"
 
 static void *GetModuleBaseAddress(const char *modulePath) {
     if (!modulePath)
@@ -35,13 +36,40 @@ static void *GetModuleBaseAddress(const char *modulePath) {
     return moduleInfo.lpBaseOfDll;
 }
 
+static uint64_t g_RandomSeed = 0;
+static TASRandom g_BehaviorRandom;
+static TASRandom g_PhysicsRandom;
+
+void SetRandomSeed(uint64_t seed) {
+    g_RandomSeed = seed;
+    g_BehaviorRandom.Reset(seed, 0);
+    g_PhysicsRandom.Reset(seed, 1);
+}
+
+uint64_t GetRandomSeed() {
+    return g_RandomSeed;
+}
+
+RandomState GetRandomState() {
+    return {g_BehaviorRandom.GetCounter(), g_PhysicsRandom.GetCounter()};
+}
+
+void SetRandomState(const RandomState &state) {
+    g_BehaviorRandom.SetCounter(state.behavior);
+    g_PhysicsRandom.SetCounter(state.physics);
+}
+
 // qh_RANDOMmax
 static const int QH_RAND_MAX = 2147483646;
 
 static int (*qh_rand)() = nullptr;
 static int (*qh_rand_orig)() = nullptr;
 
-int QH_Rand() { return QH_RAND_MAX; }
+int QH_Rand() {
+    if (g_RandomSeed == 0)
+        return QH_RAND_MAX;
+    return (int) g_PhysicsRandom.Next(QH_RAND_MAX);
+}
 
 static int (IVP_Environment::*must_perform_movement_check)();
 static int (IVP_Environment::*must_perform_movement_check_orig)();
@@ -90,9 +118,14 @@ void UnhookPhysicsRT() {
     MH_RemoveHook(*reinterpret_cast<LPVOID *>(&must_perform_movement_check));
 }
 
-static int g_FixedRandomValue = RAND_MAX / 2;
 static CKBEHAVIORFCT g_RandomOrig = nullptr;
 
+static int NextRandomValue() {
+    if (g_RandomSeed == 0)
+        return RAND_MAX / 2;
+    return (int) g_BehaviorRandom.Next(RAND_MAX);
+}
+
 #undef min
 #undef max
 
@@ -126,7 +159,7 @@ int Random(const CKBehaviorContext &behcontext) {
         float max;
         pin->GetValue(&max);
 
-        float res = min + g_FixedRandomValue * (max - min) / RAND_MAX;
+        float res = min + NextRandomValue() * (max - min) / RAND_MAX;
         pout->SetValue(&res);
 
         return CKBR_OK;
@@ -141,7 +174,7 @@ int Random(const CKBehaviorContext &behcontext) {
         int max;
         pin->GetValue(&max);
 
-        int res = min + g_FixedRandomValue * (max - min) / RAND_MAX;
+        int res = min + NextRandomValue() * (max - min) / RAND_MAX;
         pout->SetValue(&res);
 
         return CKBR_OK;
@@ -157,9 +190,9 @@ int Random(const CKBehaviorContext &behcontext) {
         pin->GetValue(&max);
 
         VxVector res;
-        res.x = min.x + g_FixedRandomValue * (max.x - min.x) / RAND_MAX;
-        res.y = min.y + g_FixedRandomValue * (max.y - min.y) / RAND_MAX;
-        res.z = min.z + g_FixedRandomValue * (max.z - min.z) / RAND_MAX;
+        res.x = min.x + NextRandomValue() * (max.x - min.x) / RAND_MAX;
+        res.y = min.y + NextRandomValue() * (max.y - min.y) / RAND_MAX;
+        res.z = min.z + NextRandomValue() * (max.z - min.z) / RAND_MAX;
 
         pout->SetValue(&res);
 
@@ -176,8 +209,8 @@ int Random(const CKBehaviorContext &behcontext) {
         pin->GetValue(&max);
 
         Vx2DVector res;
-        res.x = min.x + g_FixedRandomValue * (max.x - min.x) / RAND_MAX;
-        res.y = min.y + g_FixedRandomValue * (max.y - min.y) / RAND_MAX;
+        res.x = min.x + NextRandomValue() * (max.x - min.x) / RAND_MAX;
+        res.y = min.y + NextRandomValue() * (max.y - min.y) / RAND_MAX;
 
         pout->SetValue(&res);
 
@@ -194,10 +227,10 @@ int Random(const CKBehaviorContext &behcontext) {
         pin->GetValue(&max);
 
         VxRect res;
-        res.left = min.left + g_FixedRandomValue * (max.left - min.left) / RAND_MAX;
-        res.top = min.top + g_FixedRandomValue * (max.top - min.top) / RAND_MAX;
-        res.right = min.right + g_FixedRandomValue * (max.right - min.right) / RAND_MAX;
-        res.bottom = min.bottom + g_FixedRandomValue * (max.bottom - min.bottom) / RAND_MAX;
+        res.left = min.left + NextRandomValue() * (max.left - min.left) / RAND_MAX;
+        res.top = min.top + NextRandomValue() * (max.top - min.top) / RAND_MAX;
+        res.right = min.right + NextRandomValue() * (max.right - min.right) / RAND_MAX;
+        res.bottom = min.bottom + NextRandomValue() * (max.bottom - min.bottom) / RAND_MAX;
         res.Normalize();
         pout->SetValue(&res);
 
@@ -205,7 +238,7 @@ int Random(const CKBehaviorContext &behcontext) {
     }
 
     if (guid == CKPGUID_BOOL) {
-        CKBOOL res = g_FixedRandomValue & 1;
+        CKBOOL res = NextRandomValue() & 1;
 
         pout->SetValue(&res);
 
@@ -222,10 +255,10 @@ int Random(const CKBehaviorContext &behcontext) {
         pin->GetValue(&max);
 
         VxColor res;
-        res.r = min.r + g_FixedRandomValue * (max.r - min.r) / RAND_MAX;
-        res.g = min.g + g_FixedRandomValue * (max.g - min.g) / RAND_MAX;
-        res.b = min.b + g_FixedRandomValue * (max.b - min.b) / RAND_MAX;
-        res.a = min.a + g_FixedRandomValue * (max.a - min.a) / RAND_MAX;
+        res.r = min.r + NextRandomValue() * (max.r - min.r) / RAND_MAX;
+        res.g = min.g + NextRandomValue() * (max.g - min.g) / RAND_MAX;
+        res.b = min.b + NextRandomValue() * (max.b - min.b) / RAND_MAX;
+        res.a = min.a + NextRandomValue() * (max.a - min.a) / RAND_MAX;
         pout->SetValue(&res);
 
         return CKBR_OK;
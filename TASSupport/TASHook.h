@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <mutex>
 
 #include "Hook.h"
@@ -106,3 +107,15 @@ void UnhookPhysicsRT();
 // Make random building block deterministic
 bool HookRandom();
 bool UnhookRandom();
+
+// Random streams of the Random building block and of qhull, replayed from the seed of the record.
+// Seed 0 keeps the constant values older records were made with.
+struct RandomState {
+    uint64_t behavior = 0;
+    uint64_t physics = 0;
+};
+
+void SetRandomSeed(uint64_t seed);
+uint64_t GetRandomSeed();
+RandomState GetRandomState();
+void SetRandomState(const RandomState &state);
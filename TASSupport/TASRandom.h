@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+// Counter-based random stream: the n-th value is a SplitMix64 finalizer of (seed, stream, n), so the
+// whole state is one counter that can be saved, restored or rewound without replaying earlier draws.
+class TASRandom {
+public:
+    TASRandom() = default;
+    TASRandom(uint64_t seed, uint64_t stream) { Reset(seed, stream); }
+
+    void Reset(uint64_t seed, uint64_t stream) {
+        m_Key = Mix(seed + stream * GOLDEN_GAMMA);
+        m_Counter = 0;
+    }
+
+    [[nodiscard]] uint64_t GetCounter() const { return m_Counter; }
+    void SetCounter(uint64_t counter) { m_Counter = counter; }
+
+    uint64_t Next() { return Mix(m_Key + ++m_Counter * GOLDEN_GAMMA); }
+
+    // Uniform integer in [0, max], from the high bits of the next value
+    uint32_t Next(uint32_t max) {
+        return (uint32_t) (((Next() >> 32) * ((uint64_t) max + 1)) >> 32);
+    }
+
+    static uint64_t Mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+private:
+    static constexpr uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ull;
+
+    uint64_t m_Key = 0;
+    uint64_t m_Counter = 0;
+};
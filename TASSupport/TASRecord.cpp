@@ -1,11 +1,14 @@
 #include "TASRecord.h"
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 #include <fstream>
 
 #include <miniz.h>
 
 #include "VectorStream.h"
+#include "TASText.h"
 
 bool FrameHeader::Serialize(std::ostream &out) const {
     return Write(out, version) && Write(out, checksum);
@@ -380,6 +383,11 @@ bool TASRecord::DecompressData(const std::vector<uint8_t> &input, std::vector<ui
 void TASRecord::Load() {
     Clear();
 
+    if (IsText()) {
+        LoadText();
+        return;
+    }
+
     std::ifstream file(m_Path, std::ios::binary);
     if (!file.is_open())
         throw std::runtime_error("Failed to open file for reading");
@@ -408,6 +416,18 @@ void TASRecord::Load() {
         }
 
         Serializable::Read(file, m_Flags);
+        if (version >= 2)
+            Serializable::Read(file, m_Seed);
+
+        if (version >= 3) {
+            ChunkedFrames chunks;
+            ReadChunks(file, chunks);
+            file.close();
+
+            chunks.Decode(m_Frames);
+            m_Loaded = true;
+            return;
+        }
 
         uint32_t checksum;
         Serializable::Read(file, checksum);
@@ -485,14 +505,18 @@ void TASRecord::Load() {
 }
 
 void TASRecord::Save() const {
-    std::vector<uint8_t> data;
-    VectorOutputStream memStream(data);
+    if (IsText()) {
+        SaveText();
+        return;
+    }
 
     if (!m_Legacy) {
-        Serializable::WriteString(memStream, m_MapName);
-
-        size_t frameCount = m_Frames.size();
-        Serializable::Write(memStream, frameCount);
+        ChunkedFrames chunks;
+        chunks.Encode(m_Frames, GetSectorStarts());
+        SaveChunks(chunks);
+    } else {
+        std::vector<uint8_t> data;
+        VectorOutputStream memStream(data);
 
         for (const auto &frame : m_Frames) {
             if (!frame.Serialize(memStream)) {
@@ -500,15 +524,6 @@ void TASRecord::Save() const {
             }
         }
 
-        size_t sectorCount = m_Sectors.size();
-        Serializable::Write(memStream, sectorCount);
-
-        for (const auto &sector : m_Sectors) {
-            if (!sector.Serialize(memStream)) {
-                throw std::runtime_error("Failed to serialize a sector");
-            }
-        }
-
         std::vector<uint8_t> compressedData;
         if (!CompressData(data, compressedData)) {
             throw std::runtime_error("Failed to compress data");
@@ -518,38 +533,283 @@ void TASRecord::Save() const {
         if (!file.is_open())
             throw std::runtime_error("Failed to open file for writing");
 
-        Serializable::Write(file, MAGIC_NUMBER);
-        Serializable::Write(file, VERSION);
-        Serializable::Write(file, m_Flags);
-
-        uint32_t checksum = crc32(0, compressedData.data(), compressedData.size());
-        Serializable::Write(file, checksum);
-
         size_t compressedSize = compressedData.size();
         Serializable::Write(file, compressedSize);
         Serializable::WriteBytes(file, compressedData.data(), compressedSize);
 
         file.close();
-    } else {
-        for (const auto &frame : m_Frames) {
-            if (!frame.Serialize(memStream)) {
-                throw std::runtime_error("Failed to serialize a frame");
-            }
-        }
+    }
+}
 
-        std::vector<uint8_t> compressedData;
-        if (!CompressData(data, compressedData)) {
-            throw std::runtime_error("Failed to compress data");
-        }
+void TASRecord::LoadChunks(ChunkedFrames &chunks) {
+    chunks.Clear();
 
-        std::ofstream file(m_Path, std::ios::binary);
+    if (!IsText() && !m_Legacy) {
+        Clear();
+
+        std::ifstream file(m_Path, std::ios::binary);
         if (!file.is_open())
-            throw std::runtime_error("Failed to open file for writing");
+            throw std::runtime_error("Failed to open file for reading");
 
-        size_t compressedSize = compressedData.size();
-        Serializable::Write(file, compressedSize);
-        Serializable::WriteBytes(file, compressedData.data(), compressedSize);
+        uint32_t magic = 0, version = 0;
+        Serializable::Read(file, magic);
+        Serializable::Read(file, version);
+        if (magic != MAGIC_NUMBER)
+            throw std::runtime_error("Unknown file magic number");
+        if (version > VERSION)
+            throw std::runtime_error("Unsupported file version");
 
-        file.close();
+        if (version >= 3) {
+            Serializable::Read(file, m_Flags);
+            Serializable::Read(file, m_Seed);
+            ReadChunks(file, chunks);
+            m_Loaded = true;
+            return;
+        }
+    }
+
+    // Older and text records have to be decoded anyway
+    Load();
+    chunks.Encode(m_Frames, GetSectorStarts());
+    m_Frames.clear();
+    m_Frames.shrink_to_fit();
+}
+
+void TASRecord::SaveChunks(const ChunkedFrames &chunks) const {
+    if (IsText() || m_Legacy) {
+        TASRecord record = *this;
+        chunks.Decode(record.m_Frames);
+        record.Save();
+        return;
+    }
+
+    std::ofstream file(m_Path, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open file for writing");
+
+    Serializable::Write(file, MAGIC_NUMBER);
+    Serializable::Write(file, VERSION);
+    Serializable::Write(file, m_Flags);
+    Serializable::Write(file, m_Seed);
+    WriteChunks(file, chunks);
+
+    file.close();
+    if (file.fail())
+        throw std::runtime_error("Failed to write file");
+}
+
+// Version 3 body: map name, sectors each followed by its random counters, then each chunk as frame count,
+// checksum, size and compressed bytes.
+void TASRecord::ReadChunks(std::istream &in, ChunkedFrames &chunks) {
+    size_t sectorCount = 0;
+    uint32_t chunkCount = 0;
+    if (!Serializable::ReadString(in, m_MapName) ||
+        !Serializable::Read(in, sectorCount))
+        throw std::runtime_error("Failed to read record header");
+
+    m_Sectors.resize(sectorCount);
+    for (auto &sector : m_Sectors) {
+        if (!sector.Deserialize(in) ||
+            !Serializable::Read(in, sector.randomRecorded) ||
+            !Serializable::Read(in, sector.behaviorRandom) ||
+            !Serializable::Read(in, sector.physicsRandom))
+            throw std::runtime_error("Failed to deserialize a sector");
+    }
+
+    if (!Serializable::Read(in, chunkCount))
+        throw std::runtime_error("Failed to read record header");
+
+    for (uint32_t i = 0; i < chunkCount; ++i) {
+        FrameChunk chunk;
+        uint32_t size = 0;
+        if (!Serializable::Read(in, chunk.frameCount) ||
+            !Serializable::Read(in, chunk.checksum) ||
+            !Serializable::Read(in, size))
+            throw std::runtime_error("Failed to read a frame chunk");
+
+        chunk.data.resize(size);
+        if (!Serializable::ReadBytes(in, chunk.data.data(), size))
+            throw std::runtime_error("Failed to read a frame chunk");
+        if (crc32(0, chunk.data.data(), chunk.data.size()) != chunk.checksum)
+            throw std::runtime_error("Checksum mismatch");
+
+        chunks.AppendChunk(std::move(chunk));
+    }
+}
+
+void TASRecord::WriteChunks(std::ostream &out, const ChunkedFrames &chunks) const {
+    Serializable::WriteString(out, m_MapName);
+
+    size_t sectorCount = m_Sectors.size();
+    Serializable::Write(out, sectorCount);
+    for (const auto &sector : m_Sectors) {
+        if (!sector.Serialize(out) ||
+            !Serializable::Write(out, sector.randomRecorded) ||
+            !Serializable::Write(out, sector.behaviorRandom) ||
+            !Serializable::Write(out, sector.physicsRandom))
+            throw std::runtime_error("Failed to serialize a sector");
+    }
+
+    auto chunkCount = (uint32_t) chunks.GetChunks().size();
+    Serializable::Write(out, chunkCount);
+    for (const auto &chunk : chunks.GetChunks()) {
+        auto size = (uint32_t) chunk.data.size();
+        Serializable::Write(out, chunk.frameCount);
+        Serializable::Write(out, chunk.checksum);
+        Serializable::Write(out, size);
+        Serializable::WriteBytes(out, chunk.data.data(), size);
+    }
+}
+
+std::vector<size_t> TASRecord::GetSectorStarts() const {
+    std::vector<size_t> starts;
+    for (const auto &sector : m_Sectors) {
+        if (sector.frameStart > 0)
+            starts.push_back(sector.frameStart);
+    }
+    std::sort(starts.begin(), starts.end());
+    return starts;
+}
+
+void TASRecord::LoadText() {
+    FILE *file = fopen(m_Path.c_str(), "rb");
+    if (!file)
+        throw std::runtime_error("Failed to open file for reading");
+
+    try {
+        ReadTASText(file, m_MapName, m_Flags, m_Seed, m_Frames, m_Sectors);
+    } catch (...) {
+        fclose(file);
+        Clear();
+        throw;
+    }
+    fclose(file);
+
+    m_Loaded = true;
+}
+
+void TASRecord::SaveText() const {
+    FILE *file = fopen(m_Path.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("Failed to open file for writing");
+
+    try {
+        WriteTASText(file, m_MapName, m_Flags, m_Seed, m_Frames, m_Sectors);
+    } catch (...) {
+        fclose(file);
+        throw;
+    }
+    fclose(file);
+}
+
+// A frame is stored as in GameFrame::Serialize: the delta time followed by the nine key states.
+static constexpr size_t FRAME_SIZE = sizeof(float) + 9;
+
+void ChunkedFrames::EncodeChunk(const GameFrame *frames, size_t count, FrameChunk &chunk) {
+    std::vector<uint8_t> raw(count * FRAME_SIZE);
+    uint8_t *p = raw.data();
+    for (size_t i = 0; i < count; ++i) {
+        const GameFrame &frame = frames[i];
+        const InputState &state = frame.inputState;
+        memcpy(p, &frame.deltaTime, sizeof(float));
+        p += sizeof(float);
+        *p++ = state.keyUp;
+        *p++ = state.keyDown;
+        *p++ = state.keyLeft;
+        *p++ = state.keyRight;
+        *p++ = state.keyShift;
+        *p++ = state.keySpace;
+        *p++ = state.keyQ;
+        *p++ = state.keyEsc;
+        *p++ = state.keyEnter;
+    }
+
+    uLongf size = compressBound((uLong) raw.size());
+    chunk.data.resize(size);
+    if (compress(chunk.data.data(), &size, raw.data(), (uLong) raw.size()) != Z_OK)
+        throw std::runtime_error("Failed to compress frames");
+    chunk.data.resize(size);
+    chunk.frameCount = (uint32_t) count;
+    chunk.checksum = crc32(0, chunk.data.data(), chunk.data.size());
+}
+
+void ChunkedFrames::DecodeChunk(const FrameChunk &chunk, GameFrame *frames) {
+    std::vector<uint8_t> raw(chunk.frameCount * FRAME_SIZE);
+    uLongf size = (uLongf) raw.size();
+    if (uncompress(raw.data(), &size, chunk.data.data(), (uLong) chunk.data.size()) != Z_OK || size != raw.size())
+        throw std::runtime_error("Failed to decompress frames");
+
+    const uint8_t *p = raw.data();
+    for (size_t i = 0; i < chunk.frameCount; ++i) {
+        GameFrame &frame = frames[i];
+        InputState &state = frame.inputState;
+        memcpy(&frame.deltaTime, p, sizeof(float));
+        p += sizeof(float);
+        state.keyUp = *p++;
+        state.keyDown = *p++;
+        state.keyLeft = *p++;
+        state.keyRight = *p++;
+        state.keyShift = *p++;
+        state.keySpace = *p++;
+        state.keyQ = *p++;
+        state.keyEsc = *p++;
+        state.keyEnter = *p++;
+    }
+}
+
+void ChunkedFrames::Encode(const std::vector<GameFrame> &frames, const std::vector<size_t> &splits) {
+    Clear();
+
+    auto split = splits.begin();
+    size_t begin = 0;
+    while (begin < frames.size()) {
+        size_t end = (std::min)(begin + CHUNK_FRAMES, frames.size());
+        while (split != splits.end() && *split <= begin)
+            ++split;
+        if (split != splits.end() && *split < end)
+            end = *split;
+
+        FrameChunk chunk;
+        EncodeChunk(frames.data() + begin, end - begin, chunk);
+        AppendChunk(std::move(chunk));
+        begin = end;
+    }
+}
+
+void ChunkedFrames::Decode(std::vector<GameFrame> &frames) const {
+    frames.resize(m_FrameCount);
+    size_t offset = 0;
+    for (const auto &chunk : m_Chunks) {
+        DecodeChunk(chunk, frames.data() + offset);
+        offset += chunk.frameCount;
     }
 }
+
+void ChunkedFrames::Append(const ChunkedFrames &other, size_t begin, size_t end) {
+    size_t chunkBegin = 0;
+    for (const auto &chunk : other.m_Chunks) {
+        size_t chunkEnd = chunkBegin + chunk.frameCount;
+        if (chunkEnd > begin && chunkBegin < end) {
+            if (begin <= chunkBegin && chunkEnd <= end) {
+                AppendChunk(chunk);
+            } else {
+                std::vector<GameFrame> frames(chunk.frameCount);
+                DecodeChunk(chunk, frames.data());
+
+                size_t from = (std::max)(begin, chunkBegin) - chunkBegin;
+                size_t to = (std::min)(end, chunkEnd) - chunkBegin;
+                FrameChunk part;
+                EncodeChunk(frames.data() + from, to - from, part);
+                AppendChunk(std::move(part));
+            }
+        }
+        chunkBegin = chunkEnd;
+    }
+}
+
+void ChunkedFrames::AppendChunk(FrameChunk chunk) {
+    if (chunk.frameCount == 0)
+        return;
+    m_FrameCount += chunk.frameCount;
+    m_Chunks.push_back(std::move(chunk));
+}
@@ -209,6 +209,12 @@ struct Sector : Serializable {
     VxVector endPosition;
     std::vector<CK_ID> objects;
 
+    // Counters of the random streams as the first frame of the sector started, so that a sector
+    // replays alike after any other. Only records of version 3 keep them.
+    bool randomRecorded = false;
+    uint64_t behaviorRandom = 0;
+    uint64_t physicsRandom = 0;
+
     bool Serialize(std::ostream &out) const override;
     bool Deserialize(std::istream &in) override;
 };
@@ -239,6 +245,42 @@ struct GameFrame : Serializable {
     bool Deserialize(std::istream &in) override;
 };
 
+struct FrameChunk {
+    uint32_t frameCount = 0;
+    uint32_t checksum = 0;
+    std::vector<uint8_t> data; // Compressed frames
+};
+
+// Frames of a record split into independently compressed chunks, so that a range of frames can be
+// copied between records without decoding the chunks it fully covers.
+class ChunkedFrames {
+public:
+    static constexpr size_t CHUNK_FRAMES = 4096;
+
+    [[nodiscard]] size_t GetFrameCount() const { return m_FrameCount; }
+    [[nodiscard]] const std::vector<FrameChunk> &GetChunks() const { return m_Chunks; }
+
+    // Chunks are also cut at each of the sorted split points, e.g. the first frames of the sectors
+    void Encode(const std::vector<GameFrame> &frames, const std::vector<size_t> &splits = {});
+    void Decode(std::vector<GameFrame> &frames) const;
+
+    // Appends frames [begin, end) of other, only the chunks partially covered by the range are re-encoded
+    void Append(const ChunkedFrames &other, size_t begin, size_t end);
+    void AppendChunk(FrameChunk chunk);
+
+    void Clear() {
+        m_Chunks.clear();
+        m_FrameCount = 0;
+    }
+
+    static void EncodeChunk(const GameFrame *frames, size_t count, FrameChunk &chunk);
+    static void DecodeChunk(const FrameChunk &chunk, GameFrame *frames);
+
+private:
+    std::vector<FrameChunk> m_Chunks;
+    size_t m_FrameCount = 0;
+};
+
 class TASRecord {
 public:
     TASRecord() = default;
@@ -263,10 +305,17 @@ public:
     void SetMapName(const std::string &name) { m_MapName = name; }
 
     [[nodiscard]] bool IsLegacy() const { return m_Legacy; }
+    [[nodiscard]] bool IsText() const {
+        return m_Path.size() > 5 && m_Path.compare(m_Path.size() - 5, 5, ".tast") == 0;
+    }
     [[nodiscard]] bool IsLoaded() const { return m_Loaded; }
     void Load();
     void Save() const;
 
+    // Loads or saves everything except the frames, which are kept compressed in chunks
+    void LoadChunks(ChunkedFrames &chunks);
+    void SaveChunks(const ChunkedFrames &chunks) const;
+
     [[nodiscard]] bool IsPlaying() const { return m_FrameIndex < m_Frames.size(); }
     [[nodiscard]] bool IsFinished() const { return m_FrameIndex == m_Frames.size(); }
 
@@ -278,6 +327,7 @@ public:
     void NextFrame() { ++m_FrameIndex; }
     void PrevFrame() { --m_FrameIndex; }
     void ResetFrame() { m_FrameIndex = 0; }
+    void SetFrameIndex(size_t index) { m_FrameIndex = index; }
 
     void NewFrame(const GameFrame &frame) {
         if (!m_Frames.empty())
@@ -288,6 +338,7 @@ public:
     [[nodiscard]] size_t GetSectorCount() const { return m_Sectors.size(); }
     [[nodiscard]] size_t GetSectorIndex() const { return m_SectorIndex; }
     [[nodiscard]] std::vector<Sector> &GetSectors() { return m_Sectors; }
+    [[nodiscard]] const std::vector<Sector> &GetSectors() const { return m_Sectors; }
     Sector &GetCurrentSector() { return m_Sectors[m_SectorIndex]; }
 
     void NextSector() { ++m_SectorIndex; }
@@ -304,12 +355,17 @@ public:
     [[nodiscard]] uint32_t GetFlags() const { return m_Flags; }
     void SetFlags(uint32_t flags) { m_Flags = flags; }
 
+    // Seed of the random streams, 0 for records made with constant random values
+    [[nodiscard]] uint64_t GetSeed() const { return m_Seed; }
+    void SetSeed(uint64_t seed) { m_Seed = seed; }
+
     void Clear() {
         m_Loaded = false;
         m_FrameIndex = 0;
         m_Frames.clear();
         m_SectorIndex = 0;
         m_Sectors.clear();
+        m_Seed = 0;
     }
 
 private:
@@ -323,9 +379,16 @@ private:
     size_t m_SectorIndex = 0;
     std::vector<Sector> m_Sectors;
     uint32_t m_Flags = 0;
+    uint64_t m_Seed = 0;
 
     static constexpr uint32_t MAGIC_NUMBER = 0x534154; // "TAS" in reverse order
-    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t VERSION = 3;
+
+    void LoadText();
+    void SaveText() const;
+    void ReadChunks(std::istream &in, ChunkedFrames &chunks);
+    void WriteChunks(std::ostream &out, const ChunkedFrames &chunks) const;
+    [[nodiscard]] std::vector<size_t> GetSectorStarts() const;
 
     static bool CompressData(const std::vector<uint8_t> &input, std::vector<uint8_t> &output);
     static bool DecompressData(const std::vector<uint8_t> &input, std::vector<uint8_t> &output);
@@ -0,0 +1,178 @@
+#include "TASSearch.h"
+
+#include <cmath>
+
+#include "TASSupport.h"
+
+uint16_t InputStateToKeys(const InputState &state) {
+    uint16_t keys = 0;
+    if (state.keyUp) keys |= INPUT_KEY_UP;
+    if (state.keyDown) keys |= INPUT_KEY_DOWN;
+    if (state.keyLeft) keys |= INPUT_KEY_LEFT;
+    if (state.keyRight) keys |= INPUT_KEY_RIGHT;
+    if (state.keyShift) keys |= INPUT_KEY_SHIFT;
+    if (state.keySpace) keys |= INPUT_KEY_SPACE;
+    if (state.keyQ) keys |= INPUT_KEY_Q;
+    if (state.keyEsc) keys |= INPUT_KEY_ESC;
+    if (state.keyEnter) keys |= INPUT_KEY_ENTER;
+    return keys;
+}
+
+// Only the keys the search may hold are overwritten, menu keys of the original frame are kept.
+void ApplyKeysToInputState(uint16_t keys, InputState &state) {
+    state.keyUp = (keys & INPUT_KEY_UP) ? KS_PRESSED : KS_IDLE;
+    state.keyDown = (keys & INPUT_KEY_DOWN) ? KS_PRESSED : KS_IDLE;
+    state.keyLeft = (keys & INPUT_KEY_LEFT) ? KS_PRESSED : KS_IDLE;
+    state.keyRight = (keys & INPUT_KEY_RIGHT) ? KS_PRESSED : KS_IDLE;
+    state.keyShift = (keys & INPUT_KEY_SHIFT) ? KS_PRESSED : KS_IDLE;
+    state.keySpace = (keys & INPUT_KEY_SPACE) ? KS_PRESSED : KS_IDLE;
+    state.keyQ = (keys & INPUT_KEY_Q) ? KS_PRESSED : KS_IDLE;
+}
+
+void PhysicsCoreState::Capture(const IVP_Core *core) {
+    timeOfLastPSI = core->time_of_last_psi;
+    iDeltaTime = core->i_delta_time;
+    rotSpeedChange = core->rot_speed_change;
+    speedChange = core->speed_change;
+    rotSpeed = core->rot_speed;
+    speed = core->speed;
+    posWorldFCoreLastPSI = core->pos_world_f_core_last_psi;
+    deltaWorldFCorePSIs = core->delta_world_f_core_psis;
+    qWorldFCoreLastPSI = core->q_world_f_core_last_psi;
+    qWorldFCoreNextPSI = core->q_world_f_core_next_psi;
+    mWorldFCoreLastPSI = core->m_world_f_core_last_psi;
+    rotationAxisWorldSpace = core->rotation_axis_world_space;
+    currentSpeed = core->current_speed;
+    absOmega = core->abs_omega;
+    maxSurfaceRotSpeed = core->max_surface_rot_speed;
+}
+
+void PhysicsCoreState::Restore(IVP_Core *core) const {
+    core->time_of_last_psi = timeOfLastPSI;
+    core->i_delta_time = iDeltaTime;
+    core->rot_speed_change = rotSpeedChange;
+    core->speed_change = speedChange;
+    core->rot_speed = rotSpeed;
+    core->speed = speed;
+    core->pos_world_f_core_last_psi = posWorldFCoreLastPSI;
+    core->delta_world_f_core_psis = deltaWorldFCorePSIs;
+    core->q_world_f_core_last_psi = qWorldFCoreLastPSI;
+    core->q_world_f_core_next_psi = qWorldFCoreNextPSI;
+    core->m_world_f_core_last_psi = mWorldFCoreLastPSI;
+    core->rotation_axis_world_space = rotationAxisWorldSpace;
+    core->current_speed = currentSpeed;
+    core->abs_omega = absOmega;
+    core->max_surface_rot_speed = maxSurfaceRotSpeed;
+}
+
+GameSimulator::GameSimulator(TASSupport *mod, SearchObjective objective, const VxVector &target, float fallLimit)
+    : m_Mod(mod), m_Objective(objective), m_Target(target), m_FallLimit(fallLimit) {
+    VxVector velocity;
+    GetBallState(m_Start, velocity);
+
+    m_Direction = m_Target - m_Start;
+    if (m_Direction.SquareMagnitude() > 0.0f)
+        m_Direction.Normalize();
+    else
+        m_Direction.Set(0.0f, 0.0f, 0.0f);
+
+    if (m_Mod->m_CurrentRecord)
+        m_BaseInput = m_Mod->m_CurrentRecord->GetFrames().inputState;
+}
+
+PhysicsObject *GameSimulator::GetBall() const {
+    CK3dEntity *ball = m_Mod->GetActiveBall();
+    if (!ball)
+        return nullptr;
+    return m_Mod->m_IpionManager->GetPhysicsObject(ball);
+}
+
+bool GameSimulator::GetBallState(VxVector &position, VxVector &velocity) const {
+    PhysicsObject *obj = GetBall();
+    if (!obj)
+        return false;
+
+    obj->GetPosition(&position, nullptr);
+    obj->GetVelocity(&velocity, nullptr);
+    return true;
+}
+
+GameSimulator::Snapshot GameSimulator::Save() {
+    Snapshot snapshot;
+
+    PhysicsClock clock = m_Mod->GetPhysicsClock();
+    snapshot.baseTime = *clock.baseTime;
+    snapshot.currentTime = *clock.currentTime;
+    snapshot.timeOfLastPSI = *clock.timeOfLastPSI;
+    snapshot.timeOfNextPSI = *clock.timeOfNextPSI;
+    snapshot.random = GetRandomState();
+
+    CK3dEntity *ball = m_Mod->GetActiveBall();
+    if (ball)
+        snapshot.worldMatrix = ball->GetWorldMatrix();
+
+    PhysicsObject *obj = GetBall();
+    if (obj)
+        snapshot.core.Capture(obj->m_RealObject->get_core());
+
+    return snapshot;
+}
+
+void GameSimulator::Restore(const Snapshot &snapshot) {
+    PhysicsClock clock = m_Mod->GetPhysicsClock();
+    *clock.baseTime = snapshot.baseTime;
+    *clock.currentTime = snapshot.currentTime;
+    *clock.timeOfLastPSI = snapshot.timeOfLastPSI;
+    *clock.timeOfNextPSI = snapshot.timeOfNextPSI;
+    SetRandomState(snapshot.random);
+
+    CK3dEntity *ball = m_Mod->GetActiveBall();
+    if (ball)
+        ball->SetWorldMatrix(snapshot.worldMatrix);
+
+    PhysicsObject *obj = GetBall();
+    if (obj) {
+        snapshot.core.Restore(obj->m_RealObject->get_core());
+        obj->Wake();
+    }
+}
+
+void GameSimulator::Apply(uint16_t keys) {
+    InputState state = m_BaseInput;
+    ApplyKeysToInputState(keys, state);
+    m_Mod->SetKeyboardState(m_Mod->m_InputHook->GetKeyboardState(), state);
+}
+
+double GameSimulator::Evaluate() {
+    VxVector position, velocity;
+    if (!GetBallState(position, velocity))
+        return -1e30;
+
+    if (m_Objective == SEARCH_OBJECTIVE_POSITION)
+        return -Magnitude(position - m_Target);
+    return DotProduct(position - m_Start, m_Direction);
+}
+
+bool GameSimulator::IsFailed() {
+    VxVector position, velocity;
+    if (!GetBallState(position, velocity))
+        return true;
+    return position.y < m_Start.y - m_FallLimit;
+}
+
+uint64_t GameSimulator::Fingerprint() {
+    VxVector position, velocity;
+    GetBallState(position, velocity);
+
+    // Millimeter positions and centimeter-per-second velocities: closer states are treated as equal.
+    const float values[6] = {
+        position.x * 1000.0f, position.y * 1000.0f, position.z * 1000.0f,
+        velocity.x * 100.0f, velocity.y * 100.0f, velocity.z * 100.0f,
+    };
+
+    uint64_t hash = 0x9E3779B97F4A7C15ull;
+    for (float value : values) {
+        hash ^= (uint64_t) (int64_t) std::lround(value) + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
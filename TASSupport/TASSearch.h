@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+
+#include "VxMatrix.h"
+
+#include "physics_RT.h"
+#include "TASRecord.h"
+#include "TASHook.h"
+#include "InputSearch.h"
+
+class TASSupport;
+
+typedef enum SearchObjective {
+    SEARCH_OBJECTIVE_PROGRESS = 0, // Distance travelled from the window start towards the target
+    SEARCH_OBJECTIVE_POSITION = 1, // Distance to the target at the end of the window
+} SearchObjective;
+
+uint16_t InputStateToKeys(const InputState &state);
+void ApplyKeysToInputState(uint16_t keys, InputState &state);
+
+// Dynamic state of a physics core, copied field by field from IVP_Core.
+struct PhysicsCoreState {
+    IVP_Time timeOfLastPSI;
+    float iDeltaTime = 0.0f;
+    IVP_U_Float_Point rotSpeedChange;
+    IVP_U_Float_Point speedChange;
+    IVP_U_Float_Point rotSpeed;
+    IVP_U_Float_Point speed;
+    IVP_U_Point posWorldFCoreLastPSI;
+    IVP_U_Float_Point deltaWorldFCorePSIs;
+    IVP_U_Quat qWorldFCoreLastPSI;
+    IVP_U_Quat qWorldFCoreNextPSI;
+    IVP_U_Matrix mWorldFCoreLastPSI;
+    IVP_U_Float_Point rotationAxisWorldSpace;
+    float currentSpeed = 0.0f;
+    float absOmega = 0.0f;
+    float maxSurfaceRotSpeed = 0.0f;
+
+    void Capture(const IVP_Core *core);
+    void Restore(IVP_Core *core) const;
+};
+
+// Drives the running game as an InputSearch simulator.
+//
+// A snapshot holds the physics clock, the random streams and the core of the active ball, which is
+// everything the ball needs to continue from the same point; moving objects and scripts are not
+// part of it, so a search window must not cross a checkpoint or trigger gameplay events. Apply()
+// only writes the keys of the upcoming tick, the game then simulates the tick itself.
+class GameSimulator {
+public:
+    struct Snapshot {
+        double baseTime = 0.0;
+        double currentTime = 0.0;
+        double timeOfLastPSI = 0.0;
+        double timeOfNextPSI = 0.0;
+        VxMatrix worldMatrix;
+        PhysicsCoreState core;
+        RandomState random;
+    };
+
+    GameSimulator(TASSupport *mod, SearchObjective objective, const VxVector &target, float fallLimit);
+
+    Snapshot Save();
+    void Restore(const Snapshot &snapshot);
+    void Apply(uint16_t keys);
+    double Evaluate();
+    bool IsFailed();
+    uint64_t Fingerprint();
+
+private:
+    PhysicsObject *GetBall() const;
+    bool GetBallState(VxVector &position, VxVector &velocity) const;
+
+    TASSupport *m_Mod;
+    SearchObjective m_Objective;
+    VxVector m_Target;
+    VxVector m_Start;
+    VxVector m_Direction;
+    float m_FallLimit;
+    InputState m_BaseInput = {};
+};
@@ -0,0 +1,93 @@
+#include "TASSplice.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+namespace {
+    struct SpliceSource {
+        TASRecord record;
+        ChunkedFrames frames;
+    };
+
+    const Sector *FindSector(const TASRecord &record, int id) {
+        for (const auto &sector : record.GetSectors()) {
+            if (sector.id == id)
+                return &sector;
+        }
+        return nullptr;
+    }
+
+    bool IsRecorded(const VxVector &position) {
+        return position.x != 0.0f || position.y != 0.0f || position.z != 0.0f;
+    }
+}
+
+std::vector<SpliceSeam> SpliceRecords(const std::vector<SpliceSection> &sections, float tolerance, bool legacy,
+                                      TASRecord &result, ChunkedFrames &frames) {
+    std::vector<SpliceSeam> seams;
+    result.GetSectors().clear();
+    frames.Clear();
+    if (sections.empty())
+        return seams;
+
+    // Each source is loaded once with its frames left compressed
+    std::map<std::string, SpliceSource> sources;
+    for (const auto &section : sections) {
+        auto &source = sources[section.path];
+        if (!source.record.IsLoaded()) {
+            source.record = TASRecord(section.path, section.path, legacy);
+            source.record.LoadChunks(source.frames);
+        }
+    }
+
+    const TASRecord &first = sources[sections.front().path].record;
+    result.SetMapName(first.GetMapName());
+    result.SetFlags(first.GetFlags());
+    result.SetSeed(first.GetSeed());
+
+    const Sector *previous = nullptr;
+    uint64_t previousSeed = 0;
+    for (size_t i = 0; i < sections.size(); ++i) {
+        const auto &section = sections[i];
+        auto &source = sources[section.path];
+
+        if (source.record.GetMapName() != first.GetMapName())
+            throw std::runtime_error(section.path + " is a record of another map");
+
+        const Sector *sector = FindSector(source.record, section.sector);
+        if (!sector)
+            throw std::runtime_error(section.path + " has no sector " + std::to_string(section.sector));
+
+        // A sector lasts until the next one of its record starts
+        size_t count = source.frames.GetFrameCount();
+        const Sector *next = FindSector(source.record, section.sector + 1);
+        size_t begin = (i == 0) ? 0 : (std::min)((size_t) sector->frameStart, count);
+        size_t end = (i + 1 == sections.size()) ? count : (std::min)((size_t) (next ? next->frameStart : sector->frameEnd), count);
+        if (end < begin)
+            throw std::runtime_error(section.path + " has an invalid sector " + std::to_string(section.sector));
+
+        if (previous) {
+            SpliceSeam seam;
+            seam.sector = sector->id;
+            if (IsRecorded(previous->endPosition) && IsRecorded(sector->startPosition))
+                seam.distance = Magnitude(sector->startPosition - previous->endPosition);
+            seam.seedMismatch = previousSeed != source.record.GetSeed();
+            seam.randomMissing = source.record.GetSeed() != 0 && !sector->randomRecorded;
+            if (seam.distance < 0.0f || seam.distance > tolerance || seam.seedMismatch || seam.randomMissing)
+                seams.push_back(seam);
+        }
+
+        size_t offset = frames.GetFrameCount();
+        frames.Append(source.frames, begin, end);
+
+        Sector &spliced = result.GetSectors().emplace_back(*sector);
+        spliced.frameStart = (int) (offset + sector->frameStart - begin);
+        spliced.frameEnd = (int) (offset + sector->frameEnd - begin);
+
+        previous = sector;
+        previousSeed = source.record.GetSeed();
+    }
+
+    return seams;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "TASRecord.h"
+
+struct SpliceSection {
+    std::string path;
+    int sector = 0; // Sector id in the source record
+};
+
+// Boundary between two sections of a spliced record.
+struct SpliceSeam {
+    int sector = 0;         // Sector id after the seam
+    float distance = -1.0f; // Distance between the end and start positions, negative when one is not recorded
+    bool seedMismatch = false;
+    bool randomMissing = false; // No random counters to continue from, the replay diverges past the seam
+};
+
+// Builds a record from sectors of other records, section i providing the i-th sector of the result.
+// The first section also brings the frames before its sector and the last one the frames after it.
+// Frames are copied as compressed chunks, only chunks crossing a sector boundary are re-encoded.
+// Sectors keep the random counters they started with, playback restores them at each seam.
+// Seams whose positions differ by more than the tolerance, or cannot be checked, are returned.
+// Throws std::runtime_error when a record cannot be loaded or a sector does not exist.
+std::vector<SpliceSeam> SpliceRecords(const std::vector<SpliceSection> &sections, float tolerance, bool legacy,
+                                      TASRecord &result, ChunkedFrames &frames);
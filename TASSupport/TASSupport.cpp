@@ -1,6 +1,10 @@
 #include "TASSupport.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <thread>
 #include <sys/stat.h>
@@ -8,9 +12,15 @@
 #include <BML/Bui.h>
 
 #include "TASHook.h"
+#include "TASCommand.h"
+#include "TASRandom.h"
+#include "TASSplice.h"
 
 #define BML_TAS_PATH "..\\ModLoader\\TASRecords\\"
 
+// Largest distance between the end and start positions of spliced sectors
+#define SPLICE_TOLERANCE 0.5f
+
 TASSupport *g_Mod = nullptr;
 
 IMod *BMLEntry(IBML *bml) {
@@ -74,8 +84,48 @@ void TASSupport::OnLoad() {
     m_LegacyMode->SetDefaultBoolean(false);
     m_Legacy = m_LegacyMode->GetBoolean();
 
+    GetConfig()->SetCategoryComment("Search", "Input search over a window of frames of the playing record");
+
+    m_SearchEnabled = GetConfig()->GetProperty("Search", "Enable");
+    m_SearchEnabled->SetComment("Search the best inputs when the playing record reaches the start frame");
+    m_SearchEnabled->SetDefaultBoolean(false);
+
+    m_SearchStart = GetConfig()->GetProperty("Search", "StartFrame");
+    m_SearchStart->SetComment("First frame of the search window (the window must not cross a checkpoint)");
+    m_SearchStart->SetDefaultInteger(0);
+
+    m_SearchWindow = GetConfig()->GetProperty("Search", "Window");
+    m_SearchWindow->SetComment("Number of frames to optimize");
+    m_SearchWindow->SetDefaultInteger(60);
+
+    m_SearchHold = GetConfig()->GetProperty("Search", "Hold");
+    m_SearchHold->SetComment("Number of frames each key set is held for");
+    m_SearchHold->SetDefaultInteger(6);
+
+    m_SearchBeam = GetConfig()->GetProperty("Search", "BeamWidth");
+    m_SearchBeam->SetComment("Number of candidates kept after each hold");
+    m_SearchBeam->SetDefaultInteger(32);
+
+    m_SearchAlphabet = GetConfig()->GetProperty("Search", "Alphabet");
+    m_SearchAlphabet->SetComment("Key sets to try, separated by commas (U/D/L/R, S: Shift, P: Space, Q, -: none)");
+    m_SearchAlphabet->SetDefaultString("U,UL,UR,L,R,D,DL,DR,-");
+
+    m_SearchObjective = GetConfig()->GetProperty("Search", "Objective");
+    m_SearchObjective->SetComment("0: Progress towards the target, 1: Distance to the target at the end of the window");
+    m_SearchObjective->SetDefaultInteger(SEARCH_OBJECTIVE_PROGRESS);
+
+    m_SearchTarget = GetConfig()->GetProperty("Search", "Target");
+    m_SearchTarget->SetComment("Target position as x,y,z");
+    m_SearchTarget->SetDefaultString("0,0,0");
+
+    m_SearchFallLimit = GetConfig()->GetProperty("Search", "FallLimit");
+    m_SearchFallLimit->SetComment("Candidates falling this far below the start position are dropped");
+    m_SearchFallLimit->SetDefaultFloat(10.0f);
+
     VxMakeDirectory((CKSTRING) BML_TAS_PATH);
 
+    m_BML->RegisterCommand(new TASCommand(this));
+
     InitPhysicsMethodPointers();
 
     m_IpionManager = (CKIpionManager *) m_BML->GetCKContext()->GetManagerByGuid(CKGUID(0x6bed328b, 0x141f5148));
@@ -195,7 +245,14 @@ void TASSupport::OnProcess() {
         if (m_ShowMenu)
             OnDrawMenu();
 
-        if (IsPlaying()) {
+        if (IsSearching()) {
+            m_BML->SkipRenderForNextTick();
+
+            if (m_InputHook->IsKeyPressed(m_StopKey->GetKey()))
+                StopSearch(false);
+
+            OnDrawSearch();
+        } else if (IsPlaying()) {
             if (m_CurrentRecord->GetFrameIndex() < (size_t) m_SkipRender->GetInteger())
                 m_BML->SkipRenderForNextTick();
 
@@ -221,12 +278,14 @@ void TASSupport::OnPostStartMenu() {
         if (m_Enabled->GetBoolean() && !tasFile.empty()) {
             std::string tasPath = BML_TAS_PATH + tasFile + ".tas";
             struct stat buf = {0};
+            if (stat(tasPath.c_str(), &buf) != 0)
+                tasPath += 't';
             if (stat(tasPath.c_str(), &buf) == 0) {
                 m_RecordOnStartup.SetName(tasFile);
                 m_RecordOnStartup.SetPath(tasPath);
                 m_CurrentRecord = &m_RecordOnStartup;
 
-                m_BML->SendIngameMessage(("Loading TAS Record: " + tasFile + ".tas").c_str());
+                m_BML->SendIngameMessage(("Loading TAS Record: " + tasPath.substr(strlen(BML_TAS_PATH))).c_str());
 
                 try {
                     m_CurrentRecord->Load();
@@ -274,6 +333,10 @@ void TASSupport::OnStartLevel() {
         auto &sector = m_NewRecord.NewSector();
         sector.id = (int) m_NewRecord.GetSectorCount();
         sector.frameStart = (int) m_NewRecord.GetFrameIndex();
+        GetBallPosition(sector.startPosition);
+        // A sector starting before the first frame gets its counters with that frame
+        if (m_NewRecord.GetFrameCount() > 0)
+            RecordSectorRandom(sector);
         GetLogger()->Info("Sector %d started at frame %d", sector.id, sector.frameStart);
     }
 }
@@ -286,6 +349,7 @@ void TASSupport::OnLevelFinish() {
     if (IsRecording()) {
         auto &sector = m_NewRecord.GetCurrentSector();
         sector.frameEnd = (int) m_NewRecord.GetFrameIndex();
+        GetBallPosition(sector.endPosition);
         GetLogger()->Info("Sector %d finished at frame %d", sector.id, sector.frameEnd);
     }
 
@@ -293,7 +357,7 @@ void TASSupport::OnLevelFinish() {
 }
 
 void TASSupport::OnBallOff() {
-    if (m_Enabled->GetBoolean() && IsPlaying() && m_ExitOnDead->GetBoolean())
+    if (m_Enabled->GetBoolean() && IsPlaying() && !IsSearching() && m_ExitOnDead->GetBoolean())
         m_BML->ExitGame();
 }
 
@@ -301,6 +365,7 @@ void TASSupport::OnPreCheckpointReached() {
     if (IsRecording()) {
         auto &sector = m_NewRecord.GetCurrentSector();
         sector.frameEnd = (int) m_NewRecord.GetFrameIndex();
+        GetBallPosition(sector.endPosition);
         GetLogger()->Info("Sector %d finished at frame %d", sector.id, sector.frameEnd);
     }
 }
@@ -310,6 +375,10 @@ void TASSupport::OnPostCheckpointReached() {
         auto &sector = m_NewRecord.NewSector();
         sector.id = (int) m_NewRecord.GetSectorCount();
         sector.frameStart = (int) m_NewRecord.GetFrameIndex();
+        GetBallPosition(sector.startPosition);
+        // A sector starting before the first frame gets its counters with that frame
+        if (m_NewRecord.GetFrameCount() > 0)
+            RecordSectorRandom(sector);
         GetLogger()->Info("Sector %d started at frame %d", sector.id, sector.frameStart);
     }
 }
@@ -366,6 +435,8 @@ void TASSupport::OnStart() {
 
     AcquireKeyBindings();
 
+    uint64_t seed = GenerateSeed();
+
     if (m_Record->GetBoolean()) {
         m_NewRecord.Clear();
 
@@ -375,16 +446,26 @@ void TASSupport::OnStart() {
 
     if (m_CurrentRecord && m_CurrentRecord->IsLoaded()) {
         m_CurrentRecord->ResetFrame();
+        m_Searched = false;
+        seed = m_CurrentRecord->GetSeed();
 
         m_BML->SendIngameMessage("Start playing TAS.");
         m_State |= TAS_PLAYING;
     }
+
+    if (IsRecording())
+        m_NewRecord.SetSeed(seed);
+    SetRandomSeed(seed);
+    m_FrameRandom = GetRandomState();
 }
 
 void TASSupport::OnStop() {
     if (!m_Enabled->GetBoolean() || IsIdle())
         return;
 
+    if (IsSearching())
+        StopSearch(false);
+
     if (IsRecording()) {
         m_BML->SendIngameMessage("TAS recording stopped.");
         SetupNewRecord();
@@ -425,8 +506,26 @@ void TASSupport::OnFinish() {
 }
 
 void TASSupport::OnPreProcessInput() {
+    if (IsSearching()) {
+        if (m_Search->Advance(*m_Simulator))
+            return;
+        StopSearch(true);
+    } else if (IsPlaying() && m_SearchEnabled->GetBoolean() && !m_Searched &&
+               m_CurrentRecord->GetFrameIndex() == (size_t) m_SearchStart->GetInteger()) {
+        StartSearch();
+        if (IsSearching() && m_Search->Advance(*m_Simulator))
+            return;
+    }
+
     if (IsPlaying()) {
         if (m_CurrentRecord->IsPlaying()) {
+            // A sector may come from another run, it continues from the random counters it was recorded with
+            const int frame = (int) m_CurrentRecord->GetFrameIndex();
+            for (const auto &sector : m_CurrentRecord->GetSectors()) {
+                if (sector.randomRecorded && sector.frameStart == frame)
+                    SetRandomState({sector.behaviorRandom, sector.physicsRandom});
+            }
+
             const auto state = m_CurrentRecord->GetFrames().inputState;
             SetKeyboardState(m_InputHook->GetKeyboardState(), state);
             m_CurrentRecord->NextFrame();
@@ -438,10 +537,26 @@ void TASSupport::OnPreProcessInput() {
     if (IsRecording()) {
         auto state = GetKeyboardState(m_InputHook->GetKeyboardState());
         m_NewRecord.GetFrames().inputState = state;
+
+        m_FrameRandom = GetRandomState();
+        if (m_NewRecord.GetSectorCount() > 0) {
+            auto &sector = m_NewRecord.GetCurrentSector();
+            if (!sector.randomRecorded && sector.frameStart == (int) m_NewRecord.GetFrameIndex())
+                RecordSectorRandom(sector);
+        }
     }
 }
 
 void TASSupport::OnPreProcessTime() {
+    if (IsSearching()) {
+        // The tick after the last candidate restores the window start and replays its first frame
+        size_t offset = m_Search->GetNextFrameOffset();
+        if (offset >= m_Search->GetConfig().window)
+            offset = 0;
+        m_TimeManager->SetLastDeltaTime(m_CurrentRecord->GetFrame(m_SearchFrame + offset).deltaTime);
+        return;
+    }
+
     if (IsPlaying()) {
         if (m_CurrentRecord->IsPlaying()) {
             const float delta = m_CurrentRecord->GetFrames().deltaTime;
@@ -606,6 +721,27 @@ void TASSupport::OnDrawInfo() {
     ImGui::End();
 }
 
+void TASSupport::OnDrawSearch() {
+    constexpr ImGuiWindowFlags WinFlags = ImGuiWindowFlags_AlwaysAutoResize |
+                                          ImGuiWindowFlags_NoDecoration |
+                                          ImGuiWindowFlags_NoNav |
+                                          ImGuiWindowFlags_NoFocusOnAppearing |
+                                          ImGuiWindowFlags_NoBringToFrontOnFocus |
+                                          ImGuiWindowFlags_NoSavedSettings;
+
+    if (ImGui::Begin("TAS Search", nullptr, WinFlags)) {
+        const auto &stats = m_Search->GetStats();
+        ImGui::Text("Searching frames %d - %d", (int) m_SearchFrame, (int) (m_SearchFrame + m_Search->GetConfig().window));
+        ImGui::Text("Step: %d / %d", (int) m_Search->GetStep(), (int) m_Search->GetStepCount());
+        if (m_Search->HasResult())
+            ImGui::Text("Best: %.3f", m_Search->GetBestScore());
+        ImGui::Text("Candidates: %d (failed %d, duplicate %d, pruned %d)", (int) stats.candidates,
+                    (int) stats.failed, (int) stats.duplicates, (int) stats.pruned);
+        ImGui::Text("Simulated Frames: %d", (int) stats.simulatedFrames);
+    }
+    ImGui::End();
+}
+
 void TASSupport::InitHooks() {
     if (m_Hooked)
         return;
@@ -697,6 +833,98 @@ void TASSupport::SetNextMovementCheck(short count) {
     }
 }
 
+PhysicsClock TASSupport::GetPhysicsClock() const {
+    // IVP_Environment
+    auto *env = *reinterpret_cast<CKBYTE **>(reinterpret_cast<CKBYTE *>(m_IpionManager) + 0xC0);
+
+    PhysicsClock clock = {};
+    clock.baseTime = reinterpret_cast<double *>(*reinterpret_cast<CKBYTE **>(env + 0x4) + 0x18);
+    clock.currentTime = reinterpret_cast<double *>(env + 0x120);
+    clock.timeOfNextPSI = reinterpret_cast<double *>(env + 0x128);
+    clock.timeOfLastPSI = reinterpret_cast<double *>(env + 0x130);
+    return clock;
+}
+
+void TASSupport::StartSearch() {
+    m_Searched = true;
+
+    const size_t start = m_CurrentRecord->GetFrameIndex();
+    const size_t frameCount = m_CurrentRecord->GetFrameCount();
+    const int window = m_SearchWindow->GetInteger();
+    if (window <= 0 || start + window > frameCount) {
+        m_BML->SendIngameMessage("TAS search window is outside of the record.");
+        return;
+    }
+
+    InputSearchConfig config;
+    config.window = window;
+    config.hold = (std::max)(m_SearchHold->GetInteger(), 1);
+    config.beamWidth = (std::max)(m_SearchBeam->GetInteger(), 1);
+    config.alphabet = ParseInputAlphabet(m_SearchAlphabet->GetString());
+
+    VxVector target;
+    if (sscanf(m_SearchTarget->GetString(), "%f,%f,%f", &target.x, &target.y, &target.z) != 3)
+        target.Set(0.0f, 0.0f, 0.0f);
+
+    auto objective = (SearchObjective) m_SearchObjective->GetInteger();
+    m_Simulator = std::make_unique<GameSimulator>(this, objective, target, m_SearchFallLimit->GetFloat());
+    m_Search = std::make_unique<InputSearch<GameSimulator>>(std::move(config));
+    m_Search->Begin(*m_Simulator);
+    m_SearchFrame = start;
+
+    m_LimitOptions = m_TimeManager->GetLimitOptions();
+    m_TimeManager->ChangeLimitOptions(CK_FRAMERATE_FREE);
+
+    m_State |= TAS_SEARCHING;
+    m_BML->SendIngameMessage(("TAS search started at frame " + std::to_string(start) + ".").c_str());
+}
+
+void TASSupport::StopSearch(bool apply) {
+    if (!IsSearching())
+        return;
+
+    m_State &= ~TAS_SEARCHING;
+    m_TimeManager->ChangeLimitOptions((CK_FRAMERATE_LIMITS) (m_LimitOptions & CK_FRAMERATE_MASK));
+
+    if (m_Search->IsRunning())
+        m_Search->Cancel(*m_Simulator);
+
+    if (apply && m_Search->HasResult()) {
+        const auto &inputs = m_Search->GetBestInputs();
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            ApplyKeysToInputState(inputs[i], m_CurrentRecord->GetFrame(m_SearchFrame + i).inputState);
+        }
+
+        char text[128];
+        sprintf(text, "TAS search finished, best %.3f after %d simulated frames.", m_Search->GetBestScore(),
+                (int) m_Search->GetStats().simulatedFrames);
+        m_BML->SendIngameMessage(text);
+
+        TASRecord result = *m_CurrentRecord;
+        std::string name = result.GetName() + "_search";
+        result.SetName(name);
+        result.SetPath(BML_TAS_PATH + name + ".tas");
+        m_BML->SendIngameMessage(("TAS record saved to " + name).c_str());
+        std::thread([result = std::move(result)]() {
+            result.Save();
+        }).detach();
+    } else {
+        m_BML->SendIngameMessage("TAS search stopped.");
+    }
+
+    // Continue playing from the window start, the simulator has been restored to it
+    m_CurrentRecord->SetFrameIndex(m_SearchFrame);
+
+    m_Search.reset();
+    m_Simulator.reset();
+}
+
+uint64_t TASSupport::GenerateSeed() {
+    auto now = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    uint64_t seed = TASRandom::Mix((uint64_t) now);
+    return seed != 0 ? seed : 1;
+}
+
 void TASSupport::SetupNewRecord() {
     char filename[MAX_PATH];
     time_t stamp = time(nullptr);
@@ -713,19 +941,101 @@ void TASSupport::SetupNewRecord() {
 }
 
 void TASSupport::RefreshRecords() {
-    m_Records.clear();
+    m_Records = ListRecords();
+}
+
+std::vector<TASRecord> TASSupport::ListRecords() const {
+    std::vector<TASRecord> records;
 
-    CKDirectoryParser tasTraverser((CKSTRING) BML_TAS_PATH, (CKSTRING) "*.tas", TRUE);
+    // Binary (.tas) and text (.tast) records
+    CKDirectoryParser tasTraverser((CKSTRING) BML_TAS_PATH, (CKSTRING) "*.tas*", TRUE);
     for (char *tasPath = tasTraverser.GetNextFile(); tasPath != nullptr; tasPath = tasTraverser.GetNextFile()) {
         std::string tasFile = tasPath;
         auto start = tasFile.find_last_of('\\') + 1;
-        auto count = tasFile.find_last_of('.') - start;
-        std::string name = tasFile.substr(start, count);
-        std::string path = BML_TAS_PATH + name + ".tas";
-        m_Records.emplace_back(name, path, m_Legacy);
+        auto dot = tasFile.find_last_of('.');
+        std::string ext = tasFile.substr(dot);
+        if (ext != ".tas" && ext != ".tast")
+            continue;
+        std::string name = tasFile.substr(start, dot - start);
+        std::string path = BML_TAS_PATH + name + ext;
+        records.emplace_back(name, path, m_Legacy);
     }
 
-    std::sort(m_Records.begin(), m_Records.end());
+    // A record saved in both formats is listed once, by its binary file
+    std::sort(records.begin(), records.end(), [](const TASRecord &a, const TASRecord &b) {
+        if (a.GetName() != b.GetName())
+            return a < b;
+        return !a.IsText() && b.IsText();
+    });
+    records.erase(std::unique(records.begin(), records.end(), [](const TASRecord &a, const TASRecord &b) {
+        return a.GetName() == b.GetName();
+    }), records.end());
+    return records;
+}
+
+bool TASSupport::ConvertRecord(const std::string &name, bool toText) {
+    std::string src = BML_TAS_PATH + name + (toText ? ".tas" : ".tast");
+    std::string dest = BML_TAS_PATH + name + (toText ? ".tast" : ".tas");
+
+    TASRecord record(name, src, toText && m_Legacy);
+    try {
+        record.Load();
+        record.SetPath(dest);
+        record.Save();
+    } catch (const std::exception &e) {
+        m_BML->SendIngameMessage(("Failed to convert " + name + ": " + e.what()).c_str());
+        return false;
+    }
+    return true;
+}
+
+bool TASSupport::SpliceRecord(const std::string &name, const std::vector<std::string> &sources, bool force) {
+    std::vector<SpliceSection> sections;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        // "<record>[:<sector>]", the sector defaults to the position in the list
+        std::string source = sources[i];
+        int sector = (int) i + 1;
+        auto colon = source.find_last_of(':');
+        if (colon != std::string::npos) {
+            sector = atoi(source.c_str() + colon + 1);
+            source.resize(colon);
+        }
+
+        std::string path = BML_TAS_PATH + source + ".tas";
+        struct stat buf = {0};
+        if (stat(path.c_str(), &buf) != 0)
+            path += 't';
+        sections.push_back({path, sector});
+    }
+
+    TASRecord result(name, BML_TAS_PATH + name + ".tas");
+    ChunkedFrames frames;
+    try {
+        auto seams = SpliceRecords(sections, SPLICE_TOLERANCE, m_Legacy, result, frames);
+        for (const auto &seam : seams) {
+            char text[192];
+            if (seam.distance < 0.0f)
+                sprintf(text, "Seam before sector %d: positions not recorded", seam.sector);
+            else
+                sprintf(text, "Seam before sector %d: positions differ by %.3f", seam.sector, seam.distance);
+            if (seam.seedMismatch)
+                strcat(text, ", random seeds differ");
+            if (seam.randomMissing)
+                strcat(text, ", random counters not recorded");
+            m_BML->SendIngameMessage(text);
+        }
+
+        if (!seams.empty() && !force) {
+            m_BML->SendIngameMessage("Splice aborted, use -f to keep mismatched seams.");
+            return false;
+        }
+
+        result.SaveChunks(frames);
+    } catch (const std::exception &e) {
+        m_BML->SendIngameMessage((std::string("Failed to splice TAS records: ") + e.what()).c_str());
+        return false;
+    }
+    return true;
 }
 
 void TASSupport::OpenTASMenu() {
@@ -796,3 +1106,17 @@ CK3dEntity *TASSupport::GetActiveBall() const {
         return (CK3dEntity *) m_ActiveBall->GetValueObject();
     return nullptr;
 }
+
+bool TASSupport::GetBallPosition(VxVector &position) const {
+    CK3dEntity *ball = GetActiveBall();
+    if (!ball)
+        return false;
+    ball->GetPosition(&position);
+    return true;
+}
+
+void TASSupport::RecordSectorRandom(Sector &sector) const {
+    sector.randomRecorded = true;
+    sector.behaviorRandom = m_FrameRandom.behavior;
+    sector.physicsRandom = m_FrameRandom.physics;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -7,6 +8,7 @@
 
 #include "physics_RT.h"
 #include "TASRecord.h"
+#include "TASSearch.h"
 
 MOD_EXPORT IMod *BMLEntry(IBML *bml);
 MOD_EXPORT void BMLExit(IMod *mod);
@@ -15,8 +17,16 @@ typedef enum TASState {
     TAS_IDLE = 0,
     TAS_PLAYING = 0x1,
     TAS_RECORDING = 0x2,
+    TAS_SEARCHING = 0x4,
 } TASState;
 
+struct PhysicsClock {
+    double *baseTime;
+    double *currentTime;
+    double *timeOfLastPSI;
+    double *timeOfNextPSI;
+};
+
 class TASSupport : public IMod {
 public:
     explicit TASSupport(IBML *bml) : IMod(bml) {}
@@ -67,10 +77,12 @@ public:
     void OnDrawMenu();
     void OnDrawKeys();
     void OnDrawInfo();
+    void OnDrawSearch();
 
     bool IsIdle() const { return m_State == 0; }
     bool IsPlaying() const { return (m_State & TAS_PLAYING) != 0; }
     bool IsRecording() const { return (m_State & TAS_RECORDING) != 0; }
+    bool IsSearching() const { return (m_State & TAS_SEARCHING) != 0; }
 
     void InitHooks();
     void ShutdownHooks();
@@ -80,8 +92,16 @@ public:
     void SetPhysicsTimeFactor(float factor = 1.0f);
     void SetNextMovementCheck(short count = 0);
     void SetupNewRecord();
+    static uint64_t GenerateSeed();
+    PhysicsClock GetPhysicsClock() const;
+
+    void StartSearch();
+    void StopSearch(bool apply);
 
     void RefreshRecords();
+    std::vector<TASRecord> ListRecords() const;
+    bool ConvertRecord(const std::string &name, bool toText);
+    bool SpliceRecord(const std::string &name, const std::vector<std::string> &sources, bool force);
     void OpenTASMenu();
     void ExitTASMenu();
 
@@ -90,6 +110,10 @@ public:
     void ResetKeyboardState(unsigned char *dest) const;
 
     CK3dEntity *GetActiveBall() const;
+    bool GetBallPosition(VxVector &position) const;
+
+    // Gives the sector the random counters of the frame it starts in
+    void RecordSectorRandom(Sector &sector) const;
 
     CKIpionManager *m_IpionManager = nullptr;
     CKTimeManager *m_TimeManager = nullptr;
@@ -114,6 +138,7 @@ public:
     TASRecord m_RecordOnStartup;
     std::vector<TASRecord> m_Records;
     TASRecord *m_CurrentRecord = nullptr;
+    RandomState m_FrameRandom; // As the recorded frame started
 
     std::string m_MapName;
     CK2dEntity *m_Level01 = nullptr;
@@ -125,6 +150,12 @@ public:
     IProperty *m_ShowInfo = nullptr;
     char m_FrameCountText[100] = {};
 
+    std::unique_ptr<GameSimulator> m_Simulator;
+    std::unique_ptr<InputSearch<GameSimulator>> m_Search;
+    size_t m_SearchFrame = 0;
+    bool m_Searched = false;
+    CKDWORD m_LimitOptions = 0;
+
     IProperty *m_Enabled = nullptr;
     IProperty *m_Record = nullptr;
     IProperty *m_StopKey = nullptr;
@@ -135,4 +166,14 @@ public:
     IProperty *m_LoadTAS = nullptr;
     IProperty *m_LoadLevel = nullptr;
     IProperty *m_LegacyMode = nullptr;
+
+    IProperty *m_SearchEnabled = nullptr;
+    IProperty *m_SearchStart = nullptr;
+    IProperty *m_SearchWindow = nullptr;
+    IProperty *m_SearchHold = nullptr;
+    IProperty *m_SearchBeam = nullptr;
+    IProperty *m_SearchAlphabet = nullptr;
+    IProperty *m_SearchObjective = nullptr;
+    IProperty *m_SearchTarget = nullptr;
+    IProperty *m_SearchFallLimit = nullptr;
 };
@@ -0,0 +1,522 @@
+#include "TASText.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+    constexpr uint32_t TEXT_VERSION = 2;
+    constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    // A day of frames at 60 fps is well below either limit
+    constexpr size_t MAX_FRAMES = 1 << 26;
+    constexpr size_t MAX_RESERVED_FRAMES = 1 << 22;
+
+    struct KeyName {
+        char name;
+        uint8_t InputState::*key;
+    };
+
+    constexpr KeyName KEY_NAMES[] = {
+        {'U', &InputState::keyUp},
+        {'D', &InputState::keyDown},
+        {'L', &InputState::keyLeft},
+        {'R', &InputState::keyRight},
+        {'S', &InputState::keyShift},
+        {'P', &InputState::keySpace},
+        {'Q', &InputState::keyQ},
+        {'E', &InputState::keyEsc},
+        {'N', &InputState::keyEnter},
+    };
+
+    // Index in KEY_NAMES of every character, -1 for those naming no key
+    constexpr std::array<int8_t, 256> KEY_INDEX = [] {
+        std::array<int8_t, 256> index = {};
+        index.fill(-1);
+        for (int i = 0; i < (int) std::size(KEY_NAMES); ++i)
+            index[(uint8_t) KEY_NAMES[i].name] = (int8_t) i;
+        return index;
+    }();
+
+    bool SameKeys(const InputState &a, const InputState &b) {
+        return a.keyUp == b.keyUp && a.keyDown == b.keyDown && a.keyLeft == b.keyLeft &&
+               a.keyRight == b.keyRight && a.keyShift == b.keyShift && a.keySpace == b.keySpace &&
+               a.keyQ == b.keyQ && a.keyEsc == b.keyEsc && a.keyEnter == b.keyEnter;
+    }
+
+    bool SameDelta(float a, float b) {
+        return std::memcmp(&a, &b, sizeof(float)) == 0;
+    }
+
+    char *PutUInt(char *out, uint64_t value) {
+        char digits[20];
+        int count = 0;
+        do {
+            digits[count++] = (char) ('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (count != 0)
+            *out++ = digits[--count];
+        return out;
+    }
+
+    class TextWriter {
+    public:
+        // Longest line of a frame run: a repeat count and every key with a state
+        static constexpr size_t MAX_RUN_LINE = 128;
+
+        explicit TextWriter(std::FILE *file) : m_File(file) {
+            m_Buffer.resize(BUFFER_SIZE);
+        }
+
+        void Reserve(size_t size) {
+            if (m_Size + size > m_Buffer.size())
+                Flush();
+        }
+
+        // Room for size bytes to be formatted in place, committed by End
+        char *Begin(size_t size) {
+            Reserve(size);
+            return m_Buffer.data() + m_Size;
+        }
+
+        void End(const char *end) { m_Size = end - m_Buffer.data(); }
+
+        void Put(char c) {
+            Reserve(1);
+            m_Buffer[m_Size++] = c;
+        }
+
+        void Put(const char *text, size_t size) {
+            if (size > m_Buffer.size()) {
+                Flush();
+                Write(text, size);
+                return;
+            }
+            Reserve(size);
+            std::memcpy(m_Buffer.data() + m_Size, text, size);
+            m_Size += size;
+        }
+
+        void Put(const char *text) { Put(text, std::strlen(text)); }
+
+        template<typename T>
+        void PutNumber(T value) {
+            Reserve(32);
+            auto result = std::to_chars(m_Buffer.data() + m_Size, m_Buffer.data() + m_Buffer.size(), value);
+            m_Size = result.ptr - m_Buffer.data();
+        }
+
+        void Flush() {
+            Write(m_Buffer.data(), m_Size);
+            m_Size = 0;
+        }
+
+    private:
+        void Write(const char *data, size_t size) {
+            if (size != 0 && std::fwrite(data, 1, size, m_File) != size)
+                throw std::runtime_error("Failed to write text record");
+        }
+
+        std::FILE *m_File;
+        std::vector<char> m_Buffer;
+        size_t m_Size = 0;
+    };
+
+    void WriteVector(TextWriter &writer, const VxVector &v) {
+        writer.Put(' ');
+        writer.PutNumber(v.x);
+        writer.Put(' ');
+        writer.PutNumber(v.y);
+        writer.Put(' ');
+        writer.PutNumber(v.z);
+    }
+
+    // Text of every set of keys held with state 1, so writing the keys of a frame is a single copy
+    struct KeyText {
+        char text[23];
+        uint8_t size;
+    };
+
+    constexpr std::array<KeyText, 1 << std::size(KEY_NAMES)> KEY_TEXTS = [] {
+        std::array<KeyText, 1 << std::size(KEY_NAMES)> texts = {};
+        for (size_t mask = 0; mask < texts.size(); ++mask) {
+            KeyText &key = texts[mask];
+            for (size_t i = 0; i < std::size(KEY_NAMES); ++i) {
+                if ((mask & (1 << i)) == 0)
+                    continue;
+                if (key.size != 0)
+                    key.text[key.size++] = ' ';
+                key.text[key.size++] = KEY_NAMES[i].name;
+            }
+            if (key.size == 0)
+                key.text[key.size++] = '-';
+            key.text[key.size++] = '\n';
+        }
+        return texts;
+    }();
+
+    char *WriteRun(char *out, const InputState &state, size_t count) {
+        if (count != 1) {
+            *out++ = 'x';
+            out = PutUInt(out, count);
+            *out++ = ' ';
+        }
+
+        // Bits in the order of KEY_NAMES, spelt out as a loop over the member pointers is not folded
+        const uint32_t mask = (state.keyUp & 1) | (state.keyDown & 1) << 1 | (state.keyLeft & 1) << 2 |
+                              (state.keyRight & 1) << 3 | (state.keyShift & 1) << 4 | (state.keySpace & 1) << 5 |
+                              (state.keyQ & 1) << 6 | (state.keyEsc & 1) << 7 | (state.keyEnter & 1) << 8;
+        const uint8_t states = state.keyUp | state.keyDown | state.keyLeft | state.keyRight | state.keyShift |
+                               state.keySpace | state.keyQ | state.keyEsc | state.keyEnter;
+        if (states <= 1) {
+            const KeyText &key = KEY_TEXTS[mask];
+            std::memcpy(out, key.text, sizeof(key.text));
+            return out + key.size;
+        }
+
+        const char *start = out;
+        for (const auto &key : KEY_NAMES) {
+            const uint8_t value = state.*key.key;
+            if (value == 0)
+                continue;
+
+            if (out != start)
+                *out++ = ' ';
+            *out++ = key.name;
+            if (value != 1) {
+                *out++ = '=';
+                out = PutUInt(out, value);
+            }
+        }
+        *out++ = '\n';
+        return out;
+    }
+
+    class LineParser {
+    public:
+        LineParser(const char *begin, const char *end, size_t line) : m_Cur(begin), m_End(end), m_Line(line) {}
+
+        bool AtEnd() {
+            SkipSpaces();
+            return m_Cur == m_End;
+        }
+
+        std::string_view Token() {
+            SkipSpaces();
+            const char *start = m_Cur;
+            while (m_Cur != m_End && *m_Cur != ' ' && *m_Cur != '\t')
+                ++m_Cur;
+            return {start, (size_t) (m_Cur - start)};
+        }
+
+        std::string_view Rest() {
+            SkipSpaces();
+            return {m_Cur, (size_t) (m_End - m_Cur)};
+        }
+
+        template<typename T>
+        T Number() {
+            SkipSpaces();
+            T value = {};
+            auto result = std::from_chars(m_Cur, m_End, value);
+            if (result.ec != std::errc())
+                Fail("invalid number");
+            m_Cur = result.ptr;
+            return value;
+        }
+
+        VxVector Vector() {
+            VxVector v;
+            v.x = Number<float>();
+            v.y = Number<float>();
+            v.z = Number<float>();
+            return v;
+        }
+
+        [[noreturn]] void Fail(const char *reason) const {
+            throw std::runtime_error("Text record line " + std::to_string(m_Line) + ": " + reason);
+        }
+
+    private:
+        void SkipSpaces() {
+            while (m_Cur != m_End && (*m_Cur == ' ' || *m_Cur == '\t'))
+                ++m_Cur;
+        }
+
+        const char *m_Cur;
+        const char *m_End;
+        size_t m_Line;
+    };
+
+    // Scans the whole text at once. Frame lines, nearly all of a record, are parsed character by character
+    // in place; the header lines go through a LineParser.
+    class TextReader {
+    public:
+        TextReader(std::string &mapName, uint32_t &flags, uint64_t &seed,
+                   std::vector<GameFrame> &frames, std::vector<Sector> &sectors)
+            : m_MapName(mapName), m_Flags(flags), m_Seed(seed), m_Frames(frames), m_Sectors(sectors) {}
+
+        // The text must end with a newline
+        void Parse(const char *cur, const char *end) {
+            while (cur != end) {
+                ++m_Line;
+                cur = SkipSpaces(cur);
+                const char c = *cur;
+                if (c == '\n') {
+                    ++cur;
+                } else if (c == 'x' || c == '-' || (KEY_INDEX[(uint8_t) c] >= 0 && IsKeyEnd(cur[1]))) {
+                    cur = ParseFrames(cur);
+                } else {
+                    const char *eol = (const char *) std::memchr(cur, '\n', end - cur);
+                    ParseDirective(cur, eol);
+                    cur = eol + 1;
+                }
+            }
+        }
+
+        void Finish() const {
+            if (m_FrameCount != SIZE_MAX && m_FrameCount != m_Frames.size())
+                throw std::runtime_error("Text record frame count mismatch");
+        }
+
+    private:
+        static bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+        static bool IsKeyEnd(char c) { return c == '=' || c == '\n' || IsSpace(c); }
+
+        static const char *SkipSpaces(const char *cur) {
+            while (IsSpace(*cur))
+                ++cur;
+            return cur;
+        }
+
+        const char *ParseUInt(const char *cur, uint64_t max, uint64_t &value, const char *reason) const {
+            if (*cur < '0' || *cur > '9')
+                Fail(reason);
+            value = 0;
+            do {
+                value = value * 10 + (*cur++ - '0');
+                if (value > max)
+                    Fail(reason);
+            } while (*cur >= '0' && *cur <= '9');
+            return cur;
+        }
+
+        const char *ParseFrames(const char *cur) {
+            uint64_t count = 1;
+            if (*cur == 'x') {
+                cur = ParseUInt(cur + 1, MAX_FRAMES, count, "invalid repeat count");
+                if (count == 0 || (!IsSpace(*cur) && *cur != '\n'))
+                    Fail("invalid repeat count");
+            }
+
+            GameFrame frame(m_DeltaTime);
+            while (true) {
+                const char c = *cur;
+                if (IsSpace(c)) {
+                    ++cur;
+                    continue;
+                }
+                if (c == '\n')
+                    break;
+
+                if (c == '-') {
+                    ++cur;
+                } else {
+                    const int index = KEY_INDEX[(uint8_t) c];
+                    if (index < 0)
+                        Fail("unknown key");
+                    uint64_t value = 1;
+                    if (*++cur == '=')
+                        cur = ParseUInt(cur + 1, UINT8_MAX, value, "invalid key state");
+                    frame.inputState.*KEY_NAMES[index].key = (uint8_t) value;
+                }
+                if (!IsSpace(*cur) && *cur != '\n')
+                    Fail(c == '-' ? "unknown key" : "invalid key state");
+            }
+
+            if (!m_HasDeltaTime)
+                Fail("frame before the first dt");
+            if (count > m_FrameLimit - m_Frames.size())
+                Fail(m_FrameCount != SIZE_MAX ? "more frames than declared" : "too many frames");
+            // The fill of insert only pays off on long runs
+            if (count <= 16) {
+                for (uint64_t i = 0; i < count; ++i)
+                    m_Frames.push_back(frame);
+            } else {
+                m_Frames.insert(m_Frames.end(), count, frame);
+            }
+            return cur + 1;
+        }
+
+        void ParseDirective(const char *begin, const char *end) {
+            if (end[-1] == '\r')
+                --end;
+            LineParser parser(begin, end, m_Line);
+            std::string_view token = parser.Token();
+            if (token[0] == '#')
+                return;
+
+            if (token == "dt") {
+                m_DeltaTime = parser.Number<float>();
+                m_HasDeltaTime = true;
+            } else if (token == "sector") {
+                Sector &sector = m_Sectors.emplace_back();
+                sector.id = parser.Number<int>();
+                sector.frameStart = parser.Number<int>();
+                sector.frameEnd = parser.Number<int>();
+                sector.startPosition = parser.Vector();
+                sector.endPosition = parser.Vector();
+                while (!parser.AtEnd())
+                    sector.objects.push_back(parser.Number<CK_ID>());
+            } else if (token == "random") {
+                if (m_Sectors.empty())
+                    parser.Fail("random counters before any sector");
+                Sector &sector = m_Sectors.back();
+                sector.behaviorRandom = parser.Number<uint64_t>();
+                sector.physicsRandom = parser.Number<uint64_t>();
+                sector.randomRecorded = true;
+            } else if (token == "map") {
+                m_MapName = parser.Rest();
+                return;
+            } else if (token == "flags") {
+                m_Flags = parser.Number<uint32_t>();
+            } else if (token == "seed") {
+                m_Seed = parser.Number<uint64_t>();
+            } else if (token == "frames") {
+                // The count is only trusted once the frames are read, a bogus one must not allocate
+                m_FrameCount = parser.Number<size_t>();
+                if (m_FrameCount > MAX_FRAMES)
+                    parser.Fail("too many frames");
+                m_FrameLimit = m_FrameCount;
+                m_Frames.reserve(std::min(m_FrameCount, MAX_RESERVED_FRAMES));
+            } else if (token == "tas") {
+                if (parser.Number<uint32_t>() > TEXT_VERSION)
+                    parser.Fail("unsupported version");
+            } else {
+                parser.Fail("unknown directive");
+            }
+
+            if (!parser.AtEnd())
+                parser.Fail("unexpected text at the end of the line");
+        }
+
+        [[noreturn]] void Fail(const char *reason) const {
+            throw std::runtime_error("Text record line " + std::to_string(m_Line) + ": " + reason);
+        }
+
+        std::string &m_MapName;
+        uint32_t &m_Flags;
+        uint64_t &m_Seed;
+        std::vector<GameFrame> &m_Frames;
+        std::vector<Sector> &m_Sectors;
+
+        size_t m_Line = 0;
+        size_t m_FrameCount = SIZE_MAX;
+        size_t m_FrameLimit = MAX_FRAMES;
+        float m_DeltaTime = 0.0f;
+        bool m_HasDeltaTime = false;
+    };
+}
+
+void WriteTASText(std::FILE *file, const std::string &mapName, uint32_t flags, uint64_t seed,
+                  const std::vector<GameFrame> &frames, const std::vector<Sector> &sectors) {
+    // Read back up to the end of the line
+    if (mapName.find_first_of("\r\n") != std::string::npos)
+        throw std::runtime_error("Map name holds a line break");
+
+    TextWriter writer(file);
+
+    writer.Put("tas ");
+    writer.PutNumber(TEXT_VERSION);
+    writer.Put("\nmap ");
+    writer.Put(mapName.c_str(), mapName.size());
+    writer.Put("\nflags ");
+    writer.PutNumber(flags);
+    writer.Put("\nseed ");
+    writer.PutNumber(seed);
+    writer.Put('\n');
+
+    for (const auto &sector : sectors) {
+        writer.Put("sector ");
+        writer.PutNumber(sector.id);
+        writer.Put(' ');
+        writer.PutNumber(sector.frameStart);
+        writer.Put(' ');
+        writer.PutNumber(sector.frameEnd);
+        WriteVector(writer, sector.startPosition);
+        WriteVector(writer, sector.endPosition);
+        for (CK_ID id : sector.objects) {
+            writer.Put(' ');
+            writer.PutNumber(id);
+        }
+        writer.Put('\n');
+
+        if (sector.randomRecorded) {
+            writer.Put("random ");
+            writer.PutNumber(sector.behaviorRandom);
+            writer.Put(' ');
+            writer.PutNumber(sector.physicsRandom);
+            writer.Put('\n');
+        }
+    }
+
+    writer.Put("frames ");
+    writer.PutNumber(frames.size());
+    writer.Put('\n');
+
+    size_t i = 0;
+    while (i < frames.size()) {
+        const GameFrame &frame = frames[i];
+        char *out = writer.Begin(TextWriter::MAX_RUN_LINE);
+        if (i == 0 || !SameDelta(frame.deltaTime, frames[i - 1].deltaTime)) {
+            std::memcpy(out, "dt ", 3);
+            out = std::to_chars(out + 3, out + TextWriter::MAX_RUN_LINE, frame.deltaTime).ptr;
+            *out++ = '\n';
+        }
+
+        size_t j = i + 1;
+        while (j < frames.size() && SameDelta(frames[j].deltaTime, frame.deltaTime) &&
+               SameKeys(frames[j].inputState, frame.inputState))
+            ++j;
+
+        writer.End(WriteRun(out, frame.inputState, j - i));
+        i = j;
+    }
+
+    writer.Flush();
+}
+
+void ReadTASText(std::FILE *file, std::string &mapName, uint32_t &flags, uint64_t &seed,
+                 std::vector<GameFrame> &frames, std::vector<Sector> &sectors) {
+    // The whole text is read at once, ending with a newline so that every line has one
+    size_t chunk = BUFFER_SIZE;
+    if (std::fseek(file, 0, SEEK_END) == 0) {
+        const long size = std::ftell(file);
+        if (size > 0)
+            chunk = (size_t) size + 1;
+        std::fseek(file, 0, SEEK_SET);
+    }
+    std::vector<char> text;
+    while (true) {
+        const size_t size = text.size();
+        text.resize(size + chunk);
+        const size_t read = std::fread(text.data() + size, 1, chunk, file);
+        text.resize(size + read);
+        if (read != chunk)
+            break;
+        chunk = BUFFER_SIZE;
+    }
+    if (std::ferror(file))
+        throw std::runtime_error("Failed to read text record");
+    if (text.empty() || text.back() != '\n')
+        text.push_back('\n');
+
+    TextReader reader(mapName, flags, seed, frames, sectors);
+    reader.Parse(text.data(), text.data() + text.size());
+    reader.Finish();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "TASRecord.h"
+
+// Line oriented text form of a TAS record (.tast), lossless with the binary format.
+//
+//   tas 2                        format version
+//   map <name>                   map name, up to the end of the line
+//   flags <n>                    record flags
+//   seed <n>                     seed of the random streams, 0 when left out
+//   sector <id> <frameStart> <frameEnd> <sx> <sy> <sz> <ex> <ey> <ez> [<object>...]
+//   random <behavior> <physics>  random counters at the start of the sector above, if recorded
+//   frames <count>               total frame count, checked after parsing
+//   dt <seconds>                 delta time of the following frames, written only when it changes
+//   x<n> <keys>                  n frames holding the keys, "x1" may be left out
+//
+// Keys are U D L R, S (Shift), P (Space), Q, E (Esc) and N (Enter), "-" when none is held.
+// A key state other than 1 is written as "U=2". Lines starting with '#' are comments.
+// Floats are written in their shortest round-trip form.
+
+void WriteTASText(std::FILE *file, const std::string &mapName, uint32_t flags, uint64_t seed,
+                  const std::vector<GameFrame> &frames, const std::vector<Sector> &sectors);
+
+// Throws std::runtime_error with the line number on malformed input.
+void ReadTASText(std::FILE *file, std::string &mapName, uint32_t &flags, uint64_t &seed,
+                 std::vector<GameFrame> &frames, std::vector<Sector> &sectors);
@@ -0,0 +1,118 @@
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include "InputSearch.h"
+#include "StandInSimulator.h"
+
+namespace {
+    int g_Failures = 0;
+
+#define CHECK(cond)                                                           \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++g_Failures;                                                     \
+        }                                                                     \
+    } while (0)
+
+    InputSearchConfig MakeConfig(size_t beamWidth) {
+        InputSearchConfig config;
+        config.window = 48;
+        config.hold = 6;
+        config.beamWidth = beamWidth;
+        config.alphabet = ParseInputAlphabet("U,UL,UR,L,R,-");
+        return config;
+    }
+
+    // Best score over every input sequence the search could pick, found by trying them all
+    double BruteForce(StandInSimulator &sim, const InputSearchConfig &config, size_t step) {
+        if (step * config.hold >= config.window)
+            return sim.Evaluate();
+
+        const StandInSimulator::Snapshot start = sim.Save();
+        double best = -std::numeric_limits<double>::infinity();
+        for (uint16_t keys : config.alphabet) {
+            sim.Restore(start);
+            for (size_t i = 0; i < config.hold; ++i)
+                sim.Apply(keys);
+            if (!sim.IsFailed()) {
+                const double score = BruteForce(sim, config, step + 1);
+                if (score > best)
+                    best = score;
+            }
+        }
+        sim.Restore(start);
+        return best;
+    }
+
+    double Replay(StandInSimulator &sim, const StandInSimulator::Snapshot &start, const std::vector<uint16_t> &inputs) {
+        sim.Restore(start);
+        for (uint16_t keys : inputs)
+            sim.Apply(keys);
+        return sim.IsFailed() ? -std::numeric_limits<double>::infinity() : sim.Evaluate();
+    }
+
+    void TestFindsOptimum() {
+        StandInSimulator sim;
+        const StandInSimulator::Snapshot start = sim.Save();
+        InputSearch<StandInSimulator> search(MakeConfig(32));
+        const double optimum = BruteForce(sim, search.GetConfig(), 0);
+
+        search.Run(sim);
+        CHECK(search.IsFinished());
+        CHECK(search.HasResult());
+        CHECK(search.GetBestInputs().size() == search.GetConfig().window);
+        CHECK(search.GetBestScore() == optimum);
+
+        // The simulator is left at the window start
+        const StandInSimulator::Snapshot end = sim.Save();
+        CHECK(end.x == start.x && end.y == start.y && end.vx == start.vx && end.vy == start.vy);
+
+        // Playing the chosen inputs from the start gives the same run
+        CHECK(Replay(sim, start, search.GetBestInputs()) == optimum);
+
+        // Each candidate only simulates its own frames, never the prefix it shares with its parent
+        const InputSearchStats &stats = search.GetStats();
+        CHECK(stats.simulatedFrames == stats.candidates * search.GetConfig().hold);
+        CHECK(stats.duplicates > 0);
+        CHECK(stats.failed > 0);
+    }
+
+    void TestGreedyMissesOptimum() {
+        // Going straight up is best until the hole, a search keeping a single candidate falls in
+        StandInSimulator sim;
+        InputSearch<StandInSimulator> greedy(MakeConfig(1));
+        const double optimum = BruteForce(sim, greedy.GetConfig(), 0);
+        greedy.Run(sim);
+        CHECK(greedy.GetBestScore() < optimum);
+    }
+
+    void TestAdvanceMatchesRun() {
+        // Ticked one frame at a time, as in game, the search reaches the same result
+        StandInSimulator a, b;
+        InputSearch<StandInSimulator> run(MakeConfig(8)), ticked(MakeConfig(8));
+        run.Run(a);
+
+        ticked.Begin(b);
+        size_t ticks = 0;
+        while (ticked.Advance(b))
+            ++ticks;
+        CHECK(ticked.GetBestInputs() == run.GetBestInputs());
+        CHECK(ticked.GetBestScore() == run.GetBestScore());
+        CHECK(ticks >= ticked.GetStats().simulatedFrames);
+    }
+}
+
+int main() {
+    TestFindsOptimum();
+    TestGreedyMissesOptimum();
+    TestAdvanceMatchesRun();
+
+    if (g_Failures > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", g_Failures);
+        return 1;
+    }
+    std::printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+#include "InputSearch.h"
+
+// Ball rolling up a straight lane, a stand-in for the game that InputSearch can drive without
+// Virtools. Everything is in integers, so runs are exact and replays reproduce a score bit for bit.
+//
+// The keys push the ball along their axis, a key pair pushes less along each axis than a single key.
+// The ball fails when it leaves the lane or rolls over the hole in its middle. Apply() steps at once.
+class StandInSimulator {
+public:
+    static constexpr int32_t LANE_HALF_WIDTH = 32;
+    static constexpr int32_t HOLE_HALF_WIDTH = 12;
+    static constexpr int32_t HOLE_BEGIN = 60;
+    static constexpr int32_t HOLE_END = 120;
+    static constexpr int32_t MAX_SPEED = 8;
+
+    struct Snapshot {
+        int32_t x = 0;
+        int32_t y = 0;
+        int32_t vx = 0;
+        int32_t vy = 0;
+        bool failed = false;
+    };
+
+    Snapshot Save() { return m_State; }
+    void Restore(const Snapshot &snapshot) { m_State = snapshot; }
+
+    void Apply(uint16_t keys) {
+        if (m_State.failed)
+            return;
+
+        const int32_t ax = ((keys & INPUT_KEY_RIGHT) ? 1 : 0) - ((keys & INPUT_KEY_LEFT) ? 1 : 0);
+        const int32_t ay = ((keys & INPUT_KEY_UP) ? 1 : 0) - ((keys & INPUT_KEY_DOWN) ? 1 : 0);
+        const int32_t force = ax != 0 && ay != 0 ? 1 : 2;
+
+        // Speeds lose a quarter of their value each tick, rounded towards zero
+        m_State.vx = Clamp(m_State.vx + ax * force - m_State.vx / 4);
+        m_State.vy = Clamp(m_State.vy + ay * force - m_State.vy / 4);
+        m_State.x += m_State.vx;
+        m_State.y += m_State.vy;
+        ++m_Ticks;
+
+        const bool overHole = m_State.y >= HOLE_BEGIN && m_State.y < HOLE_END &&
+                              m_State.x > -HOLE_HALF_WIDTH && m_State.x < HOLE_HALF_WIDTH;
+        if (overHole || m_State.x < -LANE_HALF_WIDTH || m_State.x > LANE_HALF_WIDTH)
+            m_State.failed = true;
+    }
+
+    double Evaluate() { return (double) m_State.y; }
+    bool IsFailed() { return m_State.failed; }
+
+    uint64_t Fingerprint() {
+        uint64_t hash = 1469598103934665603ull;
+        for (int32_t v : {m_State.x, m_State.y, m_State.vx, m_State.vy}) {
+            hash ^= (uint32_t) v;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    [[nodiscard]] size_t GetTicks() const { return m_Ticks; }
+
+private:
+    static int32_t Clamp(int32_t v) {
+        return v < -MAX_SPEED ? -MAX_SPEED : (v > MAX_SPEED ? MAX_SPEED : v);
+    }
+
+    Snapshot m_State;
+    size_t m_Ticks = 0;
+};